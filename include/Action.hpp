@@ -141,9 +141,20 @@ public:
     /** Returns the mean transition probabilities. Ignore rewards. */
     Transition mean_transition(OutcomeId) const {return outcome;};
 
+    /** Returns the mean transition without copying it. The scratch transition is not used. */
+    const Transition& mean_transition(OutcomeId, Transition&) const {return outcome;};
+
+    /** Returns the transition used by average. The scratch transition is not used. */
+    const Transition& average_transition(Transition&) const {return outcome;};
+
     /** Returns a json representation of the action
     \param actionid Includes also action id*/
     string to_json(long actionid = -1) const;
+
+    /** Writes a json representation of the action
+    \param output Output buffer
+    \param actionid Includes also action id*/
+    void to_json(OutputBuffer& output, long actionid = -1) const;
 };
 
 
@@ -317,10 +328,25 @@ public:
     /** Returns the mean transition probabilities */
     Transition mean_transition(OutcomeId oid) const {return outcomes[oid];};
 
+    /** Returns the mean transition without copying it. The scratch transition is not used. */
+    const Transition& mean_transition(OutcomeId oid, Transition&) const {return outcomes[oid];};
+
+    /**
+    Computes the uniform mixture of the outcomes, which corresponds to average,
+    into the scratch transition.
+    \returns Reference to the scratch transition
+    */
+    const Transition& average_transition(Transition& scratch) const;
+
     /** Returns a json representation of action
     \param actionid Includes also action id*/
     string to_json(long actionid = -1) const;
 
+    /** Writes a json representation of action
+    \param output Output buffer
+    \param actionid Includes also action id*/
+    void to_json(OutputBuffer& output, long actionid = -1) const;
+
 };
 
 // **************************************************************************************
@@ -356,6 +382,22 @@ protected:
     prec_t threshold;
     /** Weights used in computing the worst/best case */
     numvec distribution;
+    /** Whether to reuse the order of outcomes between calls (see set_order_caching) */
+    bool cache_order;
+    /** Order of the outcomes from the last call of minimal; only used with cache_order */
+    mutable vector<size_t> order_minimal;
+    /** Order of the outcomes from the last call of maximal, which negates the values
+        and thus sorts them in the opposite direction; only used with cache_order */
+    mutable vector<size_t> order_maximal;
+
+    /**
+    Computes the constrained outcome distribution for the outcome values.
+    \param outcomevalues Values of the outcomes
+    \param order Cached order of the outcomes; only used with cache_order
+    \param result Set to the distribution; its memory is reused when possible
+    \returns Value of the distribution
+    */
+    prec_t compute_nature(const numvec& outcomevalues, vector<size_t>& order, numvec& result) const;
 
 public:
     /** Type of the outcome identification */
@@ -363,11 +405,11 @@ public:
 
     /** Creates an empty action. */
     WeightedOutcomeAction()
-        : OutcomeManagement(), threshold(0), distribution(0) {};
+        : OutcomeManagement(), threshold(0), distribution(0), cache_order(false) {};
 
     /** Initializes outcomes to the provided vector */
     WeightedOutcomeAction(const vector<Transition>& outcomes)
-        : OutcomeManagement(outcomes), threshold(0), distribution(0) {};
+        : OutcomeManagement(outcomes), threshold(0), distribution(0), cache_order(false) {};
 
     /**
     Computes the maximal outcome distribution constraints on the nature's distribution.
@@ -380,6 +422,17 @@ public:
      */
     pair<OutcomeId,prec_t> maximal(numvec const& valuefunction, prec_t discount) const;
 
+    /**
+    Computes the maximal outcome distribution like maximal, but stores the distribution
+    in the provided vector, reusing its memory. Does not allocate memory when the
+    capacity of the vector suffices and nature is worstcase_l1.
+    \param valuefunction Value function reference
+    \param discount Discount factor
+    \param result Set to the outcome distribution
+    \return Mean value for the maximal bounded solution
+     */
+    prec_t maximal(numvec const& valuefunction, prec_t discount, OutcomeId& result) const;
+
     /**
     Computes the minimal outcome distribution constraints on the nature's distribution
     Template argument nature represents the function used to select the constrained distribution
@@ -391,6 +444,17 @@ public:
      */
     pair<OutcomeId,prec_t> minimal(numvec const& valuefunction, prec_t discount) const;
 
+    /**
+    Computes the minimal outcome distribution like minimal, but stores the distribution
+    in the provided vector, reusing its memory. Does not allocate memory when the
+    capacity of the vector suffices and nature is worstcase_l1.
+    \param valuefunction Value function reference
+    \param discount Discount factor
+    \param result Set to the outcome distribution
+    \return Mean value for the minimal bounded solution
+     */
+    prec_t minimal(numvec const& valuefunction, prec_t discount, OutcomeId& result) const;
+
     /**
     Computes the average outcome using a uniform distribution.
     \param valuefunction Updated value function
@@ -406,7 +470,7 @@ public:
     \param index Index of the outcome used
     \return Value of the action
      */
-    prec_t fixed(numvec const& valuefunction, prec_t discount, OutcomeId dist) const;
+    prec_t fixed(numvec const& valuefunction, prec_t discount, const OutcomeId& dist) const;
 
     /**
     Adds a sufficient number (or 0) of empty outcomes/transitions for the provided outcomeid 
@@ -495,6 +559,25 @@ public:
     /** Sets threshold value */
     void set_threshold(prec_t threshold){this->threshold = threshold; }
 
+    /**
+    Enables reusing the sort order of the outcomes from the previous computation
+    in minimal and maximal. The order is repaired incrementally, which is faster
+    than a new selection when the value function changes little between
+    iterations. The cached order is only used when nature is worstcase_l1.
+
+    Separate orders are kept for minimal and maximal, which sort in opposite directions,
+    so alternating robust and optimistic computations do not invalidate each other's order.
+    The orders are stored in the action and therefore the same action must not be
+    evaluated concurrently from multiple threads when caching is enabled.
+    */
+    void set_order_caching(bool cache){
+        cache_order = cache;
+        if(!cache){order_minimal.clear(); order_maximal.clear();}
+    }
+
+    /** Whether the order of outcomes is reused between computations */
+    bool get_order_caching() const {return cache_order;};
+
     /** Appends a string representation to the argument */
     void to_string(string& result) const {
         result.append(std::to_string(get_outcomes().size()));
@@ -503,18 +586,38 @@ public:
     }
 
     /** Whether the provided outcome is valid */
-    bool is_outcome_correct(OutcomeId oid) const
+    bool is_outcome_correct(const OutcomeId& oid) const
         {return (oid.size() == outcomes.size());};
 
     /** Returns the mean reward from the transition. */
-    prec_t mean_reward(OutcomeId outcomedist) const;
+    prec_t mean_reward(const OutcomeId& outcomedist) const;
 
     /** Returns the mean transition probabilities */
-    Transition mean_transition(OutcomeId outcomedist) const;
+    Transition mean_transition(const OutcomeId& outcomedist) const;
+
+    /**
+    Computes the mean transition into the scratch transition, which is cleared first.
+    Reusing the scratch transition prevents repeated allocations.
+    \returns Reference to the scratch transition
+    */
+    const Transition& mean_transition(const OutcomeId& outcomedist, Transition& scratch) const;
+
+    /**
+    Computes the mixture of the outcomes weighted by the nominal distribution, which
+    corresponds to average, into the scratch transition.
+    \returns Reference to the scratch transition
+    */
+    const Transition& average_transition(Transition& scratch) const
+        {return mean_transition(distribution, scratch);};
 
     /** Returns a json representation of action
     \param actionid Includes also action id*/
     string to_json(long actionid = -1) const;
+
+    /** Writes a json representation of action
+    \param output Output buffer
+    \param actionid Includes also action id*/
+    void to_json(OutputBuffer& output, long actionid = -1) const;
 };
 
 // **************************************************************************************
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "definitions.hpp"
+
+#include <vector>
+#include <deque>
+#include <limits>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Anderson acceleration
+// **************************************************************************************
+
+/**
+Anderson acceleration (Anderson mixing) of a fixed-point iteration \f$ x \gets g(x) \f$,
+such as the Jacobi value iteration.
+
+The method keeps a bounded history of the differences of residuals
+\f$ f_k = g(x_k) - x_k \f$ and of the values \f$ g(x_k) \f$. The next iterate is
+\f[ x_{k+1} = g(x_k) - \sum_j \alpha_j \Delta g_j \f]
+where \f$ \alpha \f$ minimizes \f$ \| f_k - \sum_j \alpha_j \Delta f_j \|_2 \f$. The small
+least-squares problem is solved using regularized normal equations.
+
+The acceleration is not guaranteed to converge for the nonlinear Bellman operator.
+As a safeguard, the history is discarded and the plain update is used whenever the
+residual increases above the smallest residual observed since the last reset
+multiplied by a constant factor. The residuals of accelerated iterations are not
+monotone, and a strict comparison (factor 1) discards most of the useful history.
+*/
+class AndersonAcceleration{
+public:
+    /**
+    \param dimension Size of the iterates
+    \param history Maximal number of stored differences; 0 disables the acceleration
+    \param safeguard Reset the history when the residual exceeds the smallest residual
+                since the last reset multiplied by this factor
+    \param regularization Relative Tikhonov regularization of the least-squares problem
+    */
+    AndersonAcceleration(size_t dimension, size_t history, prec_t safeguard = 2.0,
+                         prec_t regularization = 1e-10) :
+        dimension(dimension), history(history), safeguard(safeguard),
+        regularization(regularization), has_previous(false),
+        best_residual(numeric_limits<prec_t>::infinity()) {};
+
+    /**
+    Computes the next iterate.
+    \param x Current iterate
+    \param gx Value of the fixed-point map g(x); replaced by the next iterate
+    \param residual Residual of the current iterate, such as \f$ \| g(x) - x \|_\infty \f$,
+                used by the safeguard
+    \returns Whether the extrapolation was used (false when the history is empty, it
+            was reset by the safeguard, or the least-squares problem is singular)
+    */
+    bool mix(const numvec& x, numvec& gx, prec_t residual);
+
+    /** Discards the history; the next call of mix returns the plain update */
+    void reset();
+
+    /** Maximal number of stored differences */
+    size_t get_history() const {return history;};
+
+protected:
+    /// Size of the iterates
+    size_t dimension;
+    /// Maximal number of stored differences
+    size_t history;
+    /// Factor of the growth of the residual that triggers a reset
+    prec_t safeguard;
+    /// Relative regularization of the normal equations
+    prec_t regularization;
+
+    /// Whether the previous residual and value are available
+    bool has_previous;
+    /// Smallest residual since the last reset
+    prec_t best_residual;
+    /// Previous residual g(x) - x
+    numvec previous_f;
+    /// Previous value g(x)
+    numvec previous_g;
+    /// Differences of residuals, the oldest first
+    deque<numvec> delta_f;
+    /// Differences of values g(x), the oldest first
+    deque<numvec> delta_g;
+};
+
+}
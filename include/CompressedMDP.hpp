@@ -0,0 +1,365 @@
+#pragma once
+
+#include "RMDP.hpp"
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Shared array
+// **************************************************************************************
+
+/**
+A read-only array that either owns its elements or refers to memory owned by another
+object, such as a memory-mapped file. Copies of the array share the elements, which
+is safe because they cannot be modified.
+*/
+template<class T>
+class SharedArray{
+public:
+    /** Constructs an empty array */
+    SharedArray() : first(nullptr), count(0) {};
+
+    /** Takes over the elements of the vector */
+    explicit SharedArray(vector<T>&& elements){
+        auto storage = make_shared<vector<T>>(move(elements));
+        first = storage->data(); count = storage->size();
+        owner = move(storage);
+    }
+
+    /**
+    Refers to elements stored elsewhere.
+    \param first Pointer to the first element
+    \param count Number of elements
+    \param owner Object that keeps the memory valid for the lifetime of the array
+    */
+    SharedArray(const T* first, size_t count, shared_ptr<const void> owner) :
+        owner(move(owner)), first(first), count(count) {};
+
+    size_t size() const {return count;};
+    bool empty() const {return count == 0;};
+    const T* data() const {return first;};
+    const T* begin() const {return first;};
+    const T* end() const {return first + count;};
+    const T& operator[](size_t index) const {assert(index < count); return first[index];};
+    const T& back() const {assert(count > 0); return first[count - 1];};
+
+protected:
+    /// Keeps the elements alive
+    shared_ptr<const void> owner;
+    /// First element
+    const T* first;
+    /// Number of elements
+    size_t count;
+};
+
+// **************************************************************************************
+//  Compressed (frozen) MDP
+// **************************************************************************************
+
+/**
+A read-only (frozen) version of a GRMDP in which all transition probabilities
+and rewards are packed in contiguous compressed-sparse-row (CSR) arrays.
+
+The object graph representation (GRMDP, SAState, actions, Transition) stores three
+separate heap vectors for every outcome; value iteration then needs to follow
+several pointers to evaluate each outcome. The compressed representation instead uses
+a fixed hierarchy of offset arrays:
+    - state_offsets: actions of state s are [state_offsets[s], state_offsets[s+1])
+    - action_offsets: outcomes of action a are [action_offsets[a], action_offsets[a+1])
+    - outcome_offsets: nonzeros of outcome o are [outcome_offsets[o], outcome_offsets[o+1])
+    - indices, probabilities, rewards: a single contiguous block of all nonzero
+        transitions, sorted by state, action, outcome, and target state
+
+Actions and outcomes are indexed globally in these arrays, but all solution methods
+return the usual per-state action and outcome identifiers.
+
+The solution methods perform exactly the same floating point operations in the same
+order as the corresponding GRMDP methods and therefore return bit-identical solutions.
+
+The model cannot be modified once it is constructed. Use freeze to construct it.
+
+The arrays can be saved to a binary file by to_binary_file. The file is loaded by
+from_binary_file using a read-only memory map, so the model is not copied or parsed and
+can be solved immediately; the operating system reads the pages of the file as the
+solvers access them and can share them among processes. The file format (version 1)
+uses the native byte order and consists of:
+    - header: the identifier "CRAAMMDP", the format version, a byte order mark, the type
+        of actions, the sizes of PType and IType in bytes, flags, and the number of states,
+        actions, outcomes, nonzero transitions, thresholds, and distribution weights
+        as 64-bit integers
+    - the arrays state_offsets, action_offsets, outcome_offsets (as 64-bit integers),
+        indices, probabilities, rewards, valid (a byte for each action), thresholds
+        and distribution (as prec_t), each starting at a multiple of 64 bytes
+
+A file whose name ends with .gz is compressed by gzip. The indices of each outcome are
+then stored as differences from the previous index (flag 1), which are small numbers
+that compress well. Compressed files cannot be memory-mapped.
+
+The transition probabilities, rewards, and target state indices can be stored with a
+lower precision than prec_t to reduce the memory footprint and the memory bandwidth
+of the solvers. The value function and all computation still use prec_t; the stored
+values are only converted when they are loaded. With PType = float and IType = int32_t
+(see CompressedMDPf) each nonzero transition takes 12 bytes instead of 24 bytes.
+The solutions are then no longer bit-identical to the GRMDP solutions, but differ only
+by the rounding errors in the probabilities and rewards.
+
+\tparam SType Type of state of the source GRMDP. It determines the type of actions
+        and outcomes (see MDP, RMDP_D, RMDP_L1)
+\tparam PType Type used to store transition probabilities and rewards
+\tparam IType Type used to store target state indices
+*/
+template<class SType, class PType = prec_t, class IType = long>
+class CompressedMDP{
+public:
+    /** Action identifier in a policy. Copies type from state type. */
+    typedef typename GRMDP<SType>::ActionId ActionId;
+    /** Outcome identifier in a policy. Copies type from state type. */
+    typedef typename GRMDP<SType>::OutcomeId OutcomeId;
+    /** Decision-maker's policy: Which action to take in which state.  */
+    typedef typename GRMDP<SType>::ActionPolicy ActionPolicy;
+    /** Nature's policy: Which outcome to take in which state.  */
+    typedef typename GRMDP<SType>::OutcomePolicy OutcomePolicy;
+    /** Solution type */
+    typedef typename GRMDP<SType>::SolType SolType;
+    /** Type of actions in the source model */
+    typedef typename SType::ActionType ActionType;
+
+    /** Constructs an empty compressed model */
+    CompressedMDP() : state_offsets(vector<size_t>(1,0)), action_offsets(vector<size_t>(1,0)),
+                      outcome_offsets(vector<size_t>(1,0)) {};
+
+    /**
+    Packs the model into the compressed representation. The source model is not
+    referenced after the construction and may be modified or destroyed freely.
+
+    Throws an invalid_argument exception when the number of states cannot be
+    represented by IType.
+
+    \param mdp Source model
+    */
+    CompressedMDP(const GRMDP<SType>& mdp);
+
+    /** Number of states */
+    size_t state_count() const {return state_offsets.size() - 1;};
+
+    /** Number of states */
+    size_t size() const {return state_count();};
+
+    /** Number of actions in the state */
+    size_t action_count(long stateid) const
+        {return state_offsets[stateid+1] - state_offsets[stateid];};
+
+    /** Total number of actions in all states */
+    size_t action_count() const {return action_offsets.size() - 1;};
+
+    /** Total number of outcomes in all states and actions */
+    size_t outcome_count() const {return outcome_offsets.size() - 1;};
+
+    /** Total number of transitions with a non-zero probability */
+    size_t nonzero_count() const {return indices.size();};
+
+    /** Number of bytes used to store the target states, probabilities and rewards */
+    size_t nonzero_bytes() const {return nonzero_count() * (sizeof(IType) + 2*sizeof(PType));};
+
+    /**
+    Constructs a regular model with the same states, actions, outcomes, and transitions,
+    including thresholds and outcome distributions. Probabilities and rewards are
+    converted to prec_t.
+    */
+    GRMDP<SType> unfreeze() const;
+
+    // ----------------------------------------------
+    // Binary files
+    // ----------------------------------------------
+
+    /**
+    Saves the model to a binary file that can be memory-mapped by from_binary_file.
+    The file is compressed when its name ends with .gz. See CompressedMDP for the
+    description of the format. Throws an invalid_argument exception when the file
+    cannot be written.
+    \param filename Name of the file
+    */
+    void to_binary_file(const string& filename) const;
+
+    /**
+    Maps a binary file created by to_binary_file to memory. The file is not copied
+    and it remains mapped until the model and all its copies are destroyed. The file
+    must not be modified while it is mapped. The offsets and target states are checked
+    in one pass when the file is loaded; the probabilities and rewards are read only
+    when the solvers access the transitions.
+
+    A compressed file is decompressed into memory instead.
+
+    Throws an invalid_argument exception when the file cannot be opened, it is not a
+    valid model file, it is truncated or corrupted (inconsistent offsets or target states
+    out of range), or it was saved with different action, probability, or index types.
+
+    \param filename Name of the file
+    */
+    static CompressedMDP from_binary_file(const string& filename);
+
+    // ----------------------------------------------
+    // Solution methods
+    // ----------------------------------------------
+
+    /** Gauss-Seidel value iteration. See GRMDP::vi_gs. */
+    SolType vi_gs(Uncertainty uncert,
+                  prec_t discount,
+                  numvec valuefunction=numvec(0),
+                  unsigned long iterations=MAXITER,
+                  prec_t maxresidual=SOLPREC) const;
+
+    /** Jacobi value iteration parallelized with OpenMP. See GRMDP::vi_jac. */
+    SolType vi_jac(Uncertainty uncert,
+                   prec_t discount,
+                   const numvec& valuefunction=numvec(0),
+                   unsigned long iterations=MAXITER,
+                   prec_t maxresidual=SOLPREC,
+                   size_t anderson_history=0) const;
+
+    /** Modified policy iteration parallelized with OpenMP. See GRMDP::mpi_jac. */
+    SolType mpi_jac(Uncertainty uncert,
+                    prec_t discount,
+                    const numvec& valuefunction=numvec(0),
+                    unsigned long iterations_pi=MAXITER,
+                    prec_t maxresidual_pi=SOLPREC,
+                    unsigned long iterations_vi=MAXITER,
+                    prec_t maxresidual_vi=SOLPREC/2,
+                    bool show_progress=false,
+                    size_t anderson_history=0) const;
+
+    /** Jacobi policy evaluation for a fixed policy and nature. See GRMDP::vi_jac_fix. */
+    SolType vi_jac_fix(prec_t discount,
+                       const ActionPolicy& policy,
+                       const OutcomePolicy& natpolicy,
+                       const numvec& valuefunction=numvec(0),
+                       unsigned long iterations=MAXITER,
+                       prec_t maxresidual=SOLPREC) const;
+
+protected:
+    /// Index of the first action for each state (size: states + 1)
+    SharedArray<size_t> state_offsets;
+    /// Index of the first outcome for each action (size: actions + 1)
+    SharedArray<size_t> action_offsets;
+    /// Index of the first nonzero transition for each outcome (size: outcomes + 1)
+    SharedArray<size_t> outcome_offsets;
+
+    /// Target states of all transitions
+    SharedArray<IType> indices;
+    /// Probabilities of all transitions
+    SharedArray<PType> probabilities;
+    /// Rewards of all transitions
+    SharedArray<PType> rewards;
+
+    /// Whether each action is valid (0 or 1)
+    SharedArray<uint8_t> valid;
+    /// Threshold for each action (only used by weighted outcome actions)
+    SharedArray<prec_t> thresholds;
+    /// Nominal distribution weight of each outcome (only used by weighted outcome actions)
+    SharedArray<prec_t> distribution;
+
+    /** Partition of states for the parallel loops with the schedule set by set_schedule */
+    StateBlocks state_blocks() const;
+
+    /** Computes the value of a single outcome. See Transition::compute_value. */
+    prec_t outcome_value(size_t outcomeindex, const numvec& valuefunction, prec_t discount) const;
+
+    /** Computes the maximal outcome of an action. See RegularAction::maximal. */
+    pair<OutcomeId,prec_t> action_maximal(size_t actionindex, const numvec& valuefunction, prec_t discount) const
+        {return action_maximal(actionindex, valuefunction, discount, (const ActionType*) nullptr);};
+    /** Computes the minimal outcome of an action. See RegularAction::minimal. */
+    pair<OutcomeId,prec_t> action_minimal(size_t actionindex, const numvec& valuefunction, prec_t discount) const
+        {return action_minimal(actionindex, valuefunction, discount, (const ActionType*) nullptr);};
+    /** Computes the average outcome of an action. See RegularAction::average. */
+    prec_t action_average(size_t actionindex, const numvec& valuefunction, prec_t discount) const
+        {return action_average(actionindex, valuefunction, discount, (const ActionType*) nullptr);};
+    /** Computes the value of a fixed outcome of an action. See RegularAction::fixed. */
+    prec_t action_fixed(size_t actionindex, const numvec& valuefunction, prec_t discount, const OutcomeId& outcome) const
+        {return action_fixed(actionindex, valuefunction, discount, outcome, (const ActionType*) nullptr);};
+
+    // The action computation depends on the type of the action. The last (unused)
+    // argument selects the appropriate overload. The general versions correspond to
+    // DiscreteOutcomeAction, which also covers RegularAction since it has exactly one outcome.
+
+    template<class AType>
+    pair<OutcomeId,prec_t> action_maximal(size_t actionindex, const numvec& valuefunction, prec_t discount, const AType*) const;
+    template<NatureConstr nature>
+    pair<OutcomeId,prec_t> action_maximal(size_t actionindex, const numvec& valuefunction, prec_t discount, const WeightedOutcomeAction<nature>*) const;
+    template<class AType>
+    pair<OutcomeId,prec_t> action_minimal(size_t actionindex, const numvec& valuefunction, prec_t discount, const AType*) const;
+    template<NatureConstr nature>
+    pair<OutcomeId,prec_t> action_minimal(size_t actionindex, const numvec& valuefunction, prec_t discount, const WeightedOutcomeAction<nature>*) const;
+    template<class AType>
+    prec_t action_average(size_t actionindex, const numvec& valuefunction, prec_t discount, const AType*) const;
+    template<NatureConstr nature>
+    prec_t action_average(size_t actionindex, const numvec& valuefunction, prec_t discount, const WeightedOutcomeAction<nature>*) const;
+    template<class AType>
+    prec_t action_fixed(size_t actionindex, const numvec& valuefunction, prec_t discount, const OutcomeId& outcome, const AType*) const;
+    prec_t action_fixed(size_t actionindex, const numvec& valuefunction, prec_t discount, const OutcomeId& outcome, const RegularAction*) const;
+    template<NatureConstr nature>
+    prec_t action_fixed(size_t actionindex, const numvec& valuefunction, prec_t discount, const OutcomeId& outcome, const WeightedOutcomeAction<nature>*) const;
+
+    /** Value of a fixed action and the average outcome. See SAState::fixed_average. */
+    prec_t state_fixed_average(long stateid, const numvec& valuefunction, prec_t discount, ActionId actionid) const;
+    /** Value of a fixed action and outcome. See SAState::fixed_fixed. */
+    prec_t state_fixed_fixed(long stateid, const numvec& valuefunction, prec_t discount, ActionId actionid, const OutcomeId& outcomeid) const;
+
+    /** Computes the outcome of an action for the type of uncertainty. See craam::action_value. */
+    template<Uncertainty type>
+    pair<OutcomeId,prec_t> action_value(size_t actionindex, const numvec& valuefunction, prec_t discount) const;
+    /** Computes the Bellman update for the state and the type of uncertainty. See craam::state_value. */
+    template<Uncertainty type>
+    prec_t state_value(long stateid, const numvec& valuefunction, prec_t discount,
+                       ActionId& actionid, OutcomeId& outcomeid) const;
+    /** Value of a fixed action and outcome for the type of uncertainty. See craam::state_value_fixed. */
+    template<Uncertainty type>
+    prec_t state_value_fixed(long stateid, const numvec& valuefunction, prec_t discount,
+                             ActionId actionid, const OutcomeId& outcomeid) const;
+
+    /** Value iteration specialized for the type of uncertainty. See vi_gs. */
+    template<Uncertainty type>
+    SolType vi_gs_t(prec_t discount, numvec valuefunction, unsigned long iterations, prec_t maxresidual) const;
+    /** Jacobi value iteration specialized for the type of uncertainty. See vi_jac. */
+    template<Uncertainty type>
+    SolType vi_jac_t(prec_t discount, const numvec& valuefunction, unsigned long iterations, prec_t maxresidual,
+                     size_t anderson_history) const;
+    /** Modified policy iteration specialized for the type of uncertainty. See mpi_jac. */
+    template<Uncertainty type>
+    SolType mpi_jac_t(prec_t discount, const numvec& valuefunction, unsigned long iterations_pi,
+                      prec_t maxresidual_pi, unsigned long iterations_vi, prec_t maxresidual_vi,
+                      bool show_progress, size_t anderson_history) const;
+};
+
+/**
+Compressed model that stores probabilities and rewards in single precision and
+target states as 32-bit integers. The value functions are still computed in prec_t.
+*/
+template<class SType>
+using CompressedMDPf = CompressedMDP<SType, float, int32_t>;
+
+/**
+Packs the model into contiguous compressed-sparse-row arrays, which makes solving it
+more cache friendly. See CompressedMDP.
+
+The storage types can be specified explicitly, such as freeze<float,int32_t>(mdp),
+to reduce the memory footprint.
+
+\tparam PType Type used to store transition probabilities and rewards
+\tparam IType Type used to store target state indices
+\param mdp Source model; it can be modified after it is frozen without
+            affecting the compressed model
+*/
+template<class PType = prec_t, class IType = long, class SType>
+CompressedMDP<SType,PType,IType> freeze(const GRMDP<SType>& mdp){
+    return CompressedMDP<SType,PType,IType>(mdp);
+}
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "RMDP.hpp"
+
+#include <vector>
+
+#include <mpi.h>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Distributed MDP
+// **************************************************************************************
+
+/**
+An MDP with states sharded among the processes (ranks) of an MPI communicator.
+
+Each rank stores a contiguous block of states with all their actions and outcomes.
+The targets of transitions are renumbered locally: the states of the rank are numbered
+first, followed by the ghost states, which are the states of other ranks reachable
+in one transition. In every sweep of the solvers, each rank receives the values of its
+ghost states from their owners; no other value function entries are communicated.
+Residuals are combined by a global reduction, so all ranks perform the same number of
+iterations.
+
+The solvers must be called collectively by all ranks of the communicator. They
+compute the same Jacobi iterates as GRMDP::vi_jac and GRMDP::mpi_jac, up to the
+rounding errors caused by a different order of summation, and return the complete
+solution on every rank. Each rank may also use OpenMP threads within its block of
+states; see set_schedule.
+*/
+template<class SType>
+class DistributedMDP{
+public:
+    typedef typename GRMDP<SType>::SolType SolType;
+    typedef typename GRMDP<SType>::ActionPolicy ActionPolicy;
+    typedef typename GRMDP<SType>::OutcomePolicy OutcomePolicy;
+
+    /**
+    Shards a model that is available on all ranks. Each rank keeps a block of states
+    with a similar number of states. This is mostly useful for testing; models that do
+    not fit a single process should be constructed from the local blocks.
+    \param mdp Complete model, the same on all ranks
+    \param comm Communicator; it must remain valid for the lifetime of the object
+    */
+    explicit DistributedMDP(const GRMDP<SType>& mdp, MPI_Comm comm = MPI_COMM_WORLD);
+
+    /**
+    Constructs the model from the blocks of states provided by each rank. This
+    constructor must be called collectively by all ranks.
+    \param block States first ... first + block.state_count() - 1 of the complete
+                model; transitions use the global state indices. The blocks of the
+                ranks must be contiguous and ordered by the rank.
+    \param first Global index of the first state of the block
+    \param comm Communicator; it must remain valid for the lifetime of the object
+    */
+    DistributedMDP(const GRMDP<SType>& block, long first, MPI_Comm comm = MPI_COMM_WORLD);
+
+    /** Number of states of the complete model */
+    size_t state_count() const {return firsts.back();};
+
+    /** Number of states stored by this rank */
+    size_t local_state_count() const {return local.state_count();};
+
+    /** Global index of the first state of this rank */
+    long get_first() const {return firsts[rank];};
+
+    /** Number of states of other ranks whose values are received in each sweep */
+    size_t ghost_count() const {return ghosts.size();};
+
+    /** Local model with states and ghosts renumbered from 0 */
+    const GRMDP<SType>& get_local() const {return local;};
+
+    /**
+    Jacobi value iteration. See GRMDP::vi_jac.
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor
+    \param valuefunction Initial value function of the complete model, the same
+                on all ranks. Uses zero if empty.
+    \param iterations Maximal number of iterations
+    \param maxresidual Stop when the global maximal residual falls below this value
+    \returns Solution of the complete model, on all ranks
+    */
+    SolType vi_jac(Uncertainty uncert,
+                   prec_t discount,
+                   const numvec& valuefunction=numvec(0),
+                   unsigned long iterations=MAXITER,
+                   prec_t maxresidual=SOLPREC) const;
+
+    /**
+    Modified policy iteration using Jacobi value iteration in the inner loop.
+    See GRMDP::mpi_jac.
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor
+    \param valuefunction Initial value function of the complete model, the same
+                on all ranks. Uses zero if empty.
+    \param iterations_pi Maximal number of policy iteration steps
+    \param maxresidual_pi Stop when the global Bellman residual falls below this value
+    \param iterations_vi Maximal number of inner loop value iterations
+    \param maxresidual_vi Stop policy evaluation when the global residual falls below
+                this value
+    \returns Solution of the complete model, on all ranks
+    */
+    SolType mpi_jac(Uncertainty uncert,
+                    prec_t discount,
+                    const numvec& valuefunction=numvec(0),
+                    unsigned long iterations_pi=MAXITER,
+                    prec_t maxresidual_pi=SOLPREC,
+                    unsigned long iterations_vi=MAXITER,
+                    prec_t maxresidual_vi=SOLPREC/2) const;
+
+protected:
+    /// Communicator
+    MPI_Comm comm;
+    /// Rank of this process and the number of ranks
+    int rank, ranks;
+    /// Global index of the first state of each rank; the last element is the state count
+    indvec firsts;
+    /// Local states followed by the ghost states
+    GRMDP<SType> local;
+
+    /// Global indices of the ghost states, sorted (and so grouped by the owner)
+    indvec ghosts;
+    /// Number and offsets of the ghost values received from each rank
+    vector<int> recvcounts, recvdispls;
+    /// Local indices of the states whose values are sent to each rank
+    indvec sendstates;
+    /// Number and offsets of the values sent to each rank
+    vector<int> sendcounts, senddispls;
+
+    /**
+    Builds the local model and the communication pattern.
+    \param source Model that contains the states of the block
+    \param offset Index of the first state of the block in the source
+    \param first Global index of the first state of the block
+    \param count Number of states in the block
+    */
+    void initialize(const GRMDP<SType>& source, long offset, long first, long count);
+
+    /** Local value function (states and ghosts) from a global one, or zero if empty */
+    numvec local_values(const numvec& valuefunction) const;
+
+    /** Receives the values of the ghost states from their owners */
+    void exchange(numvec& values) const;
+
+    /** Maximum over all ranks */
+    prec_t max_all(prec_t value) const;
+
+    /** Gathers the solution of the complete model from the local blocks on all ranks */
+    SolType gather(const numvec& values, const ActionPolicy& policy, const OutcomePolicy& outcomes,
+                   prec_t residual, long iterations, long sweeps) const;
+
+    /** Value iteration for a fixed type of uncertainty. See vi_jac. */
+    template<Uncertainty type>
+    SolType vi_jac_t(prec_t discount, const numvec& valuefunction,
+                     unsigned long iterations, prec_t maxresidual) const;
+
+    /** Modified policy iteration for a fixed type of uncertainty. See mpi_jac. */
+    template<Uncertainty type>
+    SolType mpi_jac_t(prec_t discount, const numvec& valuefunction,
+                      unsigned long iterations_pi, prec_t maxresidual_pi,
+                      unsigned long iterations_vi, prec_t maxresidual_vi) const;
+};
+
+}
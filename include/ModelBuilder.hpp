@@ -0,0 +1,114 @@
+#pragma once
+
+#include "definitions.hpp"
+#include "RMDP.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Model builder
+// **************************************************************************************
+
+/**
+Adds many transitions to a model efficiently.
+
+Adding transitions one by one using add_transition grows the vectors of states,
+actions, outcomes, and of each Transition incrementally, which results in many
+reallocations and copies and fragments the heap. The builder instead collects the
+transitions in an arena of large blocks of fixed size, which are never reallocated
+and are released all at once by build or when the builder is destroyed.
+
+The collected transitions are then added to the model together: each action and
+outcome is created only once with its final size, and the exact number of target
+states is reserved in each Transition, so that every vector of the model is allocated
+once. The states are built in parallel.
+
+When the transitions are added grouped by the source state, with non-decreasing
+source state ids (such as when loading a model saved by to_csv), the states are
+built whenever the arena holds flush_size transitions and the blocks are reused.
+The memory used by the builder is then bounded independently of the size of the
+model. Otherwise, all transitions are kept until build is called.
+
+The resulting model is the same as the one constructed by calling add_transition with
+the same arguments in the same order.
+*/
+template<class SType>
+class ModelBuilder{
+public:
+    /** A single transition */
+    struct Sample{
+        long fromid, actionid, outcomeid, toid;
+        prec_t probability, reward;
+    };
+
+    /// Number of samples in each block of the arena (a power of 2)
+    static const size_t block_size = size_t(1) << 16;
+
+    /// Number of samples after which the states are built when the source states are sorted
+    static const size_t flush_size = size_t(1) << 20;
+
+    /**
+    Constructs the builder. The model is only modified by add_transition and build.
+    \param mdp Model to add the transitions to; must remain valid for the lifetime
+                of the builder
+    */
+    explicit ModelBuilder(GRMDP<SType>& mdp) : mdp(mdp), count(0), lastfrom(-1), sorted(true) {};
+
+    /**
+    Adds a transition probability and reward for a particular outcome.
+    See craam::add_transition.
+    \param fromid Starting state ID
+    \param actionid Action ID
+    \param outcomeid Outcome ID
+    \param toid Destination ID
+    \param probability Probability of the transition (must be non-negative)
+    \param reward The reward associated with the transition.
+    */
+    void add_transition(long fromid, long actionid, long outcomeid, long toid, prec_t probability, prec_t reward);
+
+    /** Adds a transition probability and reward for a model with no outcomes */
+    void add_transition(long fromid, long actionid, long toid, prec_t probability, prec_t reward)
+        {add_transition(fromid, actionid, 0l, toid, probability, reward);};
+
+    /**
+    Adds all collected transitions to the model and releases the arena. The builder
+    can be used again afterwards. Transitions that were not built are discarded when
+    the builder is destroyed.
+    */
+    void build();
+
+    /** Allocates blocks for at least the given number of collected transitions */
+    void reserve(size_t samplecount);
+
+    /** Number of collected transitions that have not been built yet */
+    size_t size() const {return count;};
+
+    /** Memory allocated by the arena in bytes */
+    size_t memory() const {return blocks.size() * block_size * sizeof(Sample);};
+
+    /** Returns a collected transition */
+    const Sample& operator[](size_t index) const
+        {return blocks[index / block_size][index % block_size];};
+
+protected:
+    /// Model being built
+    GRMDP<SType>& mdp;
+    /// Blocks of samples; samples after count are unused
+    vector<unique_ptr<Sample[]>> blocks;
+    /// Number of samples
+    size_t count;
+    /// Source state of the last sample added
+    long lastfrom;
+    /// Whether the source states have been non-decreasing
+    bool sorted;
+
+    /** Adds the collected samples to the model and keeps the blocks for reuse */
+    void flush();
+};
+
+}
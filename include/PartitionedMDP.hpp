@@ -0,0 +1,94 @@
+#pragma once
+
+#include "RMDP.hpp"
+
+#include <vector>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Partitioned MDP
+// **************************************************************************************
+
+/**
+A model with states reordered and partitioned among threads for parallel solvers.
+
+The states are reordered by the reverse Cuthill-McKee algorithm (see
+StateGraph::reverse_cuthill_mckee) unless a custom order is provided, so transitions
+mostly lead to states with close indices. With the static schedule of the parallel
+solvers, each thread processes a contiguous slice of states and reads mostly the
+value function entries of its own slice or of its neighbors. The model is copied with
+the same schedule, so the transitions of each slice are first touched by the thread
+that processes them; see GRMDP::permute_states.
+
+The solution methods accept and return value functions and policies indexed by the
+original state indices; the permutation is applied internally.
+*/
+template<class SType>
+class PartitionedMDP{
+public:
+    typedef typename GRMDP<SType>::SolType SolType;
+    typedef typename GRMDP<SType>::ActionPolicy ActionPolicy;
+    typedef typename GRMDP<SType>::OutcomePolicy OutcomePolicy;
+
+    /** Reorders the states of the model using the reverse Cuthill-McKee algorithm */
+    explicit PartitionedMDP(const GRMDP<SType>& mdp);
+
+    /**
+    Reorders the states in the provided order.
+    \param mdp Model
+    \param order Permutation: order[i] is the original index of the new state i
+    */
+    PartitionedMDP(const GRMDP<SType>& mdp, const indvec& order);
+
+    /** Reordered model */
+    const GRMDP<SType>& get_model() const {return model;};
+
+    /** Order of states: order[i] is the original index of state i in the reordered model */
+    const indvec& get_order() const {return order;};
+
+    /** Inverse order: the index in the reordered model of each original state */
+    const indvec& get_inverse() const {return inverse;};
+
+    /** Number of states */
+    size_t state_count() const {return model.state_count();};
+
+    /** Jacobi value iteration. See GRMDP::vi_jac. */
+    SolType vi_jac(Uncertainty uncert,
+                   prec_t discount,
+                   const numvec& valuefunction=numvec(0),
+                   unsigned long iterations=MAXITER,
+                   prec_t maxresidual=SOLPREC,
+                   size_t anderson_history=0) const;
+
+    /** Modified policy iteration. See GRMDP::mpi_jac. */
+    SolType mpi_jac(Uncertainty uncert,
+                    prec_t discount,
+                    const numvec& valuefunction=numvec(0),
+                    unsigned long iterations_pi=MAXITER,
+                    prec_t maxresidual_pi=SOLPREC,
+                    unsigned long iterations_vi=MAXITER,
+                    prec_t maxresidual_vi=SOLPREC/2,
+                    bool show_progress=false,
+                    size_t anderson_history=0) const;
+
+    /** Jacobi policy evaluation for a fixed policy and nature. See GRMDP::vi_jac_fix. */
+    SolType vi_jac_fix(prec_t discount,
+                       const ActionPolicy& policy,
+                       const OutcomePolicy& natpolicy,
+                       const numvec& valuefunction=numvec(0),
+                       unsigned long iterations=MAXITER,
+                       prec_t maxresidual=SOLPREC) const;
+
+protected:
+    /// Reordered model
+    GRMDP<SType> model;
+    /// order[i] is the original index of the state i
+    indvec order;
+    /// inverse[s] is the index of the original state s in the reordered model
+    indvec inverse;
+};
+
+}
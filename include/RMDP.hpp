@@ -1,6 +1,8 @@
 #pragma once
 
 #include "State.hpp"
+#include "SparseMatrix.hpp"
+#include "parallel.hpp"
 
 #include <vector>
 #include <istream>
@@ -8,6 +10,7 @@
 #include <memory>
 #include <tuple>
 #include <cassert>
+#include <limits>
 
 #include <boost/numeric/ublas/matrix.hpp>
 
@@ -31,6 +34,169 @@ enum class Uncertainty {
     Average = 2
 };
 
+// **************************************************************************************
+//  Bellman updates specialized for the type of uncertainty
+// **************************************************************************************
+
+/**
+Computes the value of an action for the type of uncertainty. The type of uncertainty is
+a template parameter and therefore the choice of the action's method is resolved at
+compile time.
+
+\tparam type Type of realization of the uncertainty
+\param action Action to evaluate
+\param valuefunction Value function
+\param discount Discount factor
+\return Outcome (default for the average) and the value of the action
+*/
+template<Uncertainty type, class AType>
+inline pair<typename AType::OutcomeId,prec_t>
+action_value(const AType& action, const numvec& valuefunction, prec_t discount){
+    switch(type){
+    case Uncertainty::Robust:
+        return action.minimal(valuefunction, discount);
+    case Uncertainty::Optimistic:
+        return action.maximal(valuefunction, discount);
+    default: // Uncertainty::Average
+        return make_pair(typename AType::OutcomeId(), action.average(valuefunction, discount));
+    }
+}
+
+/**
+Computes the value of an action for the type of uncertainty and stores the outcome in
+the provided variable. See action_value.
+\param outcome Set to the outcome (default for the average)
+\return Value of the action
+*/
+template<Uncertainty type, class AType>
+inline prec_t action_value(const AType& action, const numvec& valuefunction, prec_t discount,
+                           typename AType::OutcomeId& outcome){
+    auto value = action_value<type>(action, valuefunction, discount);
+    outcome = move(value.first);
+    return value.second;
+}
+
+/**
+Computes the value of an action with a distribution over outcomes. The distribution is
+written to the provided vector, which reuses its memory, so the computation does not
+allocate in the steady state.
+\param outcome Set to the distribution of nature (empty for the average)
+\return Value of the action
+*/
+template<Uncertainty type, NatureConstr nature>
+inline prec_t action_value(const WeightedOutcomeAction<nature>& action, const numvec& valuefunction,
+                           prec_t discount, numvec& outcome){
+    switch(type){
+    case Uncertainty::Robust:
+        return action.minimal(valuefunction, discount, outcome);
+    case Uncertainty::Optimistic:
+        return action.maximal(valuefunction, discount, outcome);
+    default: // Uncertainty::Average
+        outcome.clear();
+        return action.average(valuefunction, discount);
+    }
+}
+
+/**
+Computes the Bellman update for a state and the type of uncertainty. This is equivalent
+to SAState::max_min, SAState::max_max, or SAState::max_average, except that the choice
+is made at compile time and the optimal action and outcome are written directly
+to the arguments.
+
+When there are no actions then the return is assumed to be 0.
+
+\tparam type Type of realization of the uncertainty
+\param state State to update
+\param valuefunction Value function
+\param discount Discount factor
+\param actionid Set to the index of the optimal action (-1 if terminal)
+\param outcomeid Set to the optimal outcome
+\return Value of the state
+*/
+template<Uncertainty type, class SType>
+inline prec_t state_value(const SType& state, const numvec& valuefunction, prec_t discount,
+                          typename SType::ActionId& actionid, typename SType::OutcomeId& outcomeid){
+    prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+    actionid = -1;
+
+    // the outcome of the evaluated action; swapped with the best one to reuse memory
+    static thread_local typename SType::OutcomeId candidate;
+
+    const auto& actions = state.get_actions();
+    for(size_t i = 0; i < actions.size(); i++){
+        const auto& action = actions[i];
+
+        // skip invalid actions
+        if(!action.is_valid()) continue;
+
+        const prec_t value = action_value<type>(action, valuefunction, discount, candidate);
+        if(value > maxvalue){
+            maxvalue = value;
+            actionid = i;
+            swap(outcomeid, candidate);
+        }
+    }
+
+    // terminal state or no valid actions
+    if(actionid < 0)
+        outcomeid = typename SType::OutcomeId();
+
+    return state.is_terminal() ? 0 : maxvalue;
+}
+
+/**
+Computes the value of a fixed action (and outcome) for the type of uncertainty.
+The outcome is ignored for the average. See SAState::fixed_fixed and SAState::fixed_average.
+*/
+template<Uncertainty type, class SType>
+inline prec_t state_value_fixed(const SType& state, const numvec& valuefunction, prec_t discount,
+                                typename SType::ActionId actionid,
+                                const typename SType::OutcomeId& outcomeid){
+    if(type == Uncertainty::Average)
+        return state.fixed_average(valuefunction, discount, actionid);
+    else
+        return state.fixed_fixed(valuefunction, discount, actionid, outcomeid);
+}
+
+// **************************************************************************************
+//  Permutations of states
+// **************************************************************************************
+
+/**
+Reorders a vector indexed by states to a new order of states.
+\param values Values indexed by the original states
+\param order Permutation: order[i] is the original index of the new state i
+\returns result[i] = values[order[i]]; empty if values is empty
+*/
+template<class T>
+inline vector<T> permute_vector(const vector<T>& values, const indvec& order){
+    if(values.empty()) return values;
+    if(values.size() != order.size())
+        throw invalid_argument("The size of the vector must match the permutation.");
+    vector<T> result(values.size());
+    for(size_t i = 0; i < order.size(); i++)
+        result[i] = values[order[i]];
+    return result;
+}
+
+/**
+Restores the original order of a vector indexed by reordered states. The inverse
+of permute_vector.
+\param values Values indexed by the new states
+\param order Permutation: order[i] is the original index of the new state i
+\returns result[order[i]] = values[i]; empty if values is empty
+*/
+template<class T>
+inline vector<T> restore_vector(const vector<T>& values, const indvec& order){
+    if(values.empty()) return values;
+    if(values.size() != order.size())
+        throw invalid_argument("The size of the vector must match the permutation.");
+    vector<T> result(values.size());
+    for(size_t i = 0; i < order.size(); i++)
+        result[order[i]] = values[i];
+    return result;
+}
+
 // **************************************************************************************
 //  Generic MDP Class
 // **************************************************************************************
@@ -44,15 +210,20 @@ public:
     vector<OutcomeId> outcomes;                      // index of the outcome for each state
     prec_t residual;
     long iterations;
+    /// Number of passes over the transitions of all states (Bellman updates and policy
+    /// evaluation steps); -1 if not reported by the solver
+    long sweeps;
 
     GSolution():
         valuefunction(0), policy(0), outcomes(0),
-        residual(-1),iterations(-1) {};
+        residual(-1),iterations(-1),sweeps(-1) {};
 
-    GSolution(numvec const& valuefunction, const vector<ActionId>& policy,
-             const vector<OutcomeId>& outcomes, prec_t residual = -1, long iterations = -1) :
-        valuefunction(valuefunction), policy(policy), outcomes(outcomes),
-        residual(residual),iterations(iterations) {};
+    /** The vectors are moved when passed as rvalues, which solvers use to avoid copies */
+    GSolution(numvec valuefunction, vector<ActionId> policy,
+             vector<OutcomeId> outcomes, prec_t residual = -1, long iterations = -1,
+             long sweeps = -1) :
+        valuefunction(move(valuefunction)), policy(move(policy)), outcomes(move(outcomes)),
+        residual(residual),iterations(iterations),sweeps(sweeps) {};
 
     /**
     Computes the total return of the solution given the initial
@@ -67,6 +238,26 @@ public:
             throw invalid_argument("Too many indexes in the initial distribution.");
         return initial.compute_value(valuefunction);
     };
+
+    /**
+    Reorders the value function and the policies to a new order of states.
+    See GRMDP::permute_states.
+    \param order Permutation: order[i] is the original index of the new state i
+    */
+    GSolution permute(const indvec& order) const{
+        return GSolution(permute_vector(valuefunction, order), permute_vector(policy, order),
+                         permute_vector(outcomes, order), residual, iterations, sweeps);
+    };
+
+    /**
+    Restores the original order of states in a solution computed for a model returned
+    by GRMDP::permute_states or GRMDP::reorder_states.
+    \param order Permutation: order[i] is the original index of the new state i
+    */
+    GSolution restore_order(const indvec& order) const{
+        return GSolution(restore_vector(valuefunction, order), restore_vector(policy, order),
+                         restore_vector(outcomes, order), residual, iterations, sweeps);
+    };
 };
 
 /**
@@ -120,6 +311,31 @@ public:
     /** Constructs an empty RMDP. */
     GRMDP(){};
 
+    /**
+    Constructs the RMDP from transitions given as columns. See add_transitions.
+    */
+    GRMDP(const indvec& idstatefrom, const indvec& idaction, const indvec& idoutcome,
+          const indvec& idstateto, const numvec& probabilities, const numvec& rewards){
+        add_transitions(idstatefrom, idaction, idoutcome, idstateto, probabilities, rewards);
+    };
+
+    /**
+    Adds many transitions at once. The transition i goes from the state idstatefrom[i]
+    under the action idaction[i] and the outcome idoutcome[i] to idstateto[i] with the
+    probability probabilities[i] and the reward rewards[i].
+
+    The model is the same as when adding the transitions one by one with add_transition
+    in the order of the columns. But the transitions are first sorted in parallel and
+    each Transition is then constructed in a single pass, which avoids the insertions
+    in the middle of Transition when the input is not sorted. The model is not modified
+    when the input is invalid.
+
+    Throws an invalid_argument exception when the columns have different sizes, an id
+    is negative, or a probability is negative (as in Transition::add_sample).
+    */
+    void add_transitions(const indvec& idstatefrom, const indvec& idaction, const indvec& idoutcome,
+                         const indvec& idstateto, const numvec& probabilities, const numvec& rewards);
+
     /**
     Assures that the MDP state exists and if it does not, then it is created.
     States with intermediate ids are also created
@@ -168,9 +384,48 @@ public:
     /** Normalize all transitions to sum to one for all states, actions, outcomes. */
     void normalize();
 
+    /**
+    Constructs a model with the states permuted. The state i of the result is the state
+    order[i] of this model and all transitions are remapped to the new indices. Actions
+    and outcomes are not changed, so policies of the new model are obtained by
+    permuting their elements; see GSolution::permute and GSolution::restore_order.
+
+    The states are copied in parallel with the static OpenMP schedule of the Jacobi
+    solvers, so each thread allocates (first touches) the transitions of the states
+    that it later processes.
+    \param order Permutation: order[i] is the original index of the new state i
+    \returns Permuted model
+    */
+    GRMDP permute_states(const indvec& order) const;
+
+    /**
+    Renumbers the states so that the transitions mostly lead to states with close
+    indices, which improves the locality of value function accesses in the Bellman
+    updates. The order is computed by the reverse Cuthill-McKee algorithm on the
+    graph of transitions (see StateGraph::reverse_cuthill_mckee).
+
+    Any solver can be used with the reordered model; solutions are translated back
+    using GSolution::restore_order and the returned permutation.
+    \returns The reordered model and the permutation: order[i] is the original index
+              of the new state i
+    */
+    pair<GRMDP,indvec> reorder_states() const;
+
+    /**
+    Estimates the cost of the Bellman update of each state as the number of its
+    actions plus the number of transitions (nonzero probabilities) of all outcomes.
+    Used to balance the parallel solvers; see set_schedule.
+    */
+    indvec state_costs() const;
+
+    /** Partition of states for the parallel loops with the schedule set by set_schedule */
+    StateBlocks state_blocks() const;
+
     /**
     Computes occupancy frequencies using matrix representation of transition
-    probabilities. This method does not scale to larger state spaces
+    probabilities. The dense LU decomposition does not scale to larger state spaces;
+    when the number of states exceeds OFREQ_DENSE_MAXSTATES, the frequencies are
+    computed by ofreq_iter with the precision OFREQ_PREC instead.
     \param init Initial distribution (alpha)
     \param discount Discount factor (gamma)
     \param policy Policy of the decision maker
@@ -179,6 +434,24 @@ public:
     numvec ofreq_mat(const Transition& init, prec_t discount,
                      const ActionPolicy& policy, const OutcomePolicy& nature) const;
 
+    /**
+    Computes occupancy frequencies iteratively using a sparse representation
+    of the transposed transition matrix. The frequencies d solve
+    \f[ d = \alpha + \gamma P^T d \f]
+    and are computed by Jacobi iteration parallelized with OpenMP.
+    The time per iteration is linear in the number of nonzero transitions.
+    \param init Initial distribution (alpha)
+    \param discount Discount factor (gamma); must be smaller than 1 for convergence
+    \param policy Policy of the decision maker
+    \param nature Policy of nature
+    \param iterations Maximal number of iterations
+    \param maxresidual Stop when the maximal change in the frequencies drops
+            below this threshold
+    */
+    numvec ofreq_iter(const Transition& init, prec_t discount,
+                      const ActionPolicy& policy, const OutcomePolicy& nature,
+                      unsigned long iterations=MAXITER, prec_t maxresidual=OFREQ_PREC) const;
+
     /**
     Constructs the rewards vector for each state for the RMDP.
     \param policy Policy of the decision maker
@@ -221,19 +494,56 @@ public:
                   unsigned long iterations=MAXITER,
                   prec_t maxresidual=SOLPREC) const;
 
+    /**
+    Parallel asynchronous (chaotic) Gauss-Seidel value iteration. The threads update a
+    single shared value function in place, each in its block of states (see
+    set_schedule), and always use the most recent values written by any thread. The
+    values of states of other threads may be read before or after their update in the
+    same sweep, so the iterates depend on the timing of the threads, but the method
+    converges under the same conditions as vi_gs. With a single thread it computes
+    exactly the iterates of vi_gs.
+
+    The sweeps are separated by a barrier. The residual of a sweep is the maximal change
+    of a state value in the sweep, which is written only by the thread that owns the
+    state, so the convergence check does not depend on the timing. The values are
+    shared through relaxed OpenMP atomic reads and writes: before each update, the
+    thread copies the values of the successors of the state into its private copy of the
+    value function (one per thread, which uses additional memory).
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor.
+    \param valuefunction Initial value function. Passed by value, because it is modified.
+    \param iterations Maximal number of sweeps
+    \param maxresidual Stop when the maximal change in a sweep falls below this value.
+     */
+    SolType vi_gs_async(Uncertainty uncert,
+                        prec_t discount,
+                        numvec valuefunction=numvec(0),
+                        unsigned long iterations=MAXITER,
+                        prec_t maxresidual=SOLPREC) const;
+
     /**
     Jacobi variant of value iteration. This method uses OpenMP to parallelize the computation.
+
+    The iterations can be accelerated by Anderson mixing (see craam::AndersonAcceleration),
+    which extrapolates the next value function from the last anderson_history updates.
+    When the residual exceeds twice the smallest residual since the history was last
+    discarded, the history is discarded and the plain update is used.
+    The acceleration can significantly reduce the number of iterations when the discount
+    factor is close to 1.
     \param uncert Type of realization of the uncertainty
     \param valuefunction Initial value function.
     \param discount Discount factor.
     \param iterations Maximal number of iterations to run
     \param maxresidual Stop when the maximal residual falls below this value.
+    \param anderson_history Number of previous iterations used by Anderson acceleration;
+                0 disables the acceleration
      */
     SolType vi_jac(Uncertainty uncert,
                    prec_t discount,
                    const numvec& valuefunction=numvec(0),
                     unsigned long iterations=MAXITER,
-                    prec_t maxresidual=SOLPREC) const;
+                    prec_t maxresidual=SOLPREC,
+                    size_t anderson_history=0) const;
 
     /**
     Modified policy iteration using Jacobi value iteration in the inner loop.
@@ -250,6 +560,8 @@ public:
     \param maxresidual_vi Stop the inner policy iteration when the residual drops below this threshold.
                 This value should be smaller than maxresidual_pi
     \param show_progress Whether to report on progress during the computation
+    \param anderson_history Number of previous iterations used by Anderson acceleration
+                of the inner loop (see vi_jac); 0 disables the acceleration
     \return Computed (approximate) solution
      */
     SolType mpi_jac(Uncertainty uncert,
@@ -259,8 +571,158 @@ public:
                     prec_t maxresidual_pi=SOLPREC,
                     unsigned long iterations_vi=MAXITER,
                     prec_t maxresidual_vi=SOLPREC/2,
+                    bool show_progress=false,
+                    size_t anderson_history=0) const;
+
+    /**
+    Policy iteration with an exact policy evaluation. The value of each policy is
+    computed by solving the sparse linear system
+    \f[ (I - \gamma P_\pi) v = r_\pi \f]
+    using BiCGSTAB with a Jacobi preconditioner (see craam::bicgstab). The linear
+    solve is warm-started from the current value function.
+
+    For the average uncertainty, the transitions and rewards are averaged over the outcomes
+    in the same way as in the average method of the actions. For the robust and optimistic
+    uncertainty, both the action and the outcome are fixed in the evaluation step, as in
+    mpi_jac.
+
+    The method needs far fewer evaluations than mpi_jac when the discount factor is close
+    to one, but the convergence of the robust variant is not guaranteed in general.
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor
+    \param valuefunction Initial value function
+    \param iterations_pi Maximal number of policy iteration steps
+    \param maxresidual_pi Stop the policy iteration when the Bellman residual drops below this threshold
+    \param iterations_lin Maximal number of iterations of the linear solver in each step
+    \param maxresidual_lin Stop the linear solver when the maximal absolute residual of
+                the linear system drops below this threshold
+    \param show_progress Whether to report on progress during the computation
+    \return Computed (approximate) solution
+    */
+    SolType pi_bicg(Uncertainty uncert,
+                    prec_t discount,
+                    const numvec& valuefunction=numvec(0),
+                    unsigned long iterations_pi=MAXITER,
+                    prec_t maxresidual_pi=SOLPREC,
+                    unsigned long iterations_lin=MAXITER,
+                    prec_t maxresidual_lin=SOLPREC/10,
                     bool show_progress=false) const;
 
+    /**
+    Value iteration by strongly connected components of the state graph (see
+    craam::StateGraph). The components are solved in the reverse topological order,
+    running Gauss-Seidel value iteration only within each component until its residual
+    falls below maxresidual. Components that consist of a single state without a
+    self-loop are solved by a single Bellman update; a model with an acyclic state graph
+    is therefore solved exactly in a single pass over the states.
+
+    Components that do not depend on each other (with the same level) are solved in
+    parallel using OpenMP.
+
+    The returned number of iterations is the maximal number of sweeps over any
+    component and the residual is the maximal final residual of any component.
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor.
+    \param valuefunction Initial value function. Passed by value, because it is modified.
+    \param iterations Maximal number of iterations to run in each component
+    \param maxresidual Stop when the maximal residual in the component falls below this value.
+     */
+    SolType vi_scc(Uncertainty uncert,
+                   prec_t discount,
+                   numvec valuefunction=numvec(0),
+                   unsigned long iterations=MAXITER,
+                   prec_t maxresidual=SOLPREC) const;
+
+    /**
+    Jacobi value iteration with MacQueen bounds and elimination of suboptimal actions;
+    parallelized with OpenMP.
+
+    Let \f$ d = v_{n+1} - v_n \f$ be the change in an iteration. The optimal value function
+    is bounded by
+    \f[ v_{n+1} + \frac{\gamma}{1-\gamma} \min d \le v^\star \le v_{n+1} + \frac{\gamma}{1-\gamma} \max d ~. \f]
+    An action a in a state s cannot be optimal when
+    \f[ v_{n+1}(s) - q_n(s,a) > \frac{\gamma}{1-\gamma} (\max d - \min d) ~, \f]
+    where \f$ q_n(s,a) \f$ is the value of the action computed from \f$ v_n \f$. Such actions
+    are eliminated permanently and skipped in the subsequent iterations, which makes the
+    iterations much cheaper in states with many actions.
+
+    The iteration stops when the span seminorm \f$ \max d - \min d \f$ falls below maxresidual.
+    The returned value function is the midpoint of the bounds, which is within
+    \f$ \gamma / (1-\gamma) \cdot \mathrm{span}(d) / 2 \f$ of the optimal value function.
+    The span is returned as the residual.
+
+    The bounds hold for all types of uncertainty, but require that the transition
+    probabilities of all actions (and outcomes) sum to 1. Terminal states are allowed.
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor; must be smaller than 1
+    \param valuefunction Initial value function.
+    \param iterations Maximal number of iterations to run
+    \param maxresidual Stop when the span of the change in the value function falls below this value.
+     */
+    SolType vi_jac_ae(Uncertainty uncert,
+                      prec_t discount,
+                      const numvec& valuefunction=numvec(0),
+                      unsigned long iterations=MAXITER,
+                      prec_t maxresidual=SOLPREC) const;
+
+    /**
+    Jacobi value iteration that solves k related problems at once. The problems differ
+    in the discount factor and/or in rewards added to the transitions. This is useful
+    for sensitivity analysis.
+
+    The k value functions are stored together, so each transition is read once per
+    iteration and its values for all problems are computed by a small dense kernel
+    (see craam::sparse_value_batch). This is much faster than k separate calls of
+    vi_jac, which are limited by the memory bandwidth.
+
+    When one of discounts and rewards has a single element and the other one has k, the single
+    element is used in all problems. The iterations continue until the residuals of
+    all problems fall below maxresidual. The outcomes of uncertain models are computed
+    independently for each problem; the caching of the order of outcomes is not used.
+    \param uncert Type of realization of the uncertainty
+    \param discounts Discount factors of the problems
+    \param rewards Rewards added to all transitions to each target state: rewards[j][s]
+                is added to transitions to state s in problem j. Empty when no rewards
+                are added.
+    \param iterations Maximal number of iterations to run
+    \param maxresidual Stop when the maximal residual of all problems falls below this value.
+    \return Solutions for each problem; the residual of each solution is its own
+     */
+    vector<SolType> vi_jac_batch(Uncertainty uncert,
+                                 const numvec& discounts,
+                                 const vector<numvec>& rewards=vector<numvec>(0),
+                                 unsigned long iterations=MAXITER,
+                                 prec_t maxresidual=SOLPREC) const;
+
+    /**
+    Asynchronous value iteration with prioritized sweeping (not parallelized).
+
+    The method keeps a priority queue of states keyed by an upper bound on their Bellman
+    residual. The bounds are initialized by computing the residuals of all states. The
+    state with the largest bound is backed up next, and when its value changes by
+    \f$ \delta \f$, the bounds of its predecessors (see craam::StateGraph) increase by
+    \f$ \gamma \delta \f$. States whose successors did not change are never backed up again.
+
+    The computation stops when the bounds on the residuals of all states fall below
+    maxresidual, which guarantees that the Bellman residual of the returned value
+    function is at most maxresidual. The method is particularly efficient when warm-started
+    from the solution of a model that differs only in a few states.
+
+    The number of iterations in the returned solution is the total number of backups of
+    individual states, including the initial computation of the residuals. Its
+    residual is the final bound on the Bellman residual.
+    \param uncert Type of realization of the uncertainty
+    \param discount Discount factor.
+    \param valuefunction Initial value function. Passed by value, because it is modified.
+    \param maxbackups Maximal number of backups; 0 means MAXITER times the number of states
+    \param maxresidual Stop when the bound on the residual falls below this value.
+     */
+    SolType vi_ps(Uncertainty uncert,
+                  prec_t discount,
+                  numvec valuefunction=numvec(0),
+                  unsigned long maxbackups=0,
+                  prec_t maxresidual=SOLPREC) const;
+
     /**
     Value function evaluation using Jacobi iteration for a fixed policy.
     and nature.
@@ -318,6 +780,25 @@ public:
         transition_mat_t(const ActionPolicy& policy,
                          const OutcomePolicy& nature) const;
 
+    /**
+    Constructs the sparse transition matrix for the policy. Rows of terminal
+    states are empty. The matrix is constructed in parallel with OpenMP and
+    its size is linear in the number of nonzero transitions.
+    \param policy Policy of the decision maker
+    \param nature Policy of the nature
+    */
+    SparseMatrix transition_mat_sparse(const ActionPolicy& policy,
+                                       const OutcomePolicy& nature) const;
+
+    /**
+    Constructs a transpose of the sparse transition matrix for the policy. This is
+    also the compressed sparse column representation of the transition matrix.
+    \param policy Policy of the decision maker
+    \param nature Policy of the nature
+    */
+    SparseMatrix transition_mat_sparse_t(const ActionPolicy& policy,
+                                         const OutcomePolicy& nature) const;
+
     // ----------------------------------------------
     // Reading and writing files
     // ----------------------------------------------
@@ -335,18 +816,41 @@ public:
 
     Note that outcome distributions are not saved.
 
+    The output is formatted in a memory buffer (see OutputBuffer) and the numbers are
+    written with as many digits as needed to be read back exactly.
+
     \param output Output for the stream
     \param header Whether the header should be written as the
           first line of the file represents the header.
+    \param parallel Whether to format the states in parallel
     */
-    void to_csv(ostream& output, bool header = true) const;
+    void to_csv(ostream& output, bool header = true, bool parallel = false) const;
 
     /**
-    Saves the transition probabilities and rewards to a CSV file
+    Saves the transition probabilities and rewards to a CSV file. The file is
+    compressed by gzip when its name ends with .gz (see open_output_file).
+    Throws an invalid_argument exception when the file cannot be written.
     \param filename Name of the file
     \param header Whether to create a header of the file too
+    \param parallel Whether to format the states in parallel
      */
-    void to_csv_file(const string& filename, bool header = true) const;
+    void to_csv_file(const string& filename, bool header = true, bool parallel = false) const;
+
+    /**
+    Saves the model to a binary file, which is much faster to load than a csv file.
+    The file also includes thresholds and outcome distributions. See
+    CompressedMDP::to_binary_file for the format.
+    \param filename Name of the file
+    */
+    void to_binary_file(const string& filename) const;
+
+    /**
+    Loads a model saved by to_binary_file. Use CompressedMDP::from_binary_file
+    to solve the model directly from the memory-mapped file without constructing
+    a GRMDP.
+    \param filename Name of the file
+    */
+    static GRMDP from_binary_file(const string& filename);
 
     // string representation
     /**
@@ -357,9 +861,81 @@ public:
 
     /**
     Returns a json representation of the RMDP.
-    This method is mostly suitable to analyzing small RMDPs.
+    This method is mostly suitable to analyzing small RMDPs; use the
+    streaming version for large ones.
     */
     string to_json() const;
+
+    /**
+    Writes a json representation of the RMDP to the stream without constructing
+    it in memory. See to_csv for the formatting.
+    \param output Output for the stream
+    \param parallel Whether to format the states in parallel
+    */
+    void to_json(ostream& output, bool parallel = false) const;
+
+protected:
+    /** Gauss-Seidel value iteration for a fixed type of uncertainty. See vi_gs. */
+    template<Uncertainty type>
+    SolType vi_gs_t(prec_t discount, numvec valuefunction,
+                    unsigned long iterations, prec_t maxresidual) const;
+
+    /** Asynchronous Gauss-Seidel value iteration for a fixed type of uncertainty. See vi_gs_async. */
+    template<Uncertainty type>
+    SolType vi_gs_async_t(prec_t discount, numvec valuefunction,
+                          unsigned long iterations, prec_t maxresidual) const;
+
+    /** Jacobi value iteration for a fixed type of uncertainty. See vi_jac. */
+    template<Uncertainty type>
+    SolType vi_jac_t(prec_t discount, const numvec& valuefunction,
+                     unsigned long iterations, prec_t maxresidual,
+                     size_t anderson_history) const;
+
+    /** Modified policy iteration for a fixed type of uncertainty. See mpi_jac. */
+    template<Uncertainty type>
+    SolType mpi_jac_t(prec_t discount, const numvec& valuefunction,
+                      unsigned long iterations_pi, prec_t maxresidual_pi,
+                      unsigned long iterations_vi, prec_t maxresidual_vi,
+                      bool show_progress, size_t anderson_history) const;
+
+    /** Policy iteration for a fixed type of uncertainty. See pi_bicg. */
+    template<Uncertainty type>
+    SolType pi_bicg_t(prec_t discount, const numvec& valuefunction,
+                      unsigned long iterations_pi, prec_t maxresidual_pi,
+                      unsigned long iterations_lin, prec_t maxresidual_lin,
+                      bool show_progress) const;
+
+    /** Value iteration by components for a fixed type of uncertainty. See vi_scc. */
+    template<Uncertainty type>
+    SolType vi_scc_t(prec_t discount, numvec valuefunction,
+                     unsigned long iterations, prec_t maxresidual) const;
+
+    /** Value iteration with action elimination for a fixed type of uncertainty. See vi_jac_ae. */
+    template<Uncertainty type>
+    SolType vi_jac_ae_t(prec_t discount, const numvec& valuefunction,
+                        unsigned long iterations, prec_t maxresidual) const;
+
+    /** Batched value iteration for a fixed type of uncertainty. See vi_jac_batch. */
+    template<Uncertainty type>
+    vector<SolType> vi_jac_batch_t(const numvec& discounts, const vector<numvec>& rewards,
+                                   unsigned long iterations, prec_t maxresidual) const;
+
+    /** Prioritized sweeping for a fixed type of uncertainty. See vi_ps. */
+    template<Uncertainty type>
+    SolType vi_ps_t(prec_t discount, numvec valuefunction,
+                    unsigned long maxbackups, prec_t maxresidual) const;
+
+    /**
+    Constructs the sparse transition matrix and the rewards for the policy. Rows
+    of terminal states and states with no action (-1) are empty and their rewards are 0.
+    \param policy Policy of the decision maker
+    \param nature Policy of the nature; ignored when average is true
+    \param average Whether to average the transitions over outcomes (see the average
+            method of actions) instead of using the nature's policy
+    \param rewards Output vector of the expected rewards; resized to the number of states
+    */
+    SparseMatrix policy_transitions(const ActionPolicy& policy, const OutcomePolicy& nature,
+                                    bool average, numvec& rewards) const;
 };
 
 // **********************************************************************
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "definitions.hpp"
+
+#include <vector>
+#include <utility>
+
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+
+namespace craam {
+
+using namespace std;
+using namespace boost::numeric;
+
+// **************************************************************************************
+//  Sparse matrix
+// **************************************************************************************
+
+/**
+A sparse matrix in the compressed sparse row (CSR) format. Nonzero elements of row i are
+stored in [row_offsets[i], row_offsets[i+1]) of the arrays columns and values. The
+column indices within each row are sorted.
+
+A compressed sparse column (CSC) representation of a matrix is the CSR representation
+of its transpose; see transpose.
+
+The matrix is used to represent transition probabilities for a fixed policy and
+its memory requirements are linear in the number of nonzero transitions.
+*/
+class SparseMatrix{
+public:
+    /** Constructs an empty 0x0 matrix */
+    SparseMatrix() : rowcount(0), colcount(0), row_offsets(1,0), columns(0), values(0) {};
+
+    /**
+    Constructs the matrix from the CSR arrays. Throws an invalid_argument exception
+    when the arrays are inconsistent.
+    \param rows Number of rows
+    \param cols Number of columns
+    \param row_offsets Offsets of rows in columns and values, size rows + 1
+    \param columns Column indices of nonzero elements
+    \param values Nonzero elements
+    */
+    SparseMatrix(size_t rows, size_t cols, vector<size_t> row_offsets,
+                 indvec columns, numvec values);
+
+    /** Constructs the matrix from a ublas compressed matrix */
+    SparseMatrix(const ublas::compressed_matrix<prec_t>& matrix);
+
+    /** Number of rows */
+    size_t rows() const {return rowcount;};
+    /** Number of columns */
+    size_t cols() const {return colcount;};
+    /** Number of stored elements */
+    size_t nonzero_count() const {return values.size();};
+
+    /** Offsets of rows in the arrays of columns and values */
+    const vector<size_t>& get_row_offsets() const {return row_offsets;};
+    /** Column indices of stored elements */
+    const indvec& get_columns() const {return columns;};
+    /** Values of stored elements */
+    const numvec& get_values() const {return values;};
+
+    /** Returns the element at the row and column; 0 if it is not stored */
+    prec_t get(size_t row, size_t col) const;
+
+    /** Returns the transposed matrix (or equivalently the CSC representation of this matrix) */
+    SparseMatrix transpose() const;
+
+    /** Computes the product of the matrix and a vector, parallelized with OpenMP */
+    numvec multiply(const numvec& x) const;
+
+    /** Computes the product of the matrix and a vector into an existing vector of size rows */
+    void multiply(const numvec& x, numvec& result) const;
+
+    /** Returns the diagonal of a square matrix */
+    numvec diagonal() const;
+
+    /**
+    Computes I - scale * A for a square matrix A. The diagonal elements are added
+    to the rows where they are missing.
+    */
+    SparseMatrix identity_minus(prec_t scale) const;
+
+    /** Converts to a ublas compressed (row-major) matrix */
+    ublas::compressed_matrix<prec_t> to_ublas() const;
+
+protected:
+    /// Number of rows
+    size_t rowcount;
+    /// Number of columns
+    size_t colcount;
+    /// Offsets of rows in columns and values (size rows + 1)
+    vector<size_t> row_offsets;
+    /// Column indices of the stored elements
+    indvec columns;
+    /// Stored elements
+    numvec values;
+};
+
+/**
+Solves the linear system A x = b using the stabilized biconjugate gradient method
+(BiCGSTAB) with the Jacobi (diagonal) preconditioner. The matrix-vector products and
+the dot products are parallelized with OpenMP.
+
+The method is suitable for large sparse non-symmetric systems, such as the ones that arise
+in policy evaluation. The diagonal of A must not contain zeros.
+
+\param A Square matrix
+\param b Right-hand side
+\param x Initial solution, which is replaced by the computed solution
+\param iterations Maximal number of iterations
+\param maxresidual Stop when the maximal absolute residual |b - A x| drops below this value
+\returns Number of iterations and the final maximal absolute residual
+*/
+pair<unsigned long, prec_t> bicgstab(const SparseMatrix& A, const numvec& b, numvec& x,
+                                     unsigned long iterations, prec_t maxresidual);
+
+}
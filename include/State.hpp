@@ -33,6 +33,8 @@ public:
     typedef long ActionId;
     /** OutcomeId which comes from outcome*/
     typedef typename AType::OutcomeId OutcomeId;
+    /** Type of actions in the state */
+    typedef AType ActionType;
 
     SAState() : actions(0) {};
     SAState(const vector<AType>& actions) : actions(actions) {};
@@ -76,18 +78,27 @@ public:
     void normalize();
 
     /** Checks whether the prescribed action and outcome are correct */
-    bool is_action_outcome_correct(ActionId aid, OutcomeId oid) const;
+    bool is_action_outcome_correct(ActionId aid, const OutcomeId& oid) const;
 
     /** Returns the mean reward following the action (and outcome). */
-    prec_t mean_reward(ActionId actionid, OutcomeId outcomeid) const{
+    prec_t mean_reward(ActionId actionid, const OutcomeId& outcomeid) const{
         return get_action(actionid).mean_reward(outcomeid);
     }
 
     /** Returns the mean transition probabilities following the action and outcome. */
-    Transition mean_transition(ActionId actionid, OutcomeId outcomeid) const{
+    Transition mean_transition(ActionId actionid, const OutcomeId& outcomeid) const{
         return move(get_action(actionid).mean_transition(outcomeid));
     }
 
+    /**
+    Returns the mean transition probabilities following the action and outcome without
+    copying the transition when possible. See the mean_transition method of the action.
+    \param scratch Transition that may be used to store the result
+    */
+    const Transition& mean_transition(ActionId actionid, const OutcomeId& outcomeid, Transition& scratch) const{
+        return get_action(actionid).mean_transition(outcomeid, scratch);
+    }
+
     /**
     Finds the maximal optimistic action.
     When there are no action then the return is assumed to be 0.
@@ -124,12 +135,17 @@ public:
     \return Value of state, 0 if it's terminal regardless of the action index
     */
     prec_t fixed_fixed(numvec const& valuefunction, prec_t discount,
-                       ActionId actionid, OutcomeId outcomeid) const;
+                       ActionId actionid, const OutcomeId& outcomeid) const;
 
     /** Returns json representation of the state
     \param stateid Includes also state id*/
     string to_json(long stateid = -1) const;
 
+    /** Writes json representation of the state
+    \param output Output buffer
+    \param stateid Includes also state id*/
+    void to_json(OutputBuffer& output, long stateid = -1) const;
+
 };
 
 // **********************************************************************
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "RMDP.hpp"
+
+#include <vector>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  State graph
+// **************************************************************************************
+
+/**
+Strongly connected components of a state graph.
+
+Components are numbered in reverse topological order: there is no edge from a state
+in component i to a state in component j > i. Solving the components in the
+increasing order therefore always uses final values of the successor components.
+*/
+struct Components{
+    /// Component of each state
+    indvec component;
+    /// States in each component; the states within a component are sorted
+    vector<indvec> states;
+    /**
+    Level of each component: components with no successors (other than themselves)
+    have level 0, others have a level one greater than the maximal level of
+    their successor components. Components with the same level are independent.
+    */
+    indvec level;
+
+    /** Number of components */
+    size_t size() const {return states.size();};
+};
+
+/**
+Directed graph of possible transitions between states. There is an edge from state s to
+state s' when s' is a target state of any outcome of any action in s (including invalid
+actions and transitions with zero probabilities).
+
+The successors and predecessors are stored in the compressed sparse row format.
+Edges to the same state are not repeated.
+*/
+class StateGraph{
+public:
+    /** Constructs an empty graph */
+    StateGraph() : successor_offsets(1,0), predecessor_offsets(1,0) {};
+
+    /**
+    Constructs the graph of the model.
+    \param mdp Model; the graph does not reference it after it is constructed
+    */
+    template<class SType>
+    explicit StateGraph(const GRMDP<SType>& mdp);
+
+    /** Number of states */
+    size_t state_count() const {return successor_offsets.size() - 1;};
+
+    /** Number of edges */
+    size_t edge_count() const {return successors.size();};
+
+    /** Offsets of the successors of each state (size states + 1) */
+    const vector<size_t>& get_successor_offsets() const {return successor_offsets;};
+    /** Successors of all states */
+    const indvec& get_successors() const {return successors;};
+    /** Offsets of the predecessors of each state (size states + 1) */
+    const vector<size_t>& get_predecessor_offsets() const {return predecessor_offsets;};
+    /** Predecessors of all states */
+    const indvec& get_predecessors() const {return predecessors;};
+
+    /** Successors of the state */
+    indvec get_successors(long stateid) const
+        {return indvec(successors.begin() + successor_offsets[stateid],
+                       successors.begin() + successor_offsets[stateid+1]);};
+
+    /** Predecessors of the state */
+    indvec get_predecessors(long stateid) const
+        {return indvec(predecessors.begin() + predecessor_offsets[stateid],
+                       predecessors.begin() + predecessor_offsets[stateid+1]);};
+
+    /** Whether the state has an edge to itself */
+    bool has_self_loop(long stateid) const;
+
+    /**
+    Computes strongly connected components using Tarjan's algorithm. The
+    implementation is not recursive and works for very large graphs.
+    */
+    Components strongly_connected_components() const;
+
+    /**
+    Computes an ordering of states using the reverse Cuthill-McKee algorithm on the
+    graph with edges in both directions. States that are connected by a transition
+    receive close indices, which improves the locality of the accesses to the value
+    function. Each connected component starts at a state with the minimal degree.
+    \returns Order of the states: order[i] is the original index of the i-th state
+    */
+    indvec reverse_cuthill_mckee() const;
+
+protected:
+    /// Successors of state s are [successor_offsets[s], successor_offsets[s+1])
+    vector<size_t> successor_offsets;
+    /// Successors of all states; sorted for each state
+    indvec successors;
+    /// Predecessors of state s are [predecessor_offsets[s], predecessor_offsets[s+1])
+    vector<size_t> predecessor_offsets;
+    /// Predecessors of all states; sorted for each state
+    indvec predecessors;
+};
+
+}
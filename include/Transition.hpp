@@ -1,6 +1,7 @@
 #pragma once
 
 #include "definitions.hpp"
+#include "output.hpp"
 
 #include<vector>
 #include<string>
@@ -98,6 +99,12 @@ public:
     */
     void normalize();
 
+    /** Allocates memory for the given number of target states */
+    void reserve(size_t count){indices.reserve(count); probabilities.reserve(count); rewards.reserve(count);};
+
+    /** Removes all target states; keeps the allocated memory */
+    void clear(){indices.clear(); probabilities.clear(); rewards.clear();};
+
     /** \returns Whether the transition probabilities sum to 1. */
     bool is_normalized() const;
 
@@ -111,6 +118,22 @@ public:
      */
     prec_t compute_value(numvec const& valuefunction, prec_t discount = 1.0) const;
 
+    /**
+    Computes values of the transition for k value functions at once, reading the
+    transition only once. See craam::sparse_value_batch.
+
+    When there are no target states, the function terminates with an error.
+
+    \param valuefunctions Value functions stored by states: value of state s in
+            problem j is valuefunctions[s*k + j]
+    \param discounts Discount factors of the k problems
+    \param rewardshifts Rewards added to the transitions to each target state stored in the
+            same layout as valuefunctions; ignored when empty
+    \param result Output array of k values
+     */
+    void compute_value_batch(numvec const& valuefunctions, numvec const& discounts,
+                             numvec const& rewardshifts, prec_t* result) const;
+
     /** Computes the mean return from this transition */
     prec_t mean_reward() const;
 
@@ -136,8 +159,9 @@ public:
     void probabilities_addto(prec_t scale, numvec& transition) const;
 
     /**
-    Scales transition probabilities and rewards according to the provided parameter
-    and adds them to the provided vector.
+    Scales transition probabilities according to the provided parameter
+    and adds them to the provided transition. Rewards are combined as in add_sample,
+    so the mean reward of the result is the scaled sum of the mean rewards.
 
     \param scale Multiplicative modification of transition probabilities
     \param transition Transition probabilities being added to. This value
@@ -184,6 +208,11 @@ public:
     \param outcomeid Includes also outcome id*/
     string to_json(long outcomeid = -1) const;
 
+    /** Writes a json representation of transition probabilities
+    \param output Output buffer
+    \param outcomeid Includes also outcome id*/
+    void to_json(OutputBuffer& output, long outcomeid = -1) const;
+
 protected:
 
     /// List of state indices
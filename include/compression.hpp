@@ -0,0 +1,67 @@
+#pragma once
+
+#include "definitions.hpp"
+
+#include <istream>
+#include <ostream>
+#include <memory>
+#include <string>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Compressed files
+// **************************************************************************************
+
+/**
+Whether the library was built with zlib and can read and write gzip-compressed
+files (see the cmake option BUILD_COMPRESSION).
+*/
+bool compression_supported();
+
+/** Whether the file name ends with .gz, which selects gzip compression for output */
+bool is_compressed_name(const string& filename);
+
+/** Whether the file starts with the gzip signature */
+bool is_compressed_file(const string& filename);
+
+/**
+Opens a file for reading. A gzip-compressed file is decompressed in a streaming
+fashion as it is read; the decompressed contents are never stored in memory as a
+whole. Other files are read directly.
+
+Throws an invalid_argument exception when the file cannot be opened or it is compressed
+and the library was built without compression.
+
+\param filename Name of the file
+\returns Stream with the (decompressed) contents of the file
+*/
+unique_ptr<istream> open_input_file(const string& filename);
+
+/**
+Opens a file for writing. When the name ends with .gz, the output is compressed with
+gzip in a streaming fashion as it is written.
+
+Throws an invalid_argument exception when the file cannot be opened or the
+name ends with .gz and the library was built without compression.
+
+\param filename Name of the file
+\returns Stream that writes (and compresses) the file; close it by close_output_file
+*/
+unique_ptr<ostream> open_output_file(const string& filename);
+
+/**
+Writes the remaining output of a stream returned by open_output_file, completes the
+compressed stream, and closes the file. Destroying the stream also closes the file,
+but errors are then not reported.
+
+Throws an invalid_argument exception when the output cannot be written.
+
+\param output Stream returned by open_output_file
+\param filename Name of the file, used in the error message
+*/
+void close_output_file(unique_ptr<ostream> output, const string& filename);
+
+}
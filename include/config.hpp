@@ -0,0 +1,10 @@
+#pragma once 
+
+// the configured options and settings for Tutorial
+#define VERSION 1.0.0
+/* #undef IS_DEBUG */
+#define HAS_ZLIB
+
+#ifndef IS_DEBUG
+    #define NDEBUG
+#endif
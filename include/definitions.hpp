@@ -26,6 +26,10 @@ typedef vector<long> indvec;
 const prec_t SOLPREC = 0.0001;
 /** Default number of iterations */
 const unsigned long MAXITER = 100000;
+/** Default precision of iteratively computed occupancy frequencies */
+const prec_t OFREQ_PREC = 1e-10;
+/** Largest number of states for which occupancy frequencies are computed by a dense LU decomposition */
+const size_t OFREQ_DENSE_MAXSTATES = 2000;
 
 /** Function representing the constraints on nature. The inputs
     are the q-values z, the reference distribution q, and the threshold t.
@@ -37,6 +41,44 @@ template <typename T> vector<size_t> sort_indexes_desc(vector<T> const& v);
 
 pair<numvec,prec_t> worstcase_l1(numvec const& z, numvec const& q, prec_t t);
 
+/**
+Computes the same solution as worstcase_l1(z,q,t), but stores the distribution in the
+provided vector. Does not allocate memory when the capacity of the vector suffices.
+\param result Set to the worst-case distribution
+\returns Objective value
+*/
+prec_t worstcase_l1(numvec const& z, numvec const& q, prec_t t, numvec& result);
+
+/**
+Computes the inverse of a permutation. Throws an invalid_argument exception if the
+argument is not a permutation of 0 ... n-1.
+\param order Permutation
+\returns Inverse such that inverse[order[i]] = i
+*/
+indvec inverse_permutation(const indvec& order);
+
+/**
+Computes the same solution as worstcase_l1 using a sort order of the outcomes from a previous
+call. The order is repaired incrementally, which is fast when the values change little
+between the calls. The order is reset when its size does not match.
+
+\param z Values of the outcomes
+\param q Reference distribution
+\param t Threshold
+\param order Indices of outcomes sorted by z in ascending order; updated by the call
+*/
+pair<numvec,prec_t> worstcase_l1_sorted(numvec const& z, numvec const& q, prec_t t,
+                                        vector<size_t>& order);
+
+/**
+Computes the same solution as worstcase_l1_sorted, but stores the distribution in the
+provided vector. Does not allocate memory when the capacities of the vectors suffice.
+\param result Set to the worst-case distribution
+\returns Objective value
+*/
+prec_t worstcase_l1_sorted(numvec const& z, numvec const& q, prec_t t,
+                           vector<size_t>& order, numvec& result);
+
 /*template<class T>
 void print_vector(vector<T> vec){
     for(auto&& p : vec){
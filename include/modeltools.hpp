@@ -5,6 +5,7 @@
 #include "State.hpp"
 #include "Action.hpp"
 #include "RMDP.hpp"
+#include "compression.hpp"
 
 #include <vector>
 #include <istream>
@@ -73,7 +74,12 @@ template<class Model>
 Model& from_csv(Model& mdp, istream& input, bool header = true);
 
 /**
-Loads the transition probabilities and rewards from a CSV file.
+Loads the transition probabilities and rewards from a CSV file. A gzip-compressed
+file is decompressed while it is read (see open_input_file).
+
+Throws an invalid_argument exception when the file cannot be opened or read, such as
+when a compressed file is truncated or corrupted.
+
 \param mdp Model output (also returned)
 \param filename Name of the file
 \param header Whether to create a header of the file too
@@ -81,12 +87,59 @@ Loads the transition probabilities and rewards from a CSV file.
  */
 template<class Model>
 Model& from_csv_file(Model& mdp, const string& filename, bool header = true){
-    ifstream ifs(filename);
-    from_csv(mdp, ifs, header);
-    ifs.close();
+    auto input = open_input_file(filename);
+    from_csv(mdp, *input, header);
+    // reading stops at an error (such as a truncated compressed file) as at the end
+    if(input->bad())
+        throw invalid_argument("Cannot read file: " + filename);
     return mdp;
 }
 
+/** Number of bytes of a csv file read and parsed at once by from_csv_file_parallel */
+const size_t CSV_BLOCK_SIZE = 1 << 26;
+
+/**
+Statistics of loading a model by from_csv_file_parallel.
+*/
+struct LoadStatistics{
+    /// Number of bytes of text read (after decompression)
+    size_t bytes = 0;
+    /// Number of transitions (rows) read
+    size_t transitions = 0;
+    /// Time to read the file, parse it, and construct the model in seconds
+    double seconds = 0;
+
+    /** Throughput in megabytes (10^6 bytes) per second */
+    double megabytes_per_second() const {return seconds > 0 ? bytes / seconds / 1e6 : 0;};
+};
+
+/**
+Loads the transition probabilities and rewards from a CSV file much faster than
+from_csv_file. The file is read in large blocks, which are split into chunks at
+the ends of lines, and the chunks are parsed in parallel without allocating strings.
+A gzip-compressed file is decompressed while it is read, so the text is never stored
+in memory as a whole. The transitions are then added to the model at once by
+GRMDP::add_transitions.
+
+The format is the same as in from_csv and the model is identical to the one
+constructed by from_csv_file. Unlike from_csv, the last line is read also when
+the file does not end with a new line.
+
+Throws an invalid_argument exception when the file cannot be read or a line
+is malformed.
+
+\param mdp Model output (also returned)
+\param filename Name of the file
+\param header Whether the first line of the file represents the header
+\param statistics If not null, the size of the text, the number of transitions,
+            and the time taken are stored here
+\param blocksize Number of bytes read and parsed at once
+\returns The input model
+ */
+template<class Model>
+Model& from_csv_file_parallel(Model& mdp, const string& filename, bool header = true,
+                              LoadStatistics* statistics = nullptr, size_t blocksize = CSV_BLOCK_SIZE);
+
 /**
 Uniformly sets the thresholds to the provided value for all states and actions.
 This method should be used only with models that support thresholds.
@@ -100,6 +153,16 @@ This function only applies to models that have thresholds, such as ones using
 template<class Model>
 void set_outcome_thresholds(Model& mdp, prec_t threshold);
 
+/**
+Enables or disables reusing the sort order of outcomes between iterations
+for all states and actions. See WeightedOutcomeAction::set_order_caching.
+
+\param mdp Model to set the caching for
+\param cache Whether to cache the order
+*/
+template<class Model>
+void set_outcome_order_caching(Model& mdp, bool cache);
+
 /**
 Sets the distribution for outcomes for each state and
 action to be uniform. 
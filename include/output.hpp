@@ -0,0 +1,133 @@
+#pragma once
+
+#include "definitions.hpp"
+#include "parallel.hpp"
+
+#include <string>
+#include <ostream>
+#include <vector>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Buffered text output
+// **************************************************************************************
+
+/** Number of bytes collected by OutputBuffer before they are written to the stream */
+const size_t OUTPUT_BLOCK_SIZE = 1 << 20;
+
+/**
+Writes the shortest decimal representation of the number that is parsed back
+to the same value (as by strtod). Integral values are written without a decimal point.
+\param value Number to format
+\param output At least 32 characters; the result is not terminated by 0
+\returns Number of characters written
+*/
+size_t format_number(prec_t value, char* output);
+
+/**
+Formats text and numbers into a reusable memory buffer and writes it to a stream
+in large blocks. This avoids the overhead of formatting each number through the
+stream and of concatenating strings. Numbers are written by format_number, so
+they are not rounded.
+
+When constructed without a stream, the buffer collects all the output in memory,
+which can then be retrieved by str.
+
+The remaining output is written to the stream when the buffer is destroyed.
+*/
+class OutputBuffer{
+public:
+    /**
+    Writes the output to the stream
+    \param output Destination stream
+    \param blocksize Number of bytes collected before writing them to the stream
+    */
+    explicit OutputBuffer(ostream& output, size_t blocksize = OUTPUT_BLOCK_SIZE) :
+        output(&output), blocksize(blocksize) {buffer.reserve(blocksize + 256);};
+
+    /** Collects the output in memory */
+    OutputBuffer() : output(nullptr), blocksize(0) {};
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer(){flush();};
+
+    OutputBuffer& operator<<(char c){buffer.push_back(c); check(); return *this;};
+    OutputBuffer& operator<<(const char* text){buffer.append(text); check(); return *this;};
+    OutputBuffer& operator<<(const string& text){buffer.append(text); check(); return *this;};
+    OutputBuffer& operator<<(int value){return *this << (long) value;};
+    OutputBuffer& operator<<(long value);
+    OutputBuffer& operator<<(unsigned long value);
+    OutputBuffer& operator<<(prec_t value);
+
+    /**
+    Writes a list of numbers separated by commas
+    \param values Numbers to write
+    */
+    template<class T>
+    OutputBuffer& write_list(const vector<T>& values){
+        for(size_t i = 0; i < values.size(); i++){
+            if(i > 0) buffer.push_back(',');
+            *this << values[i];
+        }
+        return *this;
+    }
+
+    /** Writes the collected output to the stream, if there is one */
+    void flush();
+
+    /** Output collected in memory and not yet written to the stream */
+    const string& str() const {return buffer;};
+
+protected:
+    /// Destination of the output; null when collecting in memory
+    ostream* output;
+    /// Number of bytes collected before writing them to the stream
+    size_t blocksize;
+    /// Collected output
+    string buffer;
+
+    /** Writes the buffer to the stream once it is full */
+    void check(){if(output != nullptr && buffer.size() >= blocksize) flush();};
+};
+
+/**
+Writes items in order, such as the states of a model. When parallel, consecutive
+ranges of items are formatted by separate threads into memory and then written
+to the output in order, so the output is the same as when writing sequentially.
+\param output Output buffer
+\param count Number of items
+\param write_item Called with an OutputBuffer and the index of each item
+\param parallel Whether to format the items in parallel
+*/
+template<class Function>
+inline void write_in_order(OutputBuffer& output, size_t count, Function&& write_item, bool parallel){
+    if(!parallel){
+        for(size_t i = 0; i < count; i++)
+            write_item(output, i);
+        return;
+    }
+
+    // items formatted by each thread in a round; limits the memory used
+    const size_t itemsperblock = 256;
+    const long blockcount = thread_count();
+
+    for(size_t first = 0; first < count; first += itemsperblock * blockcount){
+        vector<OutputBuffer> blocks(blockcount);
+        #pragma omp parallel for schedule(static,1)
+        for(long b = 0; b < blockcount; b++){
+            const size_t begin = min(count, first + b * itemsperblock);
+            const size_t end = min(count, begin + itemsperblock);
+            for(size_t i = begin; i < end; i++)
+                write_item(blocks[b], i);
+        }
+        for(const auto& block : blocks)
+            output << block.str();
+    }
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "definitions.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace craam {
+
+using namespace std;
+
+// **************************************************************************************
+//  Scheduling of parallel loops over states
+// **************************************************************************************
+
+/**
+Assignment of states to threads in the parallel loops of the Jacobi solvers.
+*/
+enum class Schedule {
+    /// Contiguous blocks with the same number of states, one per thread. Each thread
+    /// always processes the same states, which is good for the cache and NUMA locality
+    /// when all states have a similar cost.
+    Static = 0,
+    /// Contiguous blocks with the same number of transitions (nonzero probabilities),
+    /// one per thread. Keeps the locality of Static and balances models in which
+    /// the number of actions and outcomes varies among states.
+    Balanced = 1,
+    /// Several smaller blocks with the same number of transitions per thread, which
+    /// idle threads take from a shared queue. Balances the load even when the
+    /// cost is not proportional to the number of transitions (e.g. sorting in
+    /// L1-constrained updates), but the states of a thread vary among iterations.
+    Dynamic = 2
+};
+
+/**
+Sets the schedule of the parallel loops over states used by all subsequent calls of
+the solvers. The default is Schedule::Static. It can be called while other threads run
+solvers; a solver reads the schedule once when it starts.
+*/
+void set_schedule(Schedule schedule);
+
+/** Schedule of the parallel loops over states */
+Schedule get_schedule();
+
+/** Number of threads used by parallel loops */
+long thread_count();
+
+/** Index of the calling thread in the current parallel region (0 outside of one) */
+long thread_index();
+
+/**
+Partition of states into contiguous blocks that are processed in parallel.
+*/
+class StateBlocks{
+public:
+    /**
+    Creates blocks with the same number of states for the static schedule.
+    \param statecount Number of states
+    */
+    explicit StateBlocks(size_t statecount);
+
+    /**
+    Creates blocks of states with a similar total cost.
+    \param costs Cost of each state, such as the number of its transitions
+    \param schedule Type of the schedule; Static ignores the costs
+    */
+    StateBlocks(const indvec& costs, Schedule schedule);
+
+    /** Number of blocks */
+    size_t size() const {return boundaries.size() - 1;};
+
+    /** First state of the block */
+    long begin(size_t block) const {return boundaries[block];};
+
+    /** One after the last state of the block */
+    long end(size_t block) const {return boundaries[block + 1];};
+
+    /** Whether the blocks are assigned to threads dynamically */
+    bool is_dynamic() const {return dynamic;};
+
+protected:
+    /// Block b contains the states boundaries[b] ... boundaries[b+1]-1
+    indvec boundaries;
+    /// Whether the blocks are assigned dynamically
+    bool dynamic;
+};
+
+/**
+Calls the function for all states in parallel using the assignment of the blocks. The
+blocks of the static schedules are mapped to threads in the same way as the states in
+a loop with schedule(static), so the states of each thread stay the same.
+\param blocks Partition of the states
+\param function Called with the index of each state
+*/
+template<class Function>
+inline void parallel_for_states(const StateBlocks& blocks, Function&& function){
+    const long blockcount = blocks.size();
+    if(blocks.is_dynamic()){
+        #pragma omp parallel for schedule(dynamic,1)
+        for(long b = 0; b < blockcount; b++)
+            for(long s = blocks.begin(b); s < blocks.end(b); s++)
+                function(s);
+    }else{
+        #pragma omp parallel for schedule(static,1)
+        for(long b = 0; b < blockcount; b++)
+            for(long s = blocks.begin(b); s < blocks.end(b); s++)
+                function(s);
+    }
+}
+
+/**
+Sorts the values in parallel: blocks are sorted by separate threads and then merged
+pairwise. Like std::sort, the sort is not stable.
+\param values Values to sort
+\param compare Strict weak ordering of the values
+*/
+template<class T, class Compare>
+inline void parallel_sort(vector<T>& values, Compare compare){
+    // small inputs are not worth the overhead of the threads
+    const long blockcount = max(1l, min(thread_count(), long(values.size() / 4096)));
+    if(blockcount == 1){
+        sort(values.begin(), values.end(), compare);
+        return;
+    }
+
+    vector<size_t> boundaries(blockcount + 1);
+    for(long b = 0; b <= blockcount; b++)
+        boundaries[b] = values.size() * b / blockcount;
+
+    #pragma omp parallel for schedule(static,1)
+    for(long b = 0; b < blockcount; b++)
+        sort(values.begin() + boundaries[b], values.begin() + boundaries[b+1], compare);
+
+    for(long width = 1; width < blockcount; width *= 2){
+        #pragma omp parallel for schedule(static,1)
+        for(long b = 0; b < blockcount - width; b += 2*width){
+            inplace_merge(values.begin() + boundaries[b], values.begin() + boundaries[b + width],
+                          values.begin() + boundaries[min(b + 2*width, blockcount)], compare);
+        }
+    }
+}
+
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "definitions.hpp"
+
+#include <cstdint>
+#include <cstddef>
+
+namespace craam {
+
+// **************************************************************************************
+//  Sparse dot-product kernels
+// **************************************************************************************
+
+/**
+Computes the value of a sparse transition:
+    sum_i probabilities[i] * (rewards[i] + discount * valuefunction[indices[i]])
+
+This is the innermost operation of all solvers. The computation uses an explicitly
+vectorized kernel (AVX-512 or AVX2 with hardware gathers) when the CPU supports it and
+a portable scalar loop otherwise. The kernel is selected once at runtime, so the library
+can be compiled for a generic target. The vectorized kernels sum the terms in a
+different order than the scalar loop and the results may differ by rounding errors.
+
+Very short transitions are always computed by the scalar loop.
+
+\param probabilities Transition probabilities
+\param rewards Transition rewards
+\param indices Target states
+\param count Number of nonzero transitions
+\param valuefunction Value function indexed by the target states
+\param discount Discount factor
+\returns Value of the transition
+*/
+prec_t sparse_value(const prec_t* probabilities, const prec_t* rewards, const long* indices,
+                    size_t count, const prec_t* valuefunction, prec_t discount);
+
+/**
+Computes the value of a sparse transition with probabilities and rewards stored in single
+precision and 32-bit target indices. The computation is done in prec_t.
+See sparse_value for details.
+*/
+prec_t sparse_value(const float* probabilities, const float* rewards, const int32_t* indices,
+                    size_t count, const prec_t* valuefunction, prec_t discount);
+
+/**
+Portable scalar version of sparse_value. It is used as a fallback when the vectorized
+kernels are not available and for other storage types.
+*/
+template<class PType, class IType>
+inline prec_t sparse_value_scalar(const PType* probabilities, const PType* rewards, const IType* indices,
+                                  size_t count, const prec_t* valuefunction, prec_t discount){
+    prec_t value = 0.0;
+    for(size_t c = 0; c < count; c++){
+        value +=  prec_t(probabilities[c]) * (prec_t(rewards[c]) + discount * valuefunction[indices[c]]);
+    }
+    return value;
+}
+
+/**
+Generic version of sparse_value for storage types without a vectorized kernel.
+*/
+template<class PType, class IType>
+inline prec_t sparse_value(const PType* probabilities, const PType* rewards, const IType* indices,
+                           size_t count, const prec_t* valuefunction, prec_t discount){
+    return sparse_value_scalar(probabilities, rewards, indices, count, valuefunction, discount);
+}
+
+/**
+Computes the values of a sparse transition for k problems at once:
+    result[j] = sum_i probabilities[i] * (rewards[i] + rewardshifts[indices[i]*k + j]
+                                           + discounts[j] * valuefunctions[indices[i]*k + j])
+
+The value functions of all problems are interleaved, so that the k values of each target
+state are contiguous. The transition is read once for all problems and the inner loop
+over the problems is vectorized by the compiler. This makes the computation compute-bound
+rather than bandwidth-bound when k is moderately large.
+
+\param probabilities Transition probabilities
+\param rewards Transition rewards
+\param indices Target states
+\param count Number of nonzero transitions
+\param valuefunctions Interleaved value functions (size states * k)
+\param discounts Discount factors of the k problems
+\param rewardshifts Interleaved rewards added to the transitions to each state; may be null
+\param k Number of problems
+\param result Output array of k values
+*/
+template<class PType, class IType>
+inline void sparse_value_batch(const PType* probabilities, const PType* rewards, const IType* indices,
+                               size_t count, const prec_t* valuefunctions, const prec_t* discounts,
+                               const prec_t* rewardshifts, size_t k, prec_t* result){
+    for(size_t j = 0; j < k; j++)
+        result[j] = 0.0;
+
+    for(size_t c = 0; c < count; c++){
+        const prec_t probability = prec_t(probabilities[c]);
+        const prec_t reward = prec_t(rewards[c]);
+        const prec_t* values = valuefunctions + size_t(indices[c]) * k;
+
+        if(rewardshifts == nullptr){
+            for(size_t j = 0; j < k; j++)
+                result[j] += probability * (reward + discounts[j] * values[j]);
+        }else{
+            const prec_t* shifts = rewardshifts + size_t(indices[c]) * k;
+            for(size_t j = 0; j < k; j++)
+                result[j] += probability * (reward + shifts[j] + discounts[j] * values[j]);
+        }
+    }
+}
+
+/**
+Enables or disables the vectorized kernels. This is mainly useful for benchmarking
+and testing. The kernels are enabled by default when supported by the CPU.
+The selection is switched atomically and may be changed while solvers run;
+each call to sparse_value uses either the old or the new kernel.
+*/
+void set_vectorized(bool enabled);
+
+/**
+Name of the kernel currently used by sparse_value: "avx512", "avx2", or "scalar".
+*/
+const char* vectorized_kernel();
+
+}
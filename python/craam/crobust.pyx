@@ -93,6 +93,9 @@ cdef extern from "../include/RMDP.hpp" namespace 'craam' nogil:
         size_t state_count() 
         CRegularState& get_state(long stateid)
 
+        void add_transitions(const indvec& idstatefrom, const indvec& idaction, const indvec& idoutcome,
+                        const indvec& idstateto, const numvec& probabilities, const numvec& rewards) except +
+
         SolutionDscDsc vi_jac(Uncertainty uncert, prec_t discount,
                         const numvec& valuefunction,
                         unsigned long iterations,
@@ -521,18 +524,25 @@ cdef class MDP:
             raise ValueError('The number of states in transitions and rewards is inconsistent.')
 
         cdef long aoindex, fromid, toid
-        cdef long actionid 
-        cdef double transitionprob, rewardval
+        cdef double transitionprob
+        cdef indvec idstatefrom, idaction, idoutcome, idstateto
+        cdef numvec probabilities, rewardvals
 
+        # collect all transitions and add them to the model at once
         for aoindex in range(actioncount):    
             for fromid in range(statecount):
                 for toid in range(statecount):
-                    actionid = aoindex
                     transitionprob = transitions[fromid,toid,aoindex]
                     if transitionprob <= ignorethreshold:
                         continue
-                    rewardval = rewards[fromid,aoindex]
-                    self.add_transition(fromid,actionid,toid,transitionprob,rewardval)
+                    idstatefrom.push_back(fromid)
+                    idaction.push_back(aoindex)
+                    idoutcome.push_back(0)
+                    idstateto.push_back(toid)
+                    probabilities.push_back(transitionprob)
+                    rewardvals.push_back(rewards[fromid,aoindex])
+        dereference(self.thisptr).add_transitions(idstatefrom, idaction, idoutcome, idstateto,
+                                                  probabilities, rewardvals)
 
     cpdef to_matrices(self):
         """
@@ -992,6 +1002,9 @@ cdef extern from "../include/RMDP.hpp" namespace 'craam' nogil:
         size_t state_count() 
         CL1RobustState& get_state(long stateid)
 
+        void add_transitions(const indvec& idstatefrom, const indvec& idaction, const indvec& idoutcome,
+                        const indvec& idstateto, const numvec& probabilities, const numvec& rewards) except +
+
         void normalize()
 
         SolutionDscProb vi_jac(Uncertainty uncert, prec_t discount,
@@ -1508,19 +1521,25 @@ cdef class RMDP:
             raise ValueError('The actions must be unique.')
 
         cdef long aoindex, fromid, toid
-        cdef long actionid 
-        cdef double transitionprob, rewardval
+        cdef double transitionprob
+        cdef indvec idstatefrom, idaction, idoutcome, idstateto
+        cdef numvec probabilities, rewardvals
 
+        # collect all transitions and add them to the model at once
         for aoindex in range(actioncount):    
             for fromid in range(statecount):
                 for toid in range(statecount):
-                    actionid = actions[aoindex]
-                    outcomeid = outcomes[aoindex]
                     transitionprob = transitions[fromid,toid,aoindex]
                     if transitionprob <= ignorethreshold:
                         continue
-                    rewardval = rewards[fromid,aoindex]
-                    self.add_transition(fromid, actionid, outcomeid, toid, transitionprob, rewardval)
+                    idstatefrom.push_back(fromid)
+                    idaction.push_back(actions[aoindex])
+                    idoutcome.push_back(outcomes[aoindex])
+                    idstateto.push_back(toid)
+                    probabilities.push_back(transitionprob)
+                    rewardvals.push_back(rewards[fromid,aoindex])
+        dereference(self.thisptr).add_transitions(idstatefrom, idaction, idoutcome, idstateto,
+                                                  probabilities, rewardvals)
 
     cpdef to_json(self):
         """
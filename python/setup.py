@@ -23,12 +23,22 @@ for key, value in cfg_vars.items():
     if type(value) == str:
         cfg_vars[key] = value.replace("-Wstrict-prototypes", "")
 
+# libcraam reads and writes compressed files with zlib when it was built with it
+libraries = []
+try:
+    with open('../include/config.hpp') as f:
+        if '#define HAS_ZLIB' in f.read():
+            libraries.append('z')
+except IOError:
+    print('WARNING: ../include/config.hpp not found; build the library with cmake first.')
+
 ext_modules = [
     Extension(
         "craam.crobust",
         ["craam/crobust.pyx"],
         extra_compile_args = ['-std=c++14','-fopenmp','-O2','-march=native'],
         extra_link_args=['-fopenmp'],
+        libraries = libraries,
         include_dirs = [numpy.get_include(),'craam/include']),
     ]
 
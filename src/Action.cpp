@@ -19,15 +19,17 @@ using namespace std;
 // **************************************************************************************
 
 string RegularAction::to_json(long actionid) const{
-    string result{"{"};
-    result += "\"actionid\" : ";
-    result += std::to_string(actionid);
-    result += ",\"valid\" :";
-    result += std::to_string(valid);
-    result += ",\"transition\" : ";
-    result += outcome.to_json(-1);
-    result += "}";
-    return result;
+    OutputBuffer output;
+    to_json(output, actionid);
+    return output.str();
+}
+
+void RegularAction::to_json(OutputBuffer& output, long actionid) const{
+    output << "{\"actionid\" : " << actionid;
+    output << ",\"valid\" :" << int(valid);
+    output << ",\"transition\" : ";
+    outcome.to_json(output, -1);
+    output << "}";
 }
 
 // **************************************************************************************
@@ -113,21 +115,32 @@ prec_t DiscreteOutcomeAction::average(const numvec& valuefunction, prec_t discou
 }
 
 
+const Transition& DiscreteOutcomeAction::average_transition(Transition& scratch) const{
+    if(outcomes.empty())
+        throw invalid_argument("Action with no outcomes.");
+
+    scratch.clear();
+    const prec_t weight = 1.0 / prec_t(outcomes.size());
+    for(const auto& outcome : outcomes)
+        outcome.probabilities_addto(weight, scratch);
+    return scratch;
+}
+
 string DiscreteOutcomeAction::to_json(long actionid) const{
-    string result{"{"};
-    result += "\"actionid\" : ";
-    result += std::to_string(actionid);
-    result += ",\"valid\" :";
-    result += std::to_string(valid);
-    result += ",\"outcomes\" : [";
+    OutputBuffer output;
+    to_json(output, actionid);
+    return output.str();
+}
+
+void DiscreteOutcomeAction::to_json(OutputBuffer& output, long actionid) const{
+    output << "{\"actionid\" : " << actionid;
+    output << ",\"valid\" :" << int(valid);
+    output << ",\"outcomes\" : [";
     for(auto oi : indices(outcomes)){
-        const auto& o = outcomes[oi];
-        result += o.to_json(oi);
-        result += ",";
+        if(oi > 0) output << ',';
+        outcomes[oi].to_json(output, oi);
     }
-    if(!outcomes.empty()) result.pop_back(); // remove last comma
-    result += "]}";
-    return result;
+    output << "]}";
 }
 
 // **************************************************************************************
@@ -178,44 +191,76 @@ Transition& WeightedOutcomeAction<nature>::create_outcome(long outcomeid, prec_t
 }
 
 
+template<NatureConstr nature>
+prec_t WeightedOutcomeAction<nature>::compute_nature(const numvec& outcomevalues, vector<size_t>& order,
+                                                     numvec& result) const{
+    // the L1 solution is computed directly into the result to avoid allocations
+    if(nature == static_cast<NatureConstr>(worstcase_l1)){
+        if(cache_order)
+            return worstcase_l1_sorted(outcomevalues, distribution, threshold, order, result);
+        else
+            return worstcase_l1(outcomevalues, distribution, threshold, result);
+    }
+    auto solution = nature(outcomevalues, distribution, threshold);
+    result = move(solution.first);
+    return solution.second;
+}
+
 template<NatureConstr nature>
 auto WeightedOutcomeAction<nature>::maximal(const numvec& valuefunction, prec_t discount) const
             -> pair<OutcomeId,prec_t>{
+    OutcomeId result;
+    const prec_t value = maximal(valuefunction, discount, result);
+    return make_pair(move(result), value);
+}
+
+template<NatureConstr nature>
+prec_t WeightedOutcomeAction<nature>::maximal(const numvec& valuefunction, prec_t discount,
+                                              OutcomeId& result) const{
 
     assert(distribution.size() == outcomes.size());
 
     if(outcomes.empty())
         throw invalid_argument("Action with no outcomes.");
 
-    numvec outcomevalues(outcomes.size());
+    // reused between the calls to avoid allocations
+    static thread_local numvec outcomevalues;
+    outcomevalues.resize(outcomes.size());
 
     for(size_t i = 0; i < outcomes.size(); i++){
         const auto& outcome = outcomes[i];
         outcomevalues[i] = - outcome.compute_value(valuefunction, discount);
     }
 
-    auto result = nature(outcomevalues, distribution, threshold);
-    result.second = -result.second;
-
-    return result;
+    return - compute_nature(outcomevalues, order_maximal, result);
 }
 
 template<NatureConstr nature>
 auto WeightedOutcomeAction<nature>::minimal(const numvec& valuefunction, prec_t discount) const
             -> pair<OutcomeId,prec_t>{
+    OutcomeId result;
+    const prec_t value = minimal(valuefunction, discount, result);
+    return make_pair(move(result), value);
+}
+
+template<NatureConstr nature>
+prec_t WeightedOutcomeAction<nature>::minimal(const numvec& valuefunction, prec_t discount,
+                                              OutcomeId& result) const{
 
     assert(distribution.size() == outcomes.size());
 
     if(outcomes.empty())
         throw invalid_argument("Action with no outcomes");
 
-    numvec outcomevalues(outcomes.size());
+    // reused between the calls to avoid allocations
+    static thread_local numvec outcomevalues;
+    outcomevalues.resize(outcomes.size());
 
     for(size_t i = 0; i < outcomes.size(); i++){
         const auto& outcome = outcomes[i];
         outcomevalues[i] = outcome.compute_value(valuefunction, discount);
     }
-    return nature(outcomevalues, distribution, threshold);
+    return compute_nature(outcomevalues, order_minimal, result);
 }
 
 template<NatureConstr nature>
@@ -235,7 +280,7 @@ prec_t WeightedOutcomeAction<nature>::average(numvec const& valuefunction, prec_
 
 template<NatureConstr nature>
 prec_t WeightedOutcomeAction<nature>::fixed(numvec const& valuefunction, prec_t discount,
-                                            OutcomeId dist) const{
+                                            const OutcomeId& dist) const{
 
     assert(distribution.size() == outcomes.size());
 
@@ -298,7 +343,7 @@ bool WeightedOutcomeAction<nature>::is_distribution_normalized() const{
 }
 
 template<NatureConstr nature>
-prec_t WeightedOutcomeAction<nature>::mean_reward(OutcomeId outcomedist) const{
+prec_t WeightedOutcomeAction<nature>::mean_reward(const OutcomeId& outcomedist) const{
     assert(outcomedist.size() == outcomes.size());
 
     prec_t result = 0;
@@ -310,7 +355,7 @@ prec_t WeightedOutcomeAction<nature>::mean_reward(OutcomeId outcomedist) const{
 }
 
 template<NatureConstr nature>
-Transition WeightedOutcomeAction<nature>::mean_transition(OutcomeId outcomedist) const{
+Transition WeightedOutcomeAction<nature>::mean_transition(const OutcomeId& outcomedist) const{
     assert(outcomedist.size() == outcomes.size());
 
     Transition result;
@@ -321,30 +366,38 @@ Transition WeightedOutcomeAction<nature>::mean_transition(OutcomeId outcomedist)
     return result;
 }
 
+template<NatureConstr nature>
+const Transition& WeightedOutcomeAction<nature>::mean_transition(const OutcomeId& outcomedist,
+                                                                 Transition& scratch) const{
+    assert(outcomedist.size() == outcomes.size());
+
+    scratch.clear();
+    for(size_t i = 0; i < outcomes.size(); i++){
+        outcomes[i].probabilities_addto(outcomedist[i], scratch);
+    }
+    return scratch;
+}
+
 template<NatureConstr nature>
 string WeightedOutcomeAction<nature>::to_json(long actionid) const{
-    string result{"{"};
-    result += "\"actionid\" : ";
-    result += std::to_string(actionid);
-    result += ",\"valid\" :";
-    result += std::to_string(valid);
-    result += ",\"threshold\" : ";
-    result += std::to_string(threshold);
-    result += ",\"outcomes\" : [";
+    OutputBuffer output;
+    to_json(output, actionid);
+    return output.str();
+}
+
+template<NatureConstr nature>
+void WeightedOutcomeAction<nature>::to_json(OutputBuffer& output, long actionid) const{
+    output << "{\"actionid\" : " << actionid;
+    output << ",\"valid\" :" << int(valid);
+    output << ",\"threshold\" : " << threshold;
+    output << ",\"outcomes\" : [";
     for(auto oi : indices(outcomes)){
-        const auto& o = outcomes[oi];
-        result +=o.to_json(oi);
-        result +=",";
+        if(oi > 0) output << ',';
+        outcomes[oi].to_json(output, oi);
     }
-    if(!outcomes.empty()) result.pop_back(); // remove last comma
-    result += "],\"distribution\" : [";
-    for(auto d : distribution){
-        result += std::to_string(d);
-        result += ",";
-    }
-    if(!distribution.empty()) result.pop_back(); // remove last comma
-    result += "]}";
-    return result;
+    output << "],\"distribution\" : [";
+    output.write_list(distribution);
+    output << "]}";
 }
 
 
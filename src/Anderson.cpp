@@ -0,0 +1,125 @@
+#include "Anderson.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+#include "cpp11-range-master/range.hpp"
+
+namespace craam {
+
+using namespace util::lang;
+
+/** Dot product of two vectors parallelized with OpenMP */
+static prec_t dot(const numvec& a, const numvec& b){
+    prec_t result = 0;
+    #pragma omp parallel for reduction(+:result)
+    for(long i = 0; i < (long) a.size(); i++)
+        result += a[i] * b[i];
+    return result;
+}
+
+/**
+Solves the linear system A x = b with a small dense matrix by Gaussian elimination with
+partial pivoting. The arguments are modified. Returns false if the matrix is singular.
+*/
+static bool solve_dense(vector<numvec>& A, numvec& b, numvec& x){
+    const size_t n = b.size();
+    for(size_t k = 0; k < n; k++){
+        size_t pivot = k;
+        for(size_t i = k + 1; i < n; i++)
+            if(abs(A[i][k]) > abs(A[pivot][k])) pivot = i;
+        if(A[pivot][k] == 0) return false;
+        swap(A[k], A[pivot]);
+        swap(b[k], b[pivot]);
+        for(size_t i = k + 1; i < n; i++){
+            const prec_t factor = A[i][k] / A[k][k];
+            for(size_t j = k; j < n; j++)
+                A[i][j] -= factor * A[k][j];
+            b[i] -= factor * b[k];
+        }
+    }
+    x.assign(n, 0);
+    for(size_t k = n; k-- > 0;){
+        prec_t sum = b[k];
+        for(size_t j = k + 1; j < n; j++)
+            sum -= A[k][j] * x[j];
+        x[k] = sum / A[k][k];
+    }
+    return true;
+}
+
+bool AndersonAcceleration::mix(const numvec& x, numvec& gx, prec_t residual){
+    if(history == 0) return false;
+    if(x.size() != dimension || gx.size() != dimension)
+        throw invalid_argument("Incorrect size of the iterate.");
+
+    // fall back to the plain update when the residual grows too much
+    if(residual > safeguard * best_residual) reset();
+    best_residual = min(best_residual, residual);
+
+    numvec f(dimension);
+    #pragma omp parallel for
+    for(long i = 0; i < (long) dimension; i++)
+        f[i] = gx[i] - x[i];
+
+    if(has_previous){
+        // reuse the memory of the oldest difference when the history is full
+        numvec df, dg;
+        if(delta_f.size() == history){
+            df = move(delta_f.front()); delta_f.pop_front();
+            dg = move(delta_g.front()); delta_g.pop_front();
+        }
+        df.resize(dimension); dg.resize(dimension);
+
+        #pragma omp parallel for
+        for(long i = 0; i < (long) dimension; i++){
+            df[i] = f[i] - previous_f[i];
+            dg[i] = gx[i] - previous_g[i];
+        }
+        delta_f.push_back(move(df));
+        delta_g.push_back(move(dg));
+    }
+    previous_f = move(f);
+    previous_g = gx;
+    has_previous = true;
+
+    if(delta_f.empty()) return false;
+
+    // normal equations of the least-squares problem
+    const size_t m = delta_f.size();
+    vector<numvec> A(m, numvec(m));
+    numvec b(m);
+    prec_t trace = 0;
+    for(size_t i : indices(delta_f)){
+        for(size_t j = 0; j <= i; j++)
+            A[i][j] = A[j][i] = dot(delta_f[i], delta_f[j]);
+        b[i] = dot(delta_f[i], previous_f);
+        trace += A[i][i];
+    }
+    if(trace == 0) return false;
+    for(size_t i : indices(A))
+        A[i][i] += regularization * trace / prec_t(m);
+
+    numvec alpha;
+    if(!solve_dense(A, b, alpha)) return false;
+
+    #pragma omp parallel for
+    for(long i = 0; i < (long) dimension; i++){
+        prec_t correction = 0;
+        for(size_t j = 0; j < m; j++)
+            correction += alpha[j] * delta_g[j][i];
+        gx[i] -= correction;
+    }
+    return true;
+}
+
+void AndersonAcceleration::reset(){
+    has_previous = false;
+    best_residual = numeric_limits<prec_t>::infinity();
+    delta_f.clear();
+    delta_g.clear();
+}
+
+}
@@ -0,0 +1,999 @@
+#include "CompressedMDP.hpp"
+#include "vectorized.hpp"
+#include "Anderson.hpp"
+#include "compression.hpp"
+
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <cmath>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cpp11-range-master/range.hpp"
+
+using namespace util::lang;
+
+namespace craam {
+
+// **************************************************************************************
+//  Action parameters
+// **************************************************************************************
+
+/// Regular actions have no parameters beyond transitions
+inline void copy_action_parameters(const RegularAction&, numvec&, numvec&) {}
+
+/// Discrete outcome actions have no parameters beyond transitions
+inline void copy_action_parameters(const DiscreteOutcomeAction&, numvec&, numvec&) {}
+
+/// Copies the threshold and the nominal outcome distribution of a weighted action
+template<NatureConstr nature>
+void copy_action_parameters(const WeightedOutcomeAction<nature>& action,
+                            numvec& thresholds, numvec& distribution){
+    thresholds.push_back(action.get_threshold());
+    const numvec& d = action.get_distribution();
+    assert(d.size() == action.outcome_count());
+    distribution.insert(distribution.end(), d.begin(), d.end());
+}
+
+/// Regular actions have no parameters beyond transitions
+inline void restore_action_parameters(RegularAction&, const SharedArray<prec_t>&,
+                                      const SharedArray<prec_t>&, size_t, size_t) {}
+
+/// Discrete outcome actions have no parameters beyond transitions
+inline void restore_action_parameters(DiscreteOutcomeAction&, const SharedArray<prec_t>&,
+                                      const SharedArray<prec_t>&, size_t, size_t) {}
+
+/// Restores the threshold and the nominal outcome distribution of a weighted action
+template<NatureConstr nature>
+void restore_action_parameters(WeightedOutcomeAction<nature>& action, const SharedArray<prec_t>& thresholds,
+                               const SharedArray<prec_t>& distribution, size_t actionindex, size_t firstoutcome){
+    action.set_threshold(thresholds[actionindex]);
+    for(size_t oi = 0; oi < action.outcome_count(); oi++)
+        action.set_distribution(oi, distribution[firstoutcome + oi]);
+}
+
+/// Regular actions store no thresholds and distributions in binary files
+inline bool has_action_parameters(const RegularAction*) {return false;}
+/// Discrete outcome actions store no thresholds and distributions in binary files
+inline bool has_action_parameters(const DiscreteOutcomeAction*) {return false;}
+/// Weighted actions store a threshold for each action and a weight for each outcome
+template<NatureConstr nature>
+inline bool has_action_parameters(const WeightedOutcomeAction<nature>*) {return true;}
+
+/// Identifies the type of actions in binary files
+inline uint32_t action_type_code(const RegularAction*) {return 1;}
+inline uint32_t action_type_code(const DiscreteOutcomeAction*) {return 2;}
+template<NatureConstr nature>
+uint32_t action_type_code(const WeightedOutcomeAction<nature>*) {return 3;}
+
+// **************************************************************************************
+//  Action-specific computation
+// **************************************************************************************
+
+template<class SType, class PType, class IType>
+template<NatureConstr nature>
+auto CompressedMDP<SType,PType,IType>::action_maximal(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const WeightedOutcomeAction<nature>*) const -> pair<OutcomeId,prec_t>{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes.");
+
+    numvec outcomevalues(last - first);
+    numvec nominal(distribution.begin() + first, distribution.begin() + last);
+
+    for(size_t i = first; i < last; i++)
+        outcomevalues[i - first] = - outcome_value(i, valuefunction, discount);
+
+    auto result = nature(outcomevalues, nominal, thresholds[actionindex]);
+    result.second = -result.second;
+    return result;
+}
+
+template<class SType, class PType, class IType>
+template<NatureConstr nature>
+auto CompressedMDP<SType,PType,IType>::action_minimal(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const WeightedOutcomeAction<nature>*) const -> pair<OutcomeId,prec_t>{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes");
+
+    numvec outcomevalues(last - first);
+    numvec nominal(distribution.begin() + first, distribution.begin() + last);
+
+    for(size_t i = first; i < last; i++)
+        outcomevalues[i - first] = outcome_value(i, valuefunction, discount);
+
+    return nature(outcomevalues, nominal, thresholds[actionindex]);
+}
+
+template<class SType, class PType, class IType>
+template<NatureConstr nature>
+prec_t CompressedMDP<SType,PType,IType>::action_average(size_t actionindex, const numvec& valuefunction,
+                                    prec_t discount, const WeightedOutcomeAction<nature>*) const{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes");
+
+    prec_t averagevalue = 0.0;
+    for(size_t i = first; i < last; i++)
+        averagevalue += distribution[i] * outcome_value(i, valuefunction, discount);
+    return averagevalue;
+}
+
+template<class SType, class PType, class IType>
+template<NatureConstr nature>
+prec_t CompressedMDP<SType,PType,IType>::action_fixed(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const OutcomeId& dist, const WeightedOutcomeAction<nature>*) const{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes");
+    if(dist.size() != last - first)
+        throw invalid_argument("Distribution size does not match number of outcomes");
+
+    prec_t averagevalue = 0.0;
+    for(size_t i = first; i < last; i++)
+        averagevalue += dist[i - first] * outcome_value(i, valuefunction, discount);
+    return averagevalue;
+}
+
+template<class SType, class PType, class IType>
+prec_t CompressedMDP<SType,PType,IType>::action_fixed(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const OutcomeId&, const RegularAction*) const{
+    return outcome_value(action_offsets[actionindex], valuefunction, discount);
+}
+
+template<class SType, class PType, class IType>
+template<class AType>
+auto CompressedMDP<SType,PType,IType>::action_maximal(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const AType*) const -> pair<OutcomeId,prec_t>{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes.");
+
+    prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+    long result = -1;
+
+    for(size_t i = first; i < last; i++){
+        auto value = outcome_value(i, valuefunction, discount);
+        if(value > maxvalue){
+            maxvalue = value;
+            result = i - first;
+        }
+    }
+    return make_pair(result,maxvalue);
+}
+
+template<class SType, class PType, class IType>
+template<class AType>
+auto CompressedMDP<SType,PType,IType>::action_minimal(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const AType*) const -> pair<OutcomeId,prec_t>{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes.");
+
+    prec_t minvalue = numeric_limits<prec_t>::infinity();
+    long result = -1;
+
+    for(size_t i = first; i < last; i++){
+        auto value = outcome_value(i, valuefunction, discount);
+        if(value < minvalue){
+            minvalue = value;
+            result = i - first;
+        }
+    }
+    return make_pair(result,minvalue);
+}
+
+template<class SType, class PType, class IType>
+template<class AType>
+prec_t CompressedMDP<SType,PType,IType>::action_average(size_t actionindex, const numvec& valuefunction,
+                                    prec_t discount, const AType*) const{
+    const size_t first = action_offsets[actionindex], last = action_offsets[actionindex+1];
+    if(first == last)
+        throw invalid_argument("Action with no outcomes.");
+
+    prec_t averagevalue = 0.0;
+    const prec_t weight = 1.0 / prec_t(last - first);
+    for(size_t i = first; i < last; i++)
+        averagevalue += weight * outcome_value(i, valuefunction, discount);
+    return averagevalue;
+}
+
+template<class SType, class PType, class IType>
+template<class AType>
+prec_t CompressedMDP<SType,PType,IType>::action_fixed(size_t actionindex, const numvec& valuefunction,
+                                  prec_t discount, const OutcomeId& index, const AType*) const{
+    assert(index >= 0l && index < (long) (action_offsets[actionindex+1] - action_offsets[actionindex]));
+    return outcome_value(action_offsets[actionindex] + index, valuefunction, discount);
+}
+
+// **************************************************************************************
+//  Compressed MDP
+// **************************************************************************************
+
+template<class SType, class PType, class IType>
+CompressedMDP<SType,PType,IType>::CompressedMDP(const GRMDP<SType>& mdp) : CompressedMDP() {
+
+    if(mdp.state_count() > (size_t) numeric_limits<IType>::max())
+        throw invalid_argument("Number of states exceeds the range of the index type.");
+
+    // count the elements first to allocate the arrays only once
+    size_t actioncount = 0, outcomecount = 0, nonzerocount = 0;
+    for(const auto& state : mdp.get_states()){
+        actioncount += state.action_count();
+        for(const auto& action : state.get_actions()){
+            outcomecount += action.outcome_count();
+            for(size_t oi = 0; oi < action.outcome_count(); oi++)
+                nonzerocount += action.get_outcome(oi).size();
+        }
+    }
+
+    vector<size_t> stateoffsets(1,0), actionoffsets(1,0), outcomeoffsets(1,0);
+    vector<IType> newindices;
+    vector<PType> newprobabilities, newrewards;
+    vector<uint8_t> newvalid;
+    numvec newthresholds, newdistribution;
+
+    stateoffsets.reserve(mdp.state_count() + 1);
+    actionoffsets.reserve(actioncount + 1);
+    outcomeoffsets.reserve(outcomecount + 1);
+    newindices.reserve(nonzerocount);
+    newprobabilities.reserve(nonzerocount);
+    newrewards.reserve(nonzerocount);
+    newvalid.reserve(actioncount);
+
+    for(const auto& state : mdp.get_states()){
+        for(const auto& action : state.get_actions()){
+            newvalid.push_back(action.is_valid());
+            copy_action_parameters(action, newthresholds, newdistribution);
+            for(size_t oi = 0; oi < action.outcome_count(); oi++){
+                const Transition& t = action.get_outcome(oi);
+                newindices.insert(newindices.end(), t.get_indices().begin(), t.get_indices().end());
+                newprobabilities.insert(newprobabilities.end(), t.get_probabilities().begin(), t.get_probabilities().end());
+                newrewards.insert(newrewards.end(), t.get_rewards().begin(), t.get_rewards().end());
+                outcomeoffsets.push_back(newindices.size());
+            }
+            actionoffsets.push_back(outcomeoffsets.size() - 1);
+        }
+        stateoffsets.push_back(actionoffsets.size() - 1);
+    }
+
+    state_offsets = SharedArray<size_t>(move(stateoffsets));
+    action_offsets = SharedArray<size_t>(move(actionoffsets));
+    outcome_offsets = SharedArray<size_t>(move(outcomeoffsets));
+    indices = SharedArray<IType>(move(newindices));
+    probabilities = SharedArray<PType>(move(newprobabilities));
+    rewards = SharedArray<PType>(move(newrewards));
+    valid = SharedArray<uint8_t>(move(newvalid));
+    thresholds = SharedArray<prec_t>(move(newthresholds));
+    distribution = SharedArray<prec_t>(move(newdistribution));
+}
+
+template<class SType, class PType, class IType>
+GRMDP<SType> CompressedMDP<SType,PType,IType>::unfreeze() const{
+    GRMDP<SType> mdp(state_count());
+    for(size_t s = 0; s < state_count(); s++){
+        auto& state = mdp.get_state(s);
+        for(size_t a = state_offsets[s]; a < state_offsets[s+1]; a++){
+            auto& action = state.create_action();
+            for(size_t o = action_offsets[a]; o < action_offsets[a+1]; o++){
+                Transition& t = action.create_outcome(o - action_offsets[a]);
+                t.reserve(outcome_offsets[o+1] - outcome_offsets[o]);
+                for(size_t i = outcome_offsets[o]; i < outcome_offsets[o+1]; i++)
+                    t.add_sample(indices[i], probabilities[i], rewards[i]);
+            }
+            action.set_validity(valid[a]);
+            restore_action_parameters(action, thresholds, distribution, a, action_offsets[a]);
+        }
+    }
+    return mdp;
+}
+
+// **************************************************************************************
+//  Binary files
+// **************************************************************************************
+
+/// Identifies the model files
+const char binary_identifier[8] = {'C','R','A','A','M','M','D','P'};
+/// Version of the file format
+const uint32_t binary_version = 1;
+/// Detects files written with a different byte order
+const uint32_t binary_byteorder = 0x01020304;
+/// Alignment of the arrays in the file, in bytes
+const size_t binary_alignment = 64;
+/// Flag: target states are stored as differences from the previous target of the outcome
+const uint32_t binary_delta_indices = 1;
+
+static_assert(sizeof(size_t) == sizeof(uint64_t), "Offsets are stored as 64-bit integers.");
+
+/// Header at the beginning of a binary model file
+struct BinaryHeader{
+    char identifier[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint32_t actiontype;
+    uint32_t ptypesize;
+    uint32_t itypesize;
+    uint32_t flags;
+    uint64_t states;
+    uint64_t actions;
+    uint64_t outcomes;
+    uint64_t nonzeros;
+    uint64_t thresholds;
+    uint64_t distribution;
+};
+
+/// Rounds the position up to the next aligned position
+inline size_t binary_align(size_t position){
+    return (position + binary_alignment - 1) / binary_alignment * binary_alignment;
+}
+
+/// Writes the array to the stream starting at an aligned position and moves the position past it
+template<class T>
+void write_binary_array(ostream& output, size_t& position, const T* data, size_t count){
+    const char padding[binary_alignment] = {};
+    output.write(padding, binary_align(position) - position);
+    output.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+    position = binary_align(position) + count * sizeof(T);
+}
+
+/// Checks that the file was saved for the same types of actions and storage
+template<class ActionType, class PType, class IType>
+void check_binary_header(const BinaryHeader& header, const string& filename){
+    if(!equal(begin(binary_identifier), end(binary_identifier), header.identifier))
+        throw invalid_argument("Not a binary model file: " + filename);
+    if(header.version != binary_version)
+        throw invalid_argument("Unsupported binary model version: " + std::to_string(header.version));
+    if(header.byteorder != binary_byteorder)
+        throw invalid_argument("Binary model file was saved with a different byte order.");
+    if(header.actiontype != action_type_code((const ActionType*) nullptr))
+        throw invalid_argument("Binary model file was saved with a different type of actions.");
+    if(header.ptypesize != sizeof(PType) || header.itypesize != sizeof(IType))
+        throw invalid_argument("Binary model file was saved with different storage types.");
+    if((header.flags & ~binary_delta_indices) != 0)
+        throw invalid_argument("Unsupported binary model flags.");
+
+    // the offset tables have one more element than the counts
+    const uint64_t maxcount = numeric_limits<int64_t>::max() / sizeof(size_t);
+    const bool parameters = has_action_parameters((const ActionType*) nullptr);
+    if(header.states >= maxcount || header.actions >= maxcount || header.outcomes >= maxcount
+            || header.nonzeros >= maxcount
+            || header.thresholds != (parameters ? header.actions : 0)
+            || header.distribution != (parameters ? header.outcomes : 0))
+        throw invalid_argument("Binary model file is corrupted.");
+}
+
+/// Checks that the offsets start at 0, do not decrease, and end with the size of the next array
+inline void check_binary_offsets(const SharedArray<size_t>& offsets, uint64_t last){
+    if(offsets[0] != 0 || offsets[offsets.size() - 1] != last)
+        throw invalid_argument("Binary model file is corrupted.");
+    for(size_t i = 1; i < offsets.size(); i++){
+        if(offsets[i] < offsets[i-1])
+            throw invalid_argument("Binary model file is corrupted.");
+    }
+}
+
+/**
+Reads the array from the mapped file starting at an aligned position.
+Moves the position past the end of the array.
+*/
+template<class T>
+SharedArray<T> map_binary_array(const shared_ptr<const void>& mapped, size_t filesize,
+                                size_t& position, uint64_t count){
+    position = binary_align(position);
+    if(position > filesize || count > (filesize - position) / sizeof(T))
+        throw invalid_argument("Binary model file is truncated.");
+    const T* first = reinterpret_cast<const T*>(static_cast<const char*>(mapped.get()) + position);
+    position += count * sizeof(T);
+    return SharedArray<T>(first, count, mapped);
+}
+
+/**
+Reads the array from a stream starting at an aligned position.
+Moves the position past the end of the array.
+*/
+template<class T>
+SharedArray<T> read_binary_array(istream& input, size_t& position, uint64_t count){
+    input.ignore(binary_align(position) - position);
+    vector<T> values(count);
+    input.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+    if(!input)
+        throw invalid_argument("Binary model file is truncated.");
+    position = binary_align(position) + count * sizeof(T);
+    return SharedArray<T>(move(values));
+}
+
+template<class SType, class PType, class IType>
+void CompressedMDP<SType,PType,IType>::to_binary_file(const string& filename) const{
+    auto output = open_output_file(filename);
+    // the small differences of sorted target states compress much better
+    const bool delta = is_compressed_name(filename);
+
+    BinaryHeader header = {};
+    copy(begin(binary_identifier), end(binary_identifier), header.identifier);
+    header.version = binary_version;
+    header.byteorder = binary_byteorder;
+    header.actiontype = action_type_code((const ActionType*) nullptr);
+    header.ptypesize = sizeof(PType);
+    header.itypesize = sizeof(IType);
+    header.flags = delta ? binary_delta_indices : 0;
+    header.states = state_count();
+    header.actions = action_count();
+    header.outcomes = outcome_count();
+    header.nonzeros = nonzero_count();
+    header.thresholds = thresholds.size();
+    header.distribution = distribution.size();
+    output->write(reinterpret_cast<const char*>(&header), sizeof(header));
+    size_t position = sizeof(header);
+
+    write_binary_array(*output, position, state_offsets.data(), state_offsets.size());
+    write_binary_array(*output, position, action_offsets.data(), action_offsets.size());
+    write_binary_array(*output, position, outcome_offsets.data(), outcome_offsets.size());
+    if(delta){
+        vector<IType> differences(indices.size());
+        for(size_t o = 0; o < outcome_count(); o++){
+            IType previous = 0;
+            for(size_t i = outcome_offsets[o]; i < outcome_offsets[o+1]; i++){
+                differences[i] = indices[i] - previous;
+                previous = indices[i];
+            }
+        }
+        write_binary_array(*output, position, differences.data(), differences.size());
+    }else{
+        write_binary_array(*output, position, indices.data(), indices.size());
+    }
+    write_binary_array(*output, position, probabilities.data(), probabilities.size());
+    write_binary_array(*output, position, rewards.data(), rewards.size());
+    write_binary_array(*output, position, valid.data(), valid.size());
+    write_binary_array(*output, position, thresholds.data(), thresholds.size());
+    write_binary_array(*output, position, distribution.data(), distribution.size());
+
+    close_output_file(move(output), filename);
+}
+
+template<class SType, class PType, class IType>
+CompressedMDP<SType,PType,IType> CompressedMDP<SType,PType,IType>::from_binary_file(const string& filename){
+    CompressedMDP result;
+    BinaryHeader header;
+
+    if(is_compressed_file(filename)){
+        // compressed files cannot be mapped and are decompressed to memory
+        auto input = open_input_file(filename);
+        if(!input->read(reinterpret_cast<char*>(&header), sizeof(header)))
+            throw invalid_argument("Not a binary model file: " + filename);
+        check_binary_header<ActionType,PType,IType>(header, filename);
+
+        size_t position = sizeof(BinaryHeader);
+        result.state_offsets = read_binary_array<size_t>(*input, position, header.states + 1);
+        result.action_offsets = read_binary_array<size_t>(*input, position, header.actions + 1);
+        result.outcome_offsets = read_binary_array<size_t>(*input, position, header.outcomes + 1);
+        result.indices = read_binary_array<IType>(*input, position, header.nonzeros);
+        result.probabilities = read_binary_array<PType>(*input, position, header.nonzeros);
+        result.rewards = read_binary_array<PType>(*input, position, header.nonzeros);
+        result.valid = read_binary_array<uint8_t>(*input, position, header.actions);
+        result.thresholds = read_binary_array<prec_t>(*input, position, header.thresholds);
+        result.distribution = read_binary_array<prec_t>(*input, position, header.distribution);
+        // the checksum of the compressed stream is verified only at its end
+        if(input->peek() != istream::traits_type::eof() || input->bad())
+            throw invalid_argument("Binary model file is corrupted.");
+    }else{
+        const int descriptor = ::open(filename.c_str(), O_RDONLY);
+        if(descriptor < 0)
+            throw invalid_argument("Cannot open file: " + filename);
+
+        struct stat status;
+        if(::fstat(descriptor, &status) != 0){
+            ::close(descriptor);
+            throw invalid_argument("Cannot read file: " + filename);
+        }
+        const size_t filesize = status.st_size;
+        if(filesize < sizeof(BinaryHeader)){
+            ::close(descriptor);
+            throw invalid_argument("Not a binary model file: " + filename);
+        }
+
+        void* address = ::mmap(nullptr, filesize, PROT_READ, MAP_SHARED, descriptor, 0);
+        // the mapping remains valid after the file is closed
+        ::close(descriptor);
+        if(address == MAP_FAILED)
+            throw invalid_argument("Cannot map file to memory: " + filename);
+        const shared_ptr<const void> mapped(address, [filesize](const void* a){::munmap(const_cast<void*>(a), filesize);});
+
+        header = *static_cast<const BinaryHeader*>(address);
+        check_binary_header<ActionType,PType,IType>(header, filename);
+
+        size_t position = sizeof(BinaryHeader);
+        result.state_offsets = map_binary_array<size_t>(mapped, filesize, position, header.states + 1);
+        result.action_offsets = map_binary_array<size_t>(mapped, filesize, position, header.actions + 1);
+        result.outcome_offsets = map_binary_array<size_t>(mapped, filesize, position, header.outcomes + 1);
+        result.indices = map_binary_array<IType>(mapped, filesize, position, header.nonzeros);
+        result.probabilities = map_binary_array<PType>(mapped, filesize, position, header.nonzeros);
+        result.rewards = map_binary_array<PType>(mapped, filesize, position, header.nonzeros);
+        result.valid = map_binary_array<uint8_t>(mapped, filesize, position, header.actions);
+        result.thresholds = map_binary_array<prec_t>(mapped, filesize, position, header.thresholds);
+        result.distribution = map_binary_array<prec_t>(mapped, filesize, position, header.distribution);
+    }
+
+    // the solvers do not check the offsets and target states, so a corrupted
+    // file must not be accepted
+    check_binary_offsets(result.state_offsets, header.actions);
+    check_binary_offsets(result.action_offsets, header.outcomes);
+    check_binary_offsets(result.outcome_offsets, header.nonzeros);
+
+    // decodes the differences and checks that the target states are in range
+    const bool delta = header.flags & binary_delta_indices;
+    const int64_t states = header.states;
+    vector<IType> targets(delta ? header.nonzeros : 0);
+    for(size_t o = 0; o < header.outcomes; o++){
+        int64_t previous = 0;
+        for(size_t i = result.outcome_offsets[o]; i < result.outcome_offsets[o+1]; i++){
+            const int64_t base = delta ? previous : 0, value = result.indices[i];
+            // compared before adding to avoid an overflow
+            if(value < -base || value >= states - base)
+                throw invalid_argument("Binary model file is corrupted.");
+            if(delta)
+                targets[i] = IType(previous = base + value);
+        }
+    }
+    if(delta)
+        result.indices = SharedArray<IType>(move(targets));
+    return result;
+}
+
+template<class SType, class PType, class IType>
+StateBlocks CompressedMDP<SType,PType,IType>::state_blocks() const{
+    const Schedule schedule = get_schedule();
+    if(schedule == Schedule::Static)
+        return StateBlocks(state_count());
+
+    // the number of actions and transitions, as in GRMDP::state_costs
+    indvec costs(state_count());
+    for(size_t s = 0; s < state_count(); s++){
+        const size_t first = state_offsets[s], last = state_offsets[s+1];
+        costs[s] = (last - first) + (outcome_offsets[action_offsets[last]] -
+                                     outcome_offsets[action_offsets[first]]);
+    }
+    return StateBlocks(costs, schedule);
+}
+
+template<class SType, class PType, class IType>
+prec_t CompressedMDP<SType,PType,IType>::outcome_value(size_t outcomeindex, const numvec& valuefunction,
+                                           prec_t discount) const{
+    const size_t first = outcome_offsets[outcomeindex], last = outcome_offsets[outcomeindex+1];
+
+    if(first == last)
+        throw range_error("No transitions defined. Cannot compute value.");
+
+    return sparse_value(probabilities.data() + first, rewards.data() + first, indices.data() + first,
+                        last - first, valuefunction.data(), discount);
+}
+
+template<class SType, class PType, class IType>
+template<Uncertainty type>
+auto CompressedMDP<SType,PType,IType>::action_value(size_t actionindex, const numvec& valuefunction,
+                                        prec_t discount) const -> pair<OutcomeId,prec_t>{
+    switch(type){
+    case Uncertainty::Robust:
+        return action_minimal(actionindex, valuefunction, discount);
+    case Uncertainty::Optimistic:
+        return action_maximal(actionindex, valuefunction, discount);
+    default: // Uncertainty::Average
+        return make_pair(OutcomeId(), action_average(actionindex, valuefunction, discount));
+    }
+}
+
+template<class SType, class PType, class IType>
+template<Uncertainty type>
+prec_t CompressedMDP<SType,PType,IType>::state_value(long stateid, const numvec& valuefunction, prec_t discount,
+                                         ActionId& actionid, OutcomeId& outcomeid) const{
+
+    const size_t first = state_offsets[stateid], last = state_offsets[stateid+1];
+
+    actionid = -1;
+    // this is the terminal state, return 0
+    if(first == last){
+        outcomeid = OutcomeId();
+        return 0;
+    }
+
+    prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+
+    for(size_t i = first; i < last; i++){
+        // skip invalid actions
+        if(!valid[i]) continue;
+
+        auto value = action_value<type>(i, valuefunction, discount);
+        if(value.second > maxvalue){
+            maxvalue = value.second;
+            actionid = i - first;
+            outcomeid = move(value.first);
+        }
+    }
+    // no valid action
+    if(actionid < 0) outcomeid = OutcomeId();
+    return maxvalue;
+}
+
+template<class SType, class PType, class IType>
+template<Uncertainty type>
+prec_t CompressedMDP<SType,PType,IType>::state_value_fixed(long stateid, const numvec& valuefunction, prec_t discount,
+                                               ActionId actionid, const OutcomeId& outcomeid) const{
+    if(type == Uncertainty::Average)
+        return state_fixed_average(stateid, valuefunction, discount, actionid);
+    else
+        return state_fixed_fixed(stateid, valuefunction, discount, actionid, outcomeid);
+}
+
+template<class SType, class PType, class IType>
+prec_t CompressedMDP<SType,PType,IType>::state_fixed_average(long stateid, const numvec& valuefunction,
+                                                 prec_t discount, ActionId actionid) const{
+    const size_t first = state_offsets[stateid], last = state_offsets[stateid+1];
+
+    // this is the terminal state, return 0
+    if(first == last)
+        return 0;
+
+    if(actionid < 0 || actionid >= (long) (last - first))
+        throw range_error("invalid actionid: " + std::to_string(actionid) + " for action count: " + std::to_string(last - first) );
+
+    // cannot assume invalid actions
+    if(!valid[first + actionid]) throw invalid_argument("Cannot take an invalid action");
+
+    return action_average(first + actionid, valuefunction, discount);
+}
+
+template<class SType, class PType, class IType>
+prec_t CompressedMDP<SType,PType,IType>::state_fixed_fixed(long stateid, const numvec& valuefunction, prec_t discount,
+                                               ActionId actionid, const OutcomeId& outcomeid) const{
+    const size_t first = state_offsets[stateid], last = state_offsets[stateid+1];
+
+    // this is the terminal state, return 0
+    if(first == last)
+        return 0;
+
+    if(actionid < 0 || actionid >= (long) (last - first))
+        throw range_error("invalid actionid: " + std::to_string(actionid) + " for action count: " + std::to_string(last - first) );
+
+    // cannot assume invalid actions
+    if(!valid[first + actionid]) throw invalid_argument("Cannot take an invalid action");
+
+    return action_fixed(first + actionid, valuefunction, discount, outcomeid);
+}
+
+template<class SType, class PType, class IType>
+auto CompressedMDP<SType,PType,IType>::vi_gs(Uncertainty type, prec_t discount, numvec valuefunction,
+                                 unsigned long iterations, prec_t maxresidual) const -> SolType {
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_gs_t<Uncertainty::Robust>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_gs_t<Uncertainty::Optimistic>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_gs_t<Uncertainty::Average>(discount, move(valuefunction), iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType, class PType, class IType>
+template<Uncertainty type>
+auto CompressedMDP<SType,PType,IType>::vi_gs_t(prec_t discount, numvec valuefunction,
+                                   unsigned long iterations, prec_t maxresidual) const -> SolType {
+
+    const size_t n = state_count();
+
+    // just quit if there are not states
+    if(n == 0)
+        return SolType();
+
+    // check if the value function is a correct size, and if it is length 0
+    // then creates an appropriate size
+    if(valuefunction.size() > 0){
+        if(valuefunction.size() != n)
+            throw invalid_argument("Incorrect dimensions of value function.");
+    }else
+        valuefunction.assign(n, 0.0);
+
+    ActionPolicy policy(n);
+    OutcomePolicy outcomes(n);
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    size_t i;
+
+    for(i = 0; i < iterations && residual > maxresidual; i++){
+        residual = 0;
+
+        for(size_t s = 0l; s < n; s++){
+            prec_t newvalue = state_value<type>(s, valuefunction, discount, policy[s], outcomes[s]);
+
+            residual = max(residual, abs(valuefunction[s] - newvalue));
+            valuefunction[s] = newvalue;
+        }
+    }
+    return SolType(move(valuefunction),move(policy),move(outcomes),residual,i,i);
+}
+
+template<class SType, class PType, class IType>
+auto CompressedMDP<SType,PType,IType>::vi_jac(Uncertainty type, prec_t discount, const numvec& valuefunction,
+                                  unsigned long iterations, prec_t maxresidual,
+                                  size_t anderson_history) const -> SolType{
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_jac_t<Uncertainty::Robust>(discount, valuefunction, iterations, maxresidual,
+                                             anderson_history);
+    case Uncertainty::Optimistic:
+        return vi_jac_t<Uncertainty::Optimistic>(discount, valuefunction, iterations, maxresidual,
+                                                 anderson_history);
+    case Uncertainty::Average:
+        return vi_jac_t<Uncertainty::Average>(discount, valuefunction, iterations, maxresidual,
+                                              anderson_history);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType, class PType, class IType>
+template<Uncertainty type>
+auto CompressedMDP<SType,PType,IType>::vi_jac_t(prec_t discount, const numvec& valuefunction,
+                                    unsigned long iterations, prec_t maxresidual,
+                                    size_t anderson_history) const -> SolType{
+
+    const size_t n = state_count();
+
+    // just quit if there are not states
+    if(n == 0)
+        return SolType();
+
+    if( (valuefunction.size() > 0) && (valuefunction.size() != n) )
+        throw invalid_argument("Incorrect size of value function.");
+
+    numvec oddvalue(0);        // set in even iterations (0 is even)
+    numvec evenvalue(0);       // set in odd iterations
+
+    if(valuefunction.size() > 0){
+        oddvalue = valuefunction;
+        evenvalue = valuefunction;
+    }else{
+        oddvalue.assign(n,0);
+        evenvalue.assign(n,0);
+    }
+
+    ActionPolicy policy(n);
+    OutcomePolicy outcomes(n);
+
+    numvec residuals(n);
+    const StateBlocks blocks = state_blocks();
+
+    AndersonAcceleration anderson(n, anderson_history);
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    size_t i;
+
+    for(i = 0; i < iterations && residual > maxresidual; i++){
+        numvec & sourcevalue = i % 2 == 0 ? oddvalue  : evenvalue;
+        numvec & targetvalue = i % 2 == 0 ? evenvalue : oddvalue;
+
+        parallel_for_states(blocks, [&](long s){
+            prec_t newvalue = state_value<type>(s, sourcevalue, discount, policy[s], outcomes[s]);
+
+            residuals[s] = abs(sourcevalue[s] - newvalue);
+            targetvalue[s] = newvalue;
+        });
+        residual = *max_element(residuals.begin(),residuals.end());
+
+        // extrapolate the next value function unless it is final; the returned
+        // value function must be the one from which the policy was computed
+        if(anderson_history > 0 && residual > maxresidual && i + 1 < iterations)
+            anderson.mix(sourcevalue, targetvalue, residual);
+    }
+    numvec & valuenew = i % 2 == 0 ? oddvalue : evenvalue;
+    return SolType(move(valuenew),move(policy),move(outcomes),residual,i,i);
+}
+
+template<class SType, class PType, class IType>
+auto CompressedMDP<SType,PType,IType>::mpi_jac(Uncertainty type,
+                                   prec_t discount,
+                                   const numvec& valuefunction,
+                                   unsigned long iterations_pi,
+                                   prec_t maxresidual_pi,
+                                   unsigned long iterations_vi,
+                                   prec_t maxresidual_vi,
+                                   bool show_progress,
+                                   size_t anderson_history) const -> SolType{
+    switch(type){
+    case Uncertainty::Robust:
+        return mpi_jac_t<Uncertainty::Robust>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                              iterations_vi, maxresidual_vi, show_progress,
+                                              anderson_history);
+    case Uncertainty::Optimistic:
+        return mpi_jac_t<Uncertainty::Optimistic>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                                  iterations_vi, maxresidual_vi, show_progress,
+                                                  anderson_history);
+    case Uncertainty::Average:
+        return mpi_jac_t<Uncertainty::Average>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                               iterations_vi, maxresidual_vi, show_progress,
+                                               anderson_history);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType, class PType, class IType>
+template<Uncertainty type>
+auto CompressedMDP<SType,PType,IType>::mpi_jac_t(prec_t discount,
+                                     const numvec& valuefunction,
+                                     unsigned long iterations_pi,
+                                     prec_t maxresidual_pi,
+                                     unsigned long iterations_vi,
+                                     prec_t maxresidual_vi,
+                                     bool show_progress,
+                                     size_t anderson_history) const -> SolType{
+
+    const size_t n = state_count();
+
+    // just quit if there are not states
+    if(n == 0)
+        return SolType();
+
+    if( (valuefunction.size() > 0) && (valuefunction.size() != n) )
+        throw invalid_argument("Incorrect size of value function.");
+
+    numvec oddvalue(0);        // set in even iterations (0 is even)
+    numvec evenvalue(0);       // set in odd iterations
+
+    if(valuefunction.size() > 0){
+        oddvalue = valuefunction;
+        evenvalue = valuefunction;
+    }else{
+        oddvalue.assign(n,0);
+        evenvalue.assign(n,0);
+    }
+
+    ActionPolicy policy(n);
+    OutcomePolicy outcomes(n);
+
+    numvec residuals(n);
+    const StateBlocks blocks = state_blocks();
+
+    AndersonAcceleration anderson(n, anderson_history);
+
+    prec_t residual_pi = numeric_limits<prec_t>::infinity();
+
+    size_t i; // defined here to be able to report the number of iterations
+    size_t sweeps = 0;
+
+    numvec * sourcevalue = & oddvalue;
+    numvec * targetvalue = & evenvalue;
+
+    for(i = 0; i < iterations_pi; i++){
+
+        if(show_progress)
+            cout << "Policy iteration " << i << "/" << iterations_pi << ":" << endl;
+
+        std::swap<numvec*>(targetvalue, sourcevalue);
+
+        prec_t residual_vi = numeric_limits<prec_t>::infinity();
+
+        // update policies
+        parallel_for_states(blocks, [&](long s){
+            prec_t newvalue = state_value<type>(s, *sourcevalue, discount, policy[s], outcomes[s]);
+
+            residuals[s] = abs((*sourcevalue)[s] - newvalue);
+            (*targetvalue)[s] = newvalue;
+        });
+        sweeps++;
+
+        residual_pi = *max_element(residuals.begin(),residuals.end());
+
+        if(show_progress)
+            cout << "    Bellman residual: " << residual_pi << endl;
+
+        // the residual is sufficiently small
+        if(residual_pi <= maxresidual_pi)
+            break;
+
+        if(show_progress)
+            cout << "    Value iteration: ";
+
+        // the history of the previous policy does not apply
+        anderson.reset();
+
+        // compute values using value iteration
+        for(size_t j = 0; j < iterations_vi && residual_vi > maxresidual_vi; j++){
+            if(show_progress)
+                cout << ".";
+
+            swap(targetvalue, sourcevalue);
+
+            parallel_for_states(blocks, [&](long s){
+                prec_t newvalue = state_value_fixed<type>(s, *sourcevalue, discount,
+                                                          policy[s], outcomes[s]);
+
+                residuals[s] = abs((*sourcevalue)[s] - newvalue);
+                (*targetvalue)[s] = newvalue;
+            });
+            residual_vi = *max_element(residuals.begin(),residuals.end());
+            sweeps++;
+
+            // extrapolate the next value function unless it is final
+            if(anderson_history > 0 && residual_vi > maxresidual_vi && j + 1 < iterations_vi)
+                anderson.mix(*sourcevalue, *targetvalue, residual_vi);
+        }
+        if(show_progress)
+            cout << endl << "    Residual (fixed policy): " << residual_vi << endl << endl;
+    }
+    numvec & valuenew = *targetvalue;
+    return SolType(move(valuenew),move(policy),move(outcomes),residual_pi,i,sweeps);
+}
+
+template<class SType, class PType, class IType>
+auto CompressedMDP<SType,PType,IType>::vi_jac_fix(prec_t discount,
+                                      const ActionPolicy& policy,
+                                      const OutcomePolicy& natpolicy,
+                                      const numvec& valuefunction,
+                                      unsigned long iterations,
+                                      prec_t maxresidual) const -> SolType{
+
+    const size_t n = state_count();
+
+    // just quit if there are not states
+    if(n == 0)
+        return SolType();
+
+    if(policy.size() != n)
+        throw invalid_argument("Dimension of the policy must match the state count.");
+    if(natpolicy.size() != n)
+        throw invalid_argument("Dimension of the nature's policy must match the state count.");
+
+    numvec oddvalue(0);        // set in even iterations (0 is even)
+    numvec evenvalue(0);       // set in odd iterations
+
+    if(valuefunction.size() > 0){
+        oddvalue = valuefunction;
+        evenvalue = valuefunction;
+    }else{
+        oddvalue.assign(n,0);
+        evenvalue.assign(n,0);
+    }
+
+    numvec residuals(n);
+    const StateBlocks blocks = state_blocks();
+    prec_t residual = numeric_limits<prec_t>::infinity();
+
+    size_t j; // defined here to be able to report the number of iterations
+
+    numvec * sourcevalue = & oddvalue;
+    numvec * targetvalue = & evenvalue;
+
+    for(j = 0; j < iterations && residual > maxresidual; j++){
+
+        swap(targetvalue, sourcevalue);
+
+        parallel_for_states(blocks, [&](long s){
+            auto newvalue = state_fixed_fixed(s,*sourcevalue,discount,policy[s],natpolicy[s]);
+
+            residuals[s] = abs((*sourcevalue)[s] - newvalue);
+            (*targetvalue)[s] = newvalue;
+        });
+        residual = *max_element(residuals.begin(),residuals.end());
+    }
+
+    return SolType(move(*targetvalue),policy,natpolicy,residual,j,j);
+}
+
+// **********************************************************************
+// *********************    TEMPLATE DECLARATIONS    ********************
+// **********************************************************************
+
+template class CompressedMDP<RegularState>;
+template class CompressedMDP<DiscreteRobustState>;
+template class CompressedMDP<L1RobustState>;
+
+template class CompressedMDP<RegularState,float,int32_t>;
+template class CompressedMDP<DiscreteRobustState,float,int32_t>;
+template class CompressedMDP<L1RobustState,float,int32_t>;
+
+}
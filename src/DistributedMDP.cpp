@@ -0,0 +1,382 @@
+#include "DistributedMDP.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <cmath>
+
+#include "cpp11-range-master/range.hpp"
+
+namespace craam {
+
+using namespace util::lang;
+
+static_assert(is_same<prec_t, double>::value, "The MPI datatype of values is MPI_DOUBLE.");
+static_assert(is_same<indvec::value_type, long>::value, "The MPI datatype of indices is MPI_LONG.");
+
+// **************************************************************************************
+//  Gathering blocks of vectors
+// **************************************************************************************
+
+/** Gathers the blocks of indices (actions or outcomes) of all ranks */
+static vector<long> allgather_blocks(const vector<long>& block, const vector<int>& counts,
+                                     const vector<int>& displs, MPI_Comm comm){
+    vector<long> result(displs.back() + counts.back());
+    MPI_Allgatherv(block.data(), block.size(), MPI_LONG,
+                   result.data(), counts.data(), displs.data(), MPI_LONG, comm);
+    return result;
+}
+
+/** Gathers the blocks of distributions of nature of all ranks */
+static vector<numvec> allgather_blocks(const vector<numvec>& block, const vector<int>& counts,
+                                       const vector<int>& displs, MPI_Comm comm){
+    // lengths of the distributions
+    vector<long> lengths(block.size());
+    for(size_t i : indices(block))
+        lengths[i] = block[i].size();
+    const vector<long> alllengths = allgather_blocks(lengths, counts, displs, comm);
+
+    // the total length of the distributions of each rank
+    vector<int> flatcounts(counts.size(), 0), flatdispls(counts.size(), 0);
+    for(size_t r : indices(counts)){
+        for(int i = displs[r]; i < displs[r] + counts[r]; i++)
+            flatcounts[r] += alllengths[i];
+        if(r > 0) flatdispls[r] = flatdispls[r-1] + flatcounts[r-1];
+    }
+
+    numvec flat;
+    for(const auto& distribution : block)
+        flat.insert(flat.end(), distribution.begin(), distribution.end());
+
+    numvec allflat(flatdispls.back() + flatcounts.back());
+    MPI_Allgatherv(flat.data(), flat.size(), MPI_DOUBLE,
+                   allflat.data(), flatcounts.data(), flatdispls.data(), MPI_DOUBLE, comm);
+
+    vector<numvec> result(alllengths.size());
+    auto position = allflat.cbegin();
+    for(size_t i : indices(result)){
+        result[i].assign(position, position + alllengths[i]);
+        position += alllengths[i];
+    }
+    return result;
+}
+
+// **************************************************************************************
+//  Distributed MDP
+// **************************************************************************************
+
+template<class SType>
+DistributedMDP<SType>::DistributedMDP(const GRMDP<SType>& mdp, MPI_Comm comm) : comm(comm) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+
+    const long statecount = mdp.state_count();
+    const long first = (statecount * rank) / ranks;
+    const long last = (statecount * (rank + 1)) / ranks;
+    initialize(mdp, first, first, last - first);
+}
+
+template<class SType>
+DistributedMDP<SType>::DistributedMDP(const GRMDP<SType>& block, long first, MPI_Comm comm) : comm(comm) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+
+    initialize(block, 0, first, block.state_count());
+}
+
+template<class SType>
+void DistributedMDP<SType>::initialize(const GRMDP<SType>& source, long offset, long first, long count){
+    // the blocks of all ranks
+    vector<long> allfirsts(ranks), allcounts(ranks);
+    MPI_Allgather(&first, 1, MPI_LONG, allfirsts.data(), 1, MPI_LONG, comm);
+    MPI_Allgather(&count, 1, MPI_LONG, allcounts.data(), 1, MPI_LONG, comm);
+
+    firsts.assign(allfirsts.begin(), allfirsts.end());
+    firsts.push_back(allfirsts.back() + allcounts.back());
+    if(firsts[0] != 0)
+        throw invalid_argument("The block of the first rank must start with state 0.");
+    for(int r = 0; r < ranks; r++){
+        if(allcounts[r] < 0 || firsts[r] + allcounts[r] != firsts[r+1])
+            throw invalid_argument("The blocks of states must be contiguous and ordered by rank.");
+    }
+    const long statecount = firsts.back();
+
+    // ghost states: targets outside of the block
+    bool correct = true;
+    for(long s = offset; s < offset + count; s++){
+        for(const auto& action : source[s].get_actions()){
+            for(size_t o = 0; o < action.outcome_count(); o++){
+                for(long t : action.get_outcome(o).get_indices()){
+                    if(t < 0 || t >= statecount) correct = false;
+                    else if(t < first || t >= first + count) ghosts.push_back(t);
+                }
+            }
+        }
+    }
+    sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(unique(ghosts.begin(), ghosts.end()), ghosts.end());
+
+    // all ranks must fail together to avoid a deadlock in collective operations
+    int allcorrect = correct;
+    MPI_Allreduce(MPI_IN_PLACE, &allcorrect, 1, MPI_INT, MPI_LAND, comm);
+    if(!allcorrect)
+        throw invalid_argument("Transitions lead to states outside of the model.");
+
+    // copy the states with the targets renumbered locally; see GRMDP::permute_states
+    local = GRMDP<SType>(count);
+    #pragma omp parallel
+    {
+        indvec targets;
+
+        #pragma omp for schedule(static)
+        for(long s = 0; s < count; s++){
+            SType& state = local.get_state(s);
+            state = source[offset + s];
+
+            for(size_t a : indices(state)){
+                auto& action = state.get_action(a);
+                for(size_t o = 0; o < action.outcome_count(); o++){
+                    Transition& transition = action.get_outcome(o);
+                    targets.clear();
+                    for(long t : transition.get_indices()){
+                        if(t >= first && t < first + count)
+                            targets.push_back(t - first);
+                        else
+                            targets.push_back(count +
+                                    (lower_bound(ghosts.begin(), ghosts.end(), t) - ghosts.begin()));
+                    }
+                    transition = Transition(targets, transition.get_probabilities(),
+                                            transition.get_rewards());
+                }
+            }
+        }
+    }
+
+    // ghosts are sorted, so the ghosts of each owner are contiguous
+    recvcounts.assign(ranks, 0);
+    for(long g : ghosts)
+        recvcounts[upper_bound(firsts.begin(), firsts.end(), g) - firsts.begin() - 1]++;
+    recvdispls.assign(ranks, 0);
+    for(int r = 1; r < ranks; r++)
+        recvdispls[r] = recvdispls[r-1] + recvcounts[r-1];
+
+    // tell the owners which values to send
+    sendcounts.assign(ranks, 0);
+    MPI_Alltoall(recvcounts.data(), 1, MPI_INT, sendcounts.data(), 1, MPI_INT, comm);
+    senddispls.assign(ranks, 0);
+    for(int r = 1; r < ranks; r++)
+        senddispls[r] = senddispls[r-1] + sendcounts[r-1];
+
+    sendstates.resize(senddispls.back() + sendcounts.back());
+    MPI_Alltoallv(ghosts.data(), recvcounts.data(), recvdispls.data(), MPI_LONG,
+                  sendstates.data(), sendcounts.data(), senddispls.data(), MPI_LONG, comm);
+    for(long& s : sendstates)
+        s -= first;
+}
+
+template<class SType>
+numvec DistributedMDP<SType>::local_values(const numvec& valuefunction) const{
+    const long count = local_state_count();
+    numvec result(count + ghosts.size(), 0.0);
+    if(valuefunction.empty())
+        return result;
+
+    if(valuefunction.size() != state_count())
+        throw invalid_argument("Incorrect size of value function.");
+    for(long s = 0; s < count; s++)
+        result[s] = valuefunction[get_first() + s];
+    for(size_t g : indices(ghosts))
+        result[count + g] = valuefunction[ghosts[g]];
+    return result;
+}
+
+template<class SType>
+void DistributedMDP<SType>::exchange(numvec& values) const{
+    numvec sendvalues(sendstates.size());
+    for(size_t i : indices(sendstates))
+        sendvalues[i] = values[sendstates[i]];
+
+    MPI_Alltoallv(sendvalues.data(), sendcounts.data(), senddispls.data(), MPI_DOUBLE,
+                  values.data() + local_state_count(), recvcounts.data(), recvdispls.data(),
+                  MPI_DOUBLE, comm);
+}
+
+template<class SType>
+prec_t DistributedMDP<SType>::max_all(prec_t value) const{
+    MPI_Allreduce(MPI_IN_PLACE, &value, 1, MPI_DOUBLE, MPI_MAX, comm);
+    return value;
+}
+
+template<class SType>
+auto DistributedMDP<SType>::gather(const numvec& values, const ActionPolicy& policy,
+                                   const OutcomePolicy& outcomes, prec_t residual,
+                                   long iterations, long sweeps) const -> SolType{
+    vector<int> counts(ranks), displs(ranks);
+    for(int r = 0; r < ranks; r++){
+        counts[r] = firsts[r+1] - firsts[r];
+        displs[r] = firsts[r];
+    }
+
+    numvec valuefunction(state_count());
+    MPI_Allgatherv(values.data(), local_state_count(), MPI_DOUBLE,
+                   valuefunction.data(), counts.data(), displs.data(), MPI_DOUBLE, comm);
+
+    return SolType(move(valuefunction), allgather_blocks(policy, counts, displs, comm),
+                   allgather_blocks(outcomes, counts, displs, comm), residual, iterations, sweeps);
+}
+
+template<class SType>
+auto DistributedMDP<SType>::vi_jac(Uncertainty type, prec_t discount, const numvec& valuefunction,
+                                   unsigned long iterations, prec_t maxresidual) const -> SolType{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_jac_t<Uncertainty::Robust>(discount, valuefunction, iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_jac_t<Uncertainty::Optimistic>(discount, valuefunction, iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_jac_t<Uncertainty::Average>(discount, valuefunction, iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto DistributedMDP<SType>::vi_jac_t(prec_t discount, const numvec& valuefunction,
+                                     unsigned long iterations, prec_t maxresidual) const -> SolType{
+    // just quit if there are not states
+    if(state_count() == 0)
+        return SolType();
+
+    const long count = local_state_count();
+
+    numvec oddvalue = local_values(valuefunction);      // set in even iterations (0 is even)
+    numvec evenvalue = oddvalue;                        // set in odd iterations
+
+    ActionPolicy policy(count);
+    OutcomePolicy outcomes(count);
+
+    numvec residuals(count, 0.0);
+    const StateBlocks blocks = local.state_blocks();
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    size_t i;
+
+    for(i = 0; i < iterations && residual > maxresidual; i++){
+        numvec & sourcevalue = i % 2 == 0 ? oddvalue  : evenvalue;
+        numvec & targetvalue = i % 2 == 0 ? evenvalue : oddvalue;
+
+        exchange(sourcevalue);
+
+        parallel_for_states(blocks, [&](long s){
+            prec_t newvalue = state_value<type>(local[s], sourcevalue, discount,
+                                                policy[s], outcomes[s]);
+
+            residuals[s] = abs(sourcevalue[s] - newvalue);
+            targetvalue[s] = newvalue;
+        });
+        residual = max_all(count > 0 ? *max_element(residuals.begin(),residuals.end()) : 0.0);
+    }
+    numvec & valuenew = i % 2 == 0 ? oddvalue : evenvalue;
+    return gather(valuenew,policy,outcomes,residual,i,i);
+}
+
+template<class SType>
+auto DistributedMDP<SType>::mpi_jac(Uncertainty type, prec_t discount, const numvec& valuefunction,
+                                    unsigned long iterations_pi, prec_t maxresidual_pi,
+                                    unsigned long iterations_vi, prec_t maxresidual_vi) const -> SolType{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return mpi_jac_t<Uncertainty::Robust>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                              iterations_vi, maxresidual_vi);
+    case Uncertainty::Optimistic:
+        return mpi_jac_t<Uncertainty::Optimistic>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                                  iterations_vi, maxresidual_vi);
+    case Uncertainty::Average:
+        return mpi_jac_t<Uncertainty::Average>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                               iterations_vi, maxresidual_vi);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto DistributedMDP<SType>::mpi_jac_t(prec_t discount, const numvec& valuefunction,
+                                      unsigned long iterations_pi, prec_t maxresidual_pi,
+                                      unsigned long iterations_vi, prec_t maxresidual_vi) const -> SolType{
+    // just quit if there are not states
+    if(state_count() == 0)
+        return SolType();
+
+    const long count = local_state_count();
+
+    numvec oddvalue = local_values(valuefunction);      // set in even iterations (0 is even)
+    numvec evenvalue = oddvalue;                        // set in odd iterations
+
+    ActionPolicy policy(count);
+    OutcomePolicy outcomes(count);
+
+    numvec residuals(count, 0.0);
+    const StateBlocks blocks = local.state_blocks();
+
+    prec_t residual_pi = numeric_limits<prec_t>::infinity();
+
+    size_t i; // defined here to be able to report the number of iterations
+    size_t sweeps = 0;
+
+    numvec * sourcevalue = & oddvalue;
+    numvec * targetvalue = & evenvalue;
+
+    for(i = 0; i < iterations_pi; i++){
+        std::swap<numvec*>(targetvalue, sourcevalue);
+
+        prec_t residual_vi = numeric_limits<prec_t>::infinity();
+
+        // update policies
+        exchange(*sourcevalue);
+        parallel_for_states(blocks, [&](long s){
+            prec_t newvalue = state_value<type>(local[s], *sourcevalue, discount,
+                                                policy[s], outcomes[s]);
+
+            residuals[s] = abs((*sourcevalue)[s] - newvalue);
+            (*targetvalue)[s] = newvalue;
+        });
+        sweeps++;
+
+        residual_pi = max_all(count > 0 ? *max_element(residuals.begin(),residuals.end()) : 0.0);
+
+        // the residual is sufficiently small
+        if(residual_pi <= maxresidual_pi)
+            break;
+
+        // compute values using value iteration
+        for(size_t j = 0; j < iterations_vi && residual_vi > maxresidual_vi; j++){
+            swap(targetvalue, sourcevalue);
+
+            exchange(*sourcevalue);
+            parallel_for_states(blocks, [&](long s){
+                prec_t newvalue = state_value_fixed<type>(local[s], *sourcevalue, discount,
+                                                          policy[s], outcomes[s]);
+
+                residuals[s] = abs((*sourcevalue)[s] - newvalue);
+                (*targetvalue)[s] = newvalue;
+            });
+            residual_vi = max_all(count > 0 ? *max_element(residuals.begin(),residuals.end()) : 0.0);
+            sweeps++;
+        }
+    }
+    numvec & valuenew = *targetvalue;
+    return gather(valuenew,policy,outcomes,residual_pi,i,sweeps);
+}
+
+// **************************************************************************************
+//  Specific template instantiations
+// **************************************************************************************
+
+template class DistributedMDP<RegularState>;
+template class DistributedMDP<DiscreteRobustState>;
+template class DistributedMDP<L1RobustState>;
+
+}
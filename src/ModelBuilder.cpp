@@ -0,0 +1,133 @@
+#include "ModelBuilder.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace craam {
+
+// **************************************************************************************
+//  Model builder
+// **************************************************************************************
+
+template<class SType>
+void ModelBuilder<SType>::add_transition(long fromid, long actionid, long outcomeid, long toid,
+                                         prec_t probability, prec_t reward){
+    if(fromid < 0 || actionid < 0 || outcomeid < 0 || toid < 0)
+        throw invalid_argument("State, action, and outcome ids must be non-negative.");
+    // the model is built in parallel, where an exception cannot be thrown
+    if(probability < -0.001)
+        throw invalid_argument("probabilities must be non-negative.");
+
+    // all states collected so far are complete when the sources are sorted
+    if(fromid > lastfrom && sorted && count >= flush_size)
+        flush();
+    sorted = sorted && fromid >= lastfrom;
+    lastfrom = fromid;
+
+    if(count == blocks.size() * block_size)
+        blocks.emplace_back(new Sample[block_size]);
+
+    blocks[count / block_size][count % block_size] =
+            Sample{fromid, actionid, outcomeid, toid, probability, reward};
+    count++;
+}
+
+template<class SType>
+void ModelBuilder<SType>::reserve(size_t samplecount){
+    while(blocks.size() * block_size < samplecount)
+        blocks.emplace_back(new Sample[block_size]);
+}
+
+template<class SType>
+void ModelBuilder<SType>::build(){
+    flush();
+    blocks.clear();
+    lastfrom = -1;
+    sorted = true;
+}
+
+template<class SType>
+void ModelBuilder<SType>::flush(){
+    if(count == 0) return;
+
+    // create all states at once, including the ones that are only targets
+    long minstate = (*this)[0].fromid, maxstate = -1;
+    for(size_t i = 0; i < count; i++){
+        minstate = min(minstate, (*this)[i].fromid);
+        maxstate = max(maxstate, max((*this)[i].fromid, (*this)[i].toid));
+    }
+    if(maxstate >= (long) mdp.state_count())
+        mdp.create_state(maxstate);
+
+    // sort the samples by the source state (counting sort over the range of sources);
+    // the number of samples of each state is also used to balance the work among threads
+    const size_t statecount = maxstate - minstate + 1;
+    indvec samplecounts(statecount, 0);
+    for(size_t i = 0; i < count; i++)
+        samplecounts[(*this)[i].fromid - minstate]++;
+
+    vector<size_t> offsets(statecount + 1, 0);
+    for(size_t s = 0; s < statecount; s++)
+        offsets[s+1] = offsets[s] + samplecounts[s];
+
+    vector<size_t> order(count);
+    {
+        vector<size_t> position(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < count; i++)
+            order[position[(*this)[i].fromid - minstate]++] = i;
+    }
+
+    parallel_for_states(StateBlocks(samplecounts, Schedule::Balanced), [&](long s){
+        const auto first = order.begin() + offsets[s], last = order.begin() + offsets[s+1];
+        if(first == last) return;
+
+        // group by actions and outcomes and add targets in increasing order, so that
+        // transitions are only appended; duplicate targets keep the order of addition
+        sort(first, last, [this](size_t i, size_t j){
+            const Sample& a = (*this)[i], & b = (*this)[j];
+            if(a.actionid != b.actionid) return a.actionid < b.actionid;
+            if(a.outcomeid != b.outcomeid) return a.outcomeid < b.outcomeid;
+            if(a.toid != b.toid) return a.toid < b.toid;
+            return i < j;
+        });
+
+        auto& state = mdp.get_state(s + minstate);
+        state.create_action((*this)[*(last - 1)].actionid);
+
+        for(auto actionbegin = first; actionbegin != last;){
+            const long actionid = (*this)[*actionbegin].actionid;
+            const auto actionend = find_if(actionbegin, last,
+                            [&](size_t i){return (*this)[i].actionid != actionid;});
+
+            auto& action = state.get_action(actionid);
+            action.create_outcome((*this)[*(actionend - 1)].outcomeid);
+
+            for(auto outcomebegin = actionbegin; outcomebegin != actionend;){
+                const long outcomeid = (*this)[*outcomebegin].outcomeid;
+                const auto outcomeend = find_if(outcomebegin, actionend,
+                            [&](size_t i){return (*this)[i].outcomeid != outcomeid;});
+
+                Transition& transition = action.get_outcome(outcomeid);
+                transition.reserve(transition.size() + (outcomeend - outcomebegin));
+                for(auto i = outcomebegin; i != outcomeend; ++i){
+                    const Sample& sample = (*this)[*i];
+                    transition.add_sample(sample.toid, sample.probability, sample.reward);
+                }
+                outcomebegin = outcomeend;
+            }
+            actionbegin = actionend;
+        }
+    });
+    count = 0;
+}
+
+// **************************************************************************************
+//  Specific template instantiations
+// **************************************************************************************
+
+template class ModelBuilder<RegularState>;
+template class ModelBuilder<DiscreteRobustState>;
+template class ModelBuilder<L1RobustState>;
+
+}
@@ -0,0 +1,53 @@
+#include "PartitionedMDP.hpp"
+#include "StateGraph.hpp"
+
+namespace craam {
+
+// **************************************************************************************
+//  Partitioned MDP
+// **************************************************************************************
+
+template<class SType>
+PartitionedMDP<SType>::PartitionedMDP(const GRMDP<SType>& mdp)
+    : PartitionedMDP(mdp, StateGraph(mdp).reverse_cuthill_mckee()) {}
+
+template<class SType>
+PartitionedMDP<SType>::PartitionedMDP(const GRMDP<SType>& mdp, const indvec& order)
+    : model(mdp.permute_states(order)), order(order), inverse(inverse_permutation(order)) {}
+
+template<class SType>
+auto PartitionedMDP<SType>::vi_jac(Uncertainty uncert, prec_t discount, const numvec& valuefunction,
+                                   unsigned long iterations, prec_t maxresidual,
+                                   size_t anderson_history) const -> SolType{
+    return model.vi_jac(uncert, discount, permute_vector(valuefunction, order), iterations,
+                        maxresidual, anderson_history).restore_order(order);
+}
+
+template<class SType>
+auto PartitionedMDP<SType>::mpi_jac(Uncertainty uncert, prec_t discount, const numvec& valuefunction,
+                                    unsigned long iterations_pi, prec_t maxresidual_pi,
+                                    unsigned long iterations_vi, prec_t maxresidual_vi,
+                                    bool show_progress, size_t anderson_history) const -> SolType{
+    return model.mpi_jac(uncert, discount, permute_vector(valuefunction, order), iterations_pi,
+                         maxresidual_pi, iterations_vi, maxresidual_vi, show_progress,
+                         anderson_history).restore_order(order);
+}
+
+template<class SType>
+auto PartitionedMDP<SType>::vi_jac_fix(prec_t discount, const ActionPolicy& policy,
+                                       const OutcomePolicy& natpolicy, const numvec& valuefunction,
+                                       unsigned long iterations, prec_t maxresidual) const -> SolType{
+    return model.vi_jac_fix(discount, permute_vector(policy, order), permute_vector(natpolicy, order),
+                            permute_vector(valuefunction, order), iterations,
+                            maxresidual).restore_order(order);
+}
+
+// **************************************************************************************
+//  Specific template instantiations
+// **************************************************************************************
+
+template class PartitionedMDP<RegularState>;
+template class PartitionedMDP<DiscreteRobustState>;
+template class PartitionedMDP<L1RobustState>;
+
+}
@@ -1,11 +1,17 @@
 #include "RMDP.hpp"
+#include "StateGraph.hpp"
+#include "Anderson.hpp"
+#include "CompressedMDP.hpp"
+#include "compression.hpp"
 
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <string>
 #include <sstream>
 #include <utility>
 #include <iostream>
+#include <queue>
 
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/lu.hpp>
@@ -33,6 +39,71 @@ SType& GRMDP<SType>::create_state(long stateid) {
     return states[stateid];
 }
 
+template<class SType>
+void GRMDP<SType>::add_transitions(const indvec& idstatefrom, const indvec& idaction, const indvec& idoutcome,
+                                   const indvec& idstateto, const numvec& probabilities, const numvec& rewards){
+    const size_t n = idstatefrom.size();
+    if(idaction.size() != n || idoutcome.size() != n || idstateto.size() != n ||
+            probabilities.size() != n || rewards.size() != n)
+        throw invalid_argument("All columns of transitions must have the same size.");
+
+    // check the input before modifying the model
+    for(size_t i = 0; i < n; i++){
+        if(idstatefrom[i] < 0 || idaction[i] < 0 || idoutcome[i] < 0 || idstateto[i] < 0)
+            throw invalid_argument("State, action, and outcome ids must be non-negative.");
+        if(probabilities[i] < -0.001)
+            throw invalid_argument("probabilities must be non-negative.");
+    }
+
+    // create states, actions, and outcomes in the same order as add_transition; the order
+    // matters for the nominal outcome weights of WeightedOutcomeAction
+    for(size_t i = 0; i < n; i++){
+        create_state(idstateto[i]);
+        create_state(idstatefrom[i]).create_action(idaction[i]).create_outcome(idoutcome[i]);
+    }
+
+    // sort by state, action, outcome, and target; equal transitions stay in the input order
+    // so that they are aggregated by add_sample in the same order as by add_transition
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    parallel_sort(order, [&](size_t i, size_t j){
+        if(idstatefrom[i] != idstatefrom[j]) return idstatefrom[i] < idstatefrom[j];
+        if(idaction[i] != idaction[j]) return idaction[i] < idaction[j];
+        if(idoutcome[i] != idoutcome[j]) return idoutcome[i] < idoutcome[j];
+        if(idstateto[i] != idstateto[j]) return idstateto[i] < idstateto[j];
+        return i < j;
+    });
+
+    // blocks of the sorted transitions that start at a new state, one for each thread
+    const long blockcount = max(1l, min(thread_count(), long(n / 4096)));
+    vector<size_t> boundaries(blockcount + 1, n);
+    boundaries[0] = 0;
+    for(long b = 1; b < blockcount; b++){
+        size_t k = max(boundaries[b-1], n * b / blockcount);
+        while(k > 0 && k < n && idstatefrom[order[k]] == idstatefrom[order[k-1]]) k++;
+        boundaries[b] = k;
+    }
+
+    // the transitions of different states can be constructed in parallel; every sample
+    // is appended to the end of its Transition or aggregated with the last one
+    #pragma omp parallel for schedule(static,1)
+    for(long b = 0; b < blockcount; b++){
+        size_t k = boundaries[b];
+        while(k < boundaries[b+1]){
+            const size_t first = order[k];
+            size_t last = k + 1;
+            while(last < boundaries[b+1] && idstatefrom[order[last]] == idstatefrom[first] &&
+                    idaction[order[last]] == idaction[first] && idoutcome[order[last]] == idoutcome[first])
+                last++;
+
+            Transition& outcome = states[idstatefrom[first]].get_action(idaction[first]).get_outcome(idoutcome[first]);
+            outcome.reserve(outcome.size() + (last - k));
+            for(; k < last; k++)
+                outcome.add_sample(idstateto[order[k]], probabilities[order[k]], rewards[order[k]]);
+        }
+    }
+}
+
 template<class SType>
 bool GRMDP<SType>::is_normalized() const{
     for(auto const& s : states){
@@ -52,6 +123,74 @@ void GRMDP<SType>::normalize(){
         s.normalize();
 }
 
+template<class SType>
+indvec GRMDP<SType>::state_costs() const{
+    indvec costs(states.size());
+    #pragma omp parallel for
+    for(long s = 0; s < (long) states.size(); s++){
+        // each action also costs the computation of its value
+        long cost = 0;
+        for(const auto& action : states[s].get_actions()){
+            cost++;
+            for(size_t o = 0; o < action.outcome_count(); o++)
+                cost += action.get_outcome(o).size();
+        }
+        costs[s] = cost;
+    }
+    return costs;
+}
+
+template<class SType>
+StateBlocks GRMDP<SType>::state_blocks() const{
+    const Schedule schedule = get_schedule();
+    if(schedule == Schedule::Static)
+        return StateBlocks(states.size());
+    return StateBlocks(state_costs(), schedule);
+}
+
+template<class SType>
+GRMDP<SType> GRMDP<SType>::permute_states(const indvec& order) const{
+    if(order.size() != states.size())
+        throw invalid_argument("The size of the order must match the number of states.");
+
+    const indvec inverse = inverse_permutation(order);
+    const long statecount = order.size();
+
+    GRMDP<SType> result(statecount);
+
+    // the same static schedule as in the solvers, so each thread first touches its states
+    #pragma omp parallel
+    {
+        indvec targets;
+
+        #pragma omp for schedule(static)
+        for(long s = 0; s < statecount; s++){
+            SType& state = result.get_state(s);
+            state = states[order[s]];
+
+            for(size_t a : indices(state)){
+                auto& action = state.get_action(a);
+                for(size_t o = 0; o < action.outcome_count(); o++){
+                    Transition& transition = action.get_outcome(o);
+                    targets.clear();
+                    for(long t : transition.get_indices())
+                        targets.push_back(inverse[t]);
+                    transition = Transition(targets, transition.get_probabilities(),
+                                            transition.get_rewards());
+                }
+            }
+        }
+    }
+    return result;
+}
+
+template<class SType>
+pair<GRMDP<SType>,indvec> GRMDP<SType>::reorder_states() const{
+    indvec order = StateGraph(*this).reverse_cuthill_mckee();
+    GRMDP<SType> reordered = permute_states(order);
+    return make_pair(move(reordered), move(order));
+}
+
 template<class SType>
 long GRMDP<SType>::is_policy_correct(const ActionPolicy& policy,
                            const OutcomePolicy& natpolicy) const {
@@ -69,17 +208,16 @@ long GRMDP<SType>::is_policy_correct(const ActionPolicy& policy,
 }
 
 template<class SType>
-void GRMDP<SType>::to_csv(ostream& output, bool header) const{
+void GRMDP<SType>::to_csv(ostream& output, bool header, bool parallel) const{
+    OutputBuffer buffer(output);
 
     //write header is so requested
-    if(header){
-        output << "idstatefrom," << "idaction," <<
-            "idoutcome," << "idstateto," << "probability," << "reward" << endl;
-    }
+    if(header)
+        buffer << "idstatefrom,idaction,idoutcome,idstateto,probability,reward\n";
 
     //idstatefrom
-    for(size_t i = 0l; i < this->states.size(); i++){
-        const auto& actions = (this->states[i]).get_actions();
+    write_in_order(buffer, states.size(), [&](OutputBuffer& out, size_t i){
+        const auto& actions = states[i].get_actions();
         //idaction
         for(size_t j = 0; j < actions.size(); j++){
             const auto& outcomes = actions[j].get_outcomes();
@@ -87,25 +225,34 @@ void GRMDP<SType>::to_csv(ostream& output, bool header) const{
             for(size_t k = 0; k < outcomes.size(); k++){
                 const auto& tran = outcomes[k];
 
-                auto& indices = tran.get_indices();
+                const auto& indices = tran.get_indices();
                 const auto& rewards = tran.get_rewards();
                 const auto& probabilities = tran.get_probabilities();
                 //idstateto
                 for (size_t l = 0; l < tran.size(); l++){
-                    output << i << ',' << j << ',' << k << ',' << indices[l] << ','
-                            << probabilities[l] << ',' << rewards[l] << endl;
+                    out << i << ',' << j << ',' << k << ',' << indices[l] << ','
+                        << probabilities[l] << ',' << rewards[l] << '\n';
                 }
             }
         }
-    }
+    }, parallel);
 }
 
 template<class SType>
-void GRMDP<SType>::to_csv_file(const string& filename, bool header) const{
-    ofstream ofs(filename, ofstream::out);
+void GRMDP<SType>::to_csv_file(const string& filename, bool header, bool parallel) const{
+    auto output = open_output_file(filename);
+    to_csv(*output,header,parallel);
+    close_output_file(move(output), filename);
+}
 
-    to_csv(ofs,header);
-    ofs.close();
+template<class SType>
+void GRMDP<SType>::to_binary_file(const string& filename) const{
+    freeze(*this).to_binary_file(filename);
+}
+
+template<class SType>
+GRMDP<SType> GRMDP<SType>::from_binary_file(const string& filename){
+    return CompressedMDP<SType>::from_binary_file(filename).unfreeze();
 }
 
 template<class SType>
@@ -132,25 +279,43 @@ string GRMDP<SType>::to_string() const {
 
 template<class SType>
 string GRMDP<SType>::to_json() const {
-    string result{"{\"states\" : ["};
-    for(auto si : indices(states)){
-        const auto& s = states[si];
-        result += s.to_json(si);
-        result += ",";
-    }
-    if(!states.empty()) result.pop_back(); // remove last comma
-    result += "]}";
-    return result;
+    stringstream result;
+    to_json(result);
+    return result.str();
+}
+
+template<class SType>
+void GRMDP<SType>::to_json(ostream& output, bool parallel) const {
+    OutputBuffer buffer(output);
+    buffer << "{\"states\" : [";
+    write_in_order(buffer, states.size(), [&](OutputBuffer& out, size_t si){
+        if(si > 0) out << ',';
+        states[si].to_json(out, si);
+    }, parallel);
+    buffer << "]}";
 }
 
 template<class SType>
 auto GRMDP<SType>::vi_gs(Uncertainty type, prec_t discount, numvec valuefunction,
                          unsigned long iterations, prec_t maxresidual) const
                             -> SolType {
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_gs_t<Uncertainty::Robust>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_gs_t<Uncertainty::Optimistic>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_gs_t<Uncertainty::Average>(discount, move(valuefunction), iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
 
-    //static_assert(type != Uncertainty::Robust || type != Uncertainty::Optimistic || type != Uncertainty::Average,
-    //              "Unknown/invalid (average not supported) optimization type.");
-
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_gs_t(prec_t discount, numvec valuefunction,
+                           unsigned long iterations, prec_t maxresidual) const
+                            -> SolType {
 
     // just quit if there are not states
     if( state_count() == 0)
@@ -175,39 +340,112 @@ auto GRMDP<SType>::vi_gs(Uncertainty type, prec_t discount, numvec valuefunction
         residual = 0;
 
         for(size_t s = 0l; s < states.size(); s++){
-            const auto& state = states[s];
+            prec_t newvalue = state_value<type>(states[s], valuefunction, discount,
+                                                policy[s], outcomes[s]);
 
-            tuple<ActionId,OutcomeId,prec_t> newvalue;
-
-            switch(type){
-            case Uncertainty::Robust:
-                newvalue = state.max_min(valuefunction,discount);
-                break;
-            case Uncertainty::Optimistic:
-                newvalue = state.max_max(valuefunction,discount);
-                break;
-            case Uncertainty::Average:
-                pair<typename SType::ActionId,prec_t> avgvalue =
-                    state.max_average(valuefunction,discount);
-                newvalue = make_tuple(avgvalue.first,OutcomeId(),avgvalue.second);
-                break;
-            }
+            residual = max(residual, abs(valuefunction[s] - newvalue));
+            valuefunction[s] = newvalue;
+        }
+    }
+    return SolType(move(valuefunction),move(policy),move(outcomes),residual,i,i);
+}
 
-            residual = max(residual, abs(valuefunction[s] - get<2>(newvalue)));
-            valuefunction[s] = get<2>(newvalue);
+template<class SType>
+auto GRMDP<SType>::vi_gs_async(Uncertainty type, prec_t discount, numvec valuefunction,
+                               unsigned long iterations, prec_t maxresidual) const
+                                -> SolType {
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_gs_async_t<Uncertainty::Robust>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_gs_async_t<Uncertainty::Optimistic>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_gs_async_t<Uncertainty::Average>(discount, move(valuefunction), iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
 
-            policy[s] = get<0>(newvalue);
-            outcomes[s] = get<1>(newvalue);
-        }
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_gs_async_t(prec_t discount, numvec valuefunction,
+                                 unsigned long iterations, prec_t maxresidual) const
+                                  -> SolType {
+
+    // just quit if there are not states
+    if( state_count() == 0)
+        return SolType();
+
+    if(valuefunction.size() > 0){
+        if(valuefunction.size() != states.size())
+            throw invalid_argument("Incorrect dimensions of value function.");
+    }else
+        valuefunction.assign(state_count(), 0.0);
+
+    GRMDP<SType>::ActionPolicy policy(states.size());
+    GRMDP<SType>::OutcomePolicy outcomes(states.size());
+
+    // each element is written only by the thread that updates the state
+    numvec residuals(states.size());
+    const StateBlocks blocks = state_blocks();
+
+    // the Bellman updates read the values of other threads only from a private copy
+    // of each thread, which is refreshed from the shared value function by atomic reads
+    const StateGraph graph(*this);
+    const auto& offsets = graph.get_successor_offsets();
+    const auto& successors = graph.get_successors();
+    vector<numvec> snapshots(thread_count(), numvec(states.size()));
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    size_t i;
+
+    for(i = 0; i < iterations && residual > maxresidual; i++){
+        // the states of each block are updated in order, like in vi_gs
+        parallel_for_states(blocks, [&](long s){
+            numvec& snapshot = snapshots[thread_index()];
+            for(size_t j = offsets[s]; j < offsets[s+1]; j++){
+                const long t = successors[j];
+                #pragma omp atomic read
+                snapshot[t] = valuefunction[t];
+            }
+            prec_t newvalue = state_value<type>(states[s], snapshot, discount,
+                                                policy[s], outcomes[s]);
+
+            // only this thread writes the value of s
+            residuals[s] = abs(valuefunction[s] - newvalue);
+            #pragma omp atomic write
+            valuefunction[s] = newvalue;
+        });
+        // the parallel loop ends with a barrier, so all updates are visible
+        residual = *max_element(residuals.begin(),residuals.end());
     }
-    return SolType(valuefunction,policy,outcomes,residual,i);
+    return SolType(move(valuefunction),move(policy),move(outcomes),residual,i,i);
 }
 
 template<class SType>
-auto GRMDP<SType>::vi_jac(Uncertainty type, prec_t discount, const numvec& valuefunction, unsigned long iterations, prec_t maxresidual) const -> SolType{
+auto GRMDP<SType>::vi_jac(Uncertainty type, prec_t discount, const numvec& valuefunction,
+                          unsigned long iterations, prec_t maxresidual,
+                          size_t anderson_history) const -> SolType{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_jac_t<Uncertainty::Robust>(discount, valuefunction, iterations, maxresidual,
+                                             anderson_history);
+    case Uncertainty::Optimistic:
+        return vi_jac_t<Uncertainty::Optimistic>(discount, valuefunction, iterations, maxresidual,
+                                                 anderson_history);
+    case Uncertainty::Average:
+        return vi_jac_t<Uncertainty::Average>(discount, valuefunction, iterations, maxresidual,
+                                              anderson_history);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
 
-    //static_assert(type != Uncertainty::Robust || type != Uncertainty::Optimistic || type != Uncertainty::Average,
-    //                      "Unknown/invalid (average not supported) optimization type.");
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_jac_t(prec_t discount, const numvec& valuefunction,
+                            unsigned long iterations, prec_t maxresidual,
+                            size_t anderson_history) const -> SolType{
 
     // just quit if there are not states
     if( state_count() == 0)
@@ -233,6 +471,9 @@ auto GRMDP<SType>::vi_jac(Uncertainty type, prec_t discount, const numvec& value
     GRMDP<SType>::OutcomePolicy outcomes(states.size());
 
     numvec residuals(states.size());
+    const StateBlocks blocks = state_blocks();
+
+    AndersonAcceleration anderson(states.size(), anderson_history);
 
     prec_t residual = numeric_limits<prec_t>::infinity();
     size_t i;
@@ -241,36 +482,22 @@ auto GRMDP<SType>::vi_jac(Uncertainty type, prec_t discount, const numvec& value
         numvec & sourcevalue = i % 2 == 0 ? oddvalue  : evenvalue;
         numvec & targetvalue = i % 2 == 0 ? evenvalue : oddvalue;
 
-        #pragma omp parallel for
-        for(auto s = 0l; s < (long) states.size(); s++){
-            const auto& state = states[s];
+        parallel_for_states(blocks, [&](long s){
+            prec_t newvalue = state_value<type>(states[s], sourcevalue, discount,
+                                                policy[s], outcomes[s]);
 
-            tuple<ActionId,OutcomeId,prec_t> newvalue;
-
-            switch(type){
-            case Uncertainty::Robust:
-                newvalue = state.max_min(sourcevalue,discount);
-                break;
-            case Uncertainty::Optimistic:
-                newvalue = state.max_max(sourcevalue,discount);
-                break;
-            case Uncertainty::Average:
-                pair<typename SType::ActionId,prec_t> avgvalue =
-                    state.max_average(sourcevalue,discount);
-                newvalue = make_tuple(avgvalue.first,OutcomeId(),avgvalue.second);
-                break;
-            }
-
-            residuals[s] = abs(sourcevalue[s] - get<2>(newvalue));
-            targetvalue[s] = get<2>(newvalue);
-
-            policy[s] = get<0>(newvalue);
-            outcomes[s] = get<1>(newvalue);
-        }
+            residuals[s] = abs(sourcevalue[s] - newvalue);
+            targetvalue[s] = newvalue;
+        });
         residual = *max_element(residuals.begin(),residuals.end());
+
+        // extrapolate the next value function unless it is final; the returned
+        // value function must be the one from which the policy was computed
+        if(anderson_history > 0 && residual > maxresidual && i + 1 < iterations)
+            anderson.mix(sourcevalue, targetvalue, residual);
     }
     numvec & valuenew = i % 2 == 0 ? oddvalue : evenvalue;
-    return SolType(valuenew,policy,outcomes,residual,i);
+    return SolType(move(valuenew),move(policy),move(outcomes),residual,i,i);
 }
 
 template<class SType>
@@ -281,10 +508,36 @@ auto GRMDP<SType>::mpi_jac(Uncertainty type,
                            prec_t maxresidual_pi,
                             unsigned long iterations_vi,
                             prec_t maxresidual_vi,
-                            bool show_progress) const -> SolType{
+                            bool show_progress,
+                            size_t anderson_history) const -> SolType{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return mpi_jac_t<Uncertainty::Robust>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                              iterations_vi, maxresidual_vi, show_progress,
+                                              anderson_history);
+    case Uncertainty::Optimistic:
+        return mpi_jac_t<Uncertainty::Optimistic>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                                  iterations_vi, maxresidual_vi, show_progress,
+                                                  anderson_history);
+    case Uncertainty::Average:
+        return mpi_jac_t<Uncertainty::Average>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                               iterations_vi, maxresidual_vi, show_progress,
+                                               anderson_history);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
 
-    //static_assert(type != Uncertainty::Robust || type != Uncertainty::Optimistic || type != Uncertainty::Average,
-    //                      "Unknown/invalid (average not supported) optimization type.");
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::mpi_jac_t(prec_t discount,
+                             const numvec& valuefunction,
+                             unsigned long iterations_pi,
+                             prec_t maxresidual_pi,
+                             unsigned long iterations_vi,
+                             prec_t maxresidual_vi,
+                             bool show_progress,
+                             size_t anderson_history) const -> SolType{
 
     // just quit if there are not states
     if( state_count() == 0)
@@ -310,10 +563,14 @@ auto GRMDP<SType>::mpi_jac(Uncertainty type,
     GRMDP<SType>::OutcomePolicy outcomes(states.size());
 
     numvec residuals(states.size());
+    const StateBlocks blocks = state_blocks();
+
+    AndersonAcceleration anderson(states.size(), anderson_history);
 
     prec_t residual_pi = numeric_limits<prec_t>::infinity();
 
     size_t i; // defined here to be able to report the number of iterations
+    size_t sweeps = 0;
 
     numvec * sourcevalue = & oddvalue;
     numvec * targetvalue = & evenvalue;
@@ -328,32 +585,14 @@ auto GRMDP<SType>::mpi_jac(Uncertainty type,
         prec_t residual_vi = numeric_limits<prec_t>::infinity();
 
         // update policies
-        #pragma omp parallel for
-        for(auto s = 0l; s < (long) states.size(); s++){
-            const auto& state = states[s];
-
-            tuple<ActionId,OutcomeId,prec_t> newvalue;
-
-            switch(type){
-            case Uncertainty::Robust:
-                newvalue = state.max_min(*sourcevalue,discount);
-                break;
-            case Uncertainty::Optimistic:
-                newvalue = state.max_max(*sourcevalue,discount);
-                break;
-            case Uncertainty::Average:
-                pair<typename SType::ActionId,prec_t> avgvalue =
-                    state.max_average(*sourcevalue,discount);
-                newvalue = make_tuple(avgvalue.first,OutcomeId(),avgvalue.second);
-                break;
-            }
+        parallel_for_states(blocks, [&](long s){
+            prec_t newvalue = state_value<type>(states[s], *sourcevalue, discount,
+                                                policy[s], outcomes[s]);
 
-            residuals[s] = abs((*sourcevalue)[s] - get<2>(newvalue));
-            (*targetvalue)[s] = get<2>(newvalue);
-
-            policy[s] = get<0>(newvalue);
-            outcomes[s] = get<1>(newvalue);
-        }
+            residuals[s] = abs((*sourcevalue)[s] - newvalue);
+            (*targetvalue)[s] = newvalue;
+        });
+        sweeps++;
 
         residual_pi = *max_element(residuals.begin(),residuals.end());
 
@@ -366,6 +605,10 @@ auto GRMDP<SType>::mpi_jac(Uncertainty type,
 
         if(show_progress)
             cout << "    Value iteration: ";
+
+        // the history of the previous policy does not apply
+        anderson.reset();
+
         // compute values using value iteration
         for(size_t j = 0; j < iterations_vi && residual_vi > maxresidual_vi; j++){
             if(show_progress)
@@ -373,30 +616,625 @@ auto GRMDP<SType>::mpi_jac(Uncertainty type,
 
             swap(targetvalue, sourcevalue);
 
-            #pragma omp parallel for
-            for(auto s = 0l; s < (long) states.size(); s++){
-                prec_t newvalue = 0;
-
-                switch(type){
-                case Uncertainty::Robust:
-                case Uncertainty::Optimistic:
-                    newvalue = states[s].fixed_fixed(*sourcevalue,discount,policy[s],outcomes[s]);
-                    break;
-                case Uncertainty::Average:
-                    newvalue = states[s].fixed_average(*sourcevalue,discount,policy[s]);
-                    break;
-                }
+            parallel_for_states(blocks, [&](long s){
+                prec_t newvalue = state_value_fixed<type>(states[s], *sourcevalue, discount,
+                                                          policy[s], outcomes[s]);
 
                 residuals[s] = abs((*sourcevalue)[s] - newvalue);
                 (*targetvalue)[s] = newvalue;
-            }
+            });
             residual_vi = *max_element(residuals.begin(),residuals.end());
+            sweeps++;
+
+            // extrapolate the next value function unless it is final
+            if(anderson_history > 0 && residual_vi > maxresidual_vi && j + 1 < iterations_vi)
+                anderson.mix(*sourcevalue, *targetvalue, residual_vi);
         }
         if(show_progress)
             cout << endl << "    Residual (fixed policy): " << residual_vi << endl << endl;
     }
     numvec & valuenew = *targetvalue;
-    return SolType(valuenew,policy,outcomes,residual_pi,i);
+    return SolType(move(valuenew),move(policy),move(outcomes),residual_pi,i,sweeps);
+}
+
+template<class SType>
+auto GRMDP<SType>::pi_bicg(Uncertainty type,
+                           prec_t discount,
+                           const numvec& valuefunction,
+                           unsigned long iterations_pi,
+                           prec_t maxresidual_pi,
+                           unsigned long iterations_lin,
+                           prec_t maxresidual_lin,
+                           bool show_progress) const -> SolType{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return pi_bicg_t<Uncertainty::Robust>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                              iterations_lin, maxresidual_lin, show_progress);
+    case Uncertainty::Optimistic:
+        return pi_bicg_t<Uncertainty::Optimistic>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                                  iterations_lin, maxresidual_lin, show_progress);
+    case Uncertainty::Average:
+        return pi_bicg_t<Uncertainty::Average>(discount, valuefunction, iterations_pi, maxresidual_pi,
+                                               iterations_lin, maxresidual_lin, show_progress);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::pi_bicg_t(prec_t discount,
+                             const numvec& valuefunction,
+                             unsigned long iterations_pi,
+                             prec_t maxresidual_pi,
+                             unsigned long iterations_lin,
+                             prec_t maxresidual_lin,
+                             bool show_progress) const -> SolType{
+
+    // just quit if there are not states
+    if( state_count() == 0)
+        return SolType();
+
+    // check if the value function is a correct size, and if it is length 0
+    // then creates an appropriate size
+    if( (valuefunction.size() > 0) && (valuefunction.size() != state_count()) )
+        throw invalid_argument("Incorrect size of value function.");
+
+    numvec value(valuefunction);
+    if(value.empty())
+        value.assign(states.size(), 0.0);
+    numvec updated(states.size());
+
+    GRMDP<SType>::ActionPolicy policy(states.size());
+    GRMDP<SType>::OutcomePolicy outcomes(states.size());
+
+    numvec residuals(states.size());
+    numvec rewards;
+
+    prec_t residual_pi = numeric_limits<prec_t>::infinity();
+
+    size_t i; // defined here to be able to report the number of iterations
+
+    for(i = 0; i < iterations_pi; i++){
+
+        if(show_progress)
+            cout << "Policy iteration " << i << "/" << iterations_pi << ":" << endl;
+
+        // update policies
+        #pragma omp parallel for
+        for(auto s = 0l; s < (long) states.size(); s++){
+            prec_t newvalue = state_value<type>(states[s], value, discount,
+                                                policy[s], outcomes[s]);
+
+            residuals[s] = abs(value[s] - newvalue);
+            updated[s] = newvalue;
+        }
+        swap(value, updated);
+
+        residual_pi = *max_element(residuals.begin(),residuals.end());
+
+        if(show_progress)
+            cout << "    Bellman residual: " << residual_pi << endl;
+
+        // the residual is sufficiently small
+        if(residual_pi <= maxresidual_pi)
+            break;
+
+        // evaluate the policy exactly, starting from the updated value function
+        const SparseMatrix system = policy_transitions(policy, outcomes,
+                                        type == Uncertainty::Average, rewards).identity_minus(discount);
+        const auto linear = bicgstab(system, rewards, value, iterations_lin, maxresidual_lin);
+
+        if(show_progress)
+            cout << "    Linear solver iterations: " << linear.first
+                 << ", residual: " << linear.second << endl << endl;
+    }
+    return SolType(move(value),move(policy),move(outcomes),residual_pi,i);
+}
+
+template<class SType>
+auto GRMDP<SType>::vi_scc(Uncertainty type, prec_t discount, numvec valuefunction,
+                          unsigned long iterations, prec_t maxresidual) const
+                            -> SolType {
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_scc_t<Uncertainty::Robust>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_scc_t<Uncertainty::Optimistic>(discount, move(valuefunction), iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_scc_t<Uncertainty::Average>(discount, move(valuefunction), iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_scc_t(prec_t discount, numvec valuefunction,
+                            unsigned long iterations, prec_t maxresidual) const
+                            -> SolType {
+
+    // just quit if there are not states
+    if( state_count() == 0)
+        return SolType();
+
+    // check if the value function is a correct size, and if it is length 0
+    // then creates an appropriate size
+    if(valuefunction.size() > 0){
+        if(valuefunction.size() != states.size())
+            throw invalid_argument("Incorrect dimensions of value function.");
+    }else
+        valuefunction.assign(state_count(), 0.0);
+
+    GRMDP<SType>::ActionPolicy policy(states.size());
+    GRMDP<SType>::OutcomePolicy outcomes(states.size());
+
+    const StateGraph graph(*this);
+    const Components components = graph.strongly_connected_components();
+
+    // group the independent components by their levels
+    const long levelcount = *max_element(components.level.begin(), components.level.end()) + 1;
+    vector<indvec> levels(levelcount);
+    for(size_t c : indices(components.states))
+        levels[components.level[c]].push_back(c);
+
+    // final residual and the number of sweeps of each component
+    numvec residuals(components.size(), 0.0);
+    vector<unsigned long> sweeps(components.size(), 0);
+
+    // the successor components are always solved in a lower level
+    for(const indvec& level : levels){
+        #pragma omp parallel for schedule(dynamic)
+        for(long l = 0; l < (long) level.size(); l++){
+            const long c = level[l];
+            const indvec& members = components.states[c];
+
+            // no cycle: the values of all successors are final
+            if(members.size() == 1 && !graph.has_self_loop(members.front())){
+                const long s = members.front();
+                valuefunction[s] = state_value<type>(states[s], valuefunction, discount,
+                                                     policy[s], outcomes[s]);
+                sweeps[c] = 1;
+                continue;
+            }
+
+            prec_t residual = numeric_limits<prec_t>::infinity();
+            unsigned long i;
+            for(i = 0; i < iterations && residual > maxresidual; i++){
+                residual = 0;
+                for(long s : members){
+                    prec_t newvalue = state_value<type>(states[s], valuefunction, discount,
+                                                        policy[s], outcomes[s]);
+
+                    residual = max(residual, abs(valuefunction[s] - newvalue));
+                    valuefunction[s] = newvalue;
+                }
+            }
+            residuals[c] = residual;
+            sweeps[c] = i;
+        }
+    }
+    return SolType(move(valuefunction), move(policy), move(outcomes),
+                   *max_element(residuals.begin(), residuals.end()),
+                   *max_element(sweeps.begin(), sweeps.end()));
+}
+
+template<class SType>
+auto GRMDP<SType>::vi_jac_ae(Uncertainty type, prec_t discount, const numvec& valuefunction,
+                             unsigned long iterations, prec_t maxresidual) const -> SolType{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_jac_ae_t<Uncertainty::Robust>(discount, valuefunction, iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_jac_ae_t<Uncertainty::Optimistic>(discount, valuefunction, iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_jac_ae_t<Uncertainty::Average>(discount, valuefunction, iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_jac_ae_t(prec_t discount, const numvec& valuefunction,
+                               unsigned long iterations, prec_t maxresidual) const -> SolType{
+
+    // just quit if there are not states
+    if( state_count() == 0)
+        return SolType();
+
+    if(discount >= 1)
+        throw invalid_argument("Discount must be smaller than 1 to compute the bounds.");
+
+    // check if the value function is a correct size, and if it is length 0
+    // then creates an appropriate size
+    if( (valuefunction.size() > 0) && (valuefunction.size() != states.size()) )
+        throw invalid_argument("Incorrect size of value function.");
+
+    numvec sourcevalue = valuefunction.empty() ? numvec(states.size(), 0.0) : valuefunction;
+    numvec targetvalue(states.size());
+
+    GRMDP<SType>::ActionPolicy policy(states.size());
+    GRMDP<SType>::OutcomePolicy outcomes(states.size());
+
+    // actions of state s are [action_offsets[s], action_offsets[s+1]) in active and gaps
+    vector<size_t> action_offsets(states.size() + 1, 0);
+    for(size_t s : indices(states))
+        action_offsets[s+1] = action_offsets[s] + states[s].action_count();
+
+    // whether the action may be optimal
+    vector<char> active(action_offsets.back());
+    for(size_t s : indices(states))
+        for(size_t a : indices(states[s]))
+            active[action_offsets[s] + a] = states[s][a].is_valid();
+    // difference between the value of the state and the value of the action
+    numvec gaps(action_offsets.back());
+
+    numvec changes(states.size());
+    const StateBlocks blocks = state_blocks();
+
+    const prec_t scale = discount / (1.0 - discount);
+    prec_t maxchange = 0, minchange = 0;
+    prec_t span = numeric_limits<prec_t>::infinity();
+    size_t i;
+
+    for(i = 0; i < iterations && span > maxresidual; i++){
+
+        parallel_for_states(blocks, [&](long s){
+            const auto& state = states[s];
+
+            // the value of terminal states does not depend on the value function
+            if(state.is_terminal()){
+                targetvalue[s] = 0;
+                changes[s] = 0;
+                policy[s] = -1;
+                outcomes[s] = OutcomeId();
+                return;
+            }
+
+            // the outcome of the evaluated action; swapped with the best one to reuse memory
+            static thread_local OutcomeId candidate;
+
+            prec_t maxvalue = -numeric_limits<prec_t>::infinity();
+            for(size_t a : indices(state)){
+                const size_t k = action_offsets[s] + a;
+                if(!active[k]) continue;
+
+                const prec_t value = action_value<type>(state[a], sourcevalue, discount, candidate);
+                gaps[k] = value;
+                if(value > maxvalue){
+                    maxvalue = value;
+                    policy[s] = a;
+                    swap(outcomes[s], candidate);
+                }
+            }
+            for(size_t k = action_offsets[s]; k < action_offsets[s+1]; k++)
+                if(active[k]) gaps[k] = maxvalue - gaps[k];
+
+            targetvalue[s] = maxvalue;
+            changes[s] = maxvalue - sourcevalue[s];
+        });
+
+        const auto minmax = minmax_element(changes.begin(), changes.end());
+        minchange = *minmax.first;
+        maxchange = *minmax.second;
+        span = maxchange - minchange;
+
+        // eliminate the actions that are provably suboptimal
+        const prec_t threshold = scale * span;
+        #pragma omp parallel for
+        for(auto k = 0l; k < (long) gaps.size(); k++){
+            if(active[k] && gaps[k] > threshold)
+                active[k] = false;
+        }
+
+        swap(sourcevalue, targetvalue);
+    }
+
+    // midpoint of the MacQueen bounds
+    const prec_t shift = scale * (maxchange + minchange) / 2.0;
+    for(size_t s : indices(states))
+        if(!states[s].is_terminal()) sourcevalue[s] += shift;
+
+    return SolType(move(sourcevalue),move(policy),move(outcomes),span,i,i);
+}
+
+// **************************************************************************************
+//  Batched Bellman updates
+// **************************************************************************************
+
+/**
+Computes the values of all outcomes of the action for k problems: the value of outcome o
+in problem j is stored in values[o*k + j]. See Transition::compute_value_batch.
+*/
+template<class AType>
+inline void outcome_values_batch(const AType& action, const numvec& valuefunctions,
+                                 const numvec& discounts, const numvec& rewardshifts,
+                                 numvec& values){
+    const auto& outcomes = action.get_outcomes();
+    if(outcomes.empty())
+        throw invalid_argument("Action with no outcomes.");
+
+    const size_t k = discounts.size();
+    values.resize(outcomes.size() * k);
+    for(size_t o = 0; o < outcomes.size(); o++)
+        outcomes[o].compute_value_batch(valuefunctions, discounts, rewardshifts, values.data() + o*k);
+}
+
+/** Computes the values of the single outcome of a regular action for k problems. */
+inline void outcome_values_batch(const RegularAction& action, const numvec& valuefunctions,
+                                 const numvec& discounts, const numvec& rewardshifts,
+                                 numvec& values){
+    values.resize(discounts.size());
+    action.get_outcome().compute_value_batch(valuefunctions, discounts, rewardshifts, values.data());
+}
+
+/** Value of a regular action in problem j from the batched outcome values. */
+template<Uncertainty type>
+inline pair<long,prec_t> action_value_batch(const RegularAction&, const numvec& values,
+                                            size_t, size_t j){
+    return make_pair(0, values[j]);
+}
+
+/** Value of a discrete outcome action in problem j from the batched outcome values. */
+template<Uncertainty type>
+inline pair<long,prec_t> action_value_batch(const DiscreteOutcomeAction& action, const numvec& values,
+                                            size_t k, size_t j){
+    const size_t outcomecount = action.get_outcomes().size();
+
+    if(type == Uncertainty::Average){
+        prec_t average = 0;
+        for(size_t o = 0; o < outcomecount; o++)
+            average += values[o*k + j];
+        return make_pair(0, average / prec_t(outcomecount));
+    }
+
+    long result = 0;
+    for(size_t o = 1; o < outcomecount; o++){
+        if(type == Uncertainty::Robust ? values[o*k + j] < values[result*k + j]
+                                       : values[o*k + j] > values[result*k + j])
+            result = o;
+    }
+    return make_pair(result, values[result*k + j]);
+}
+
+/** Value of a weighted outcome action in problem j from the batched outcome values. */
+template<Uncertainty type, NatureConstr nature>
+inline pair<numvec,prec_t> action_value_batch(const WeightedOutcomeAction<nature>& action,
+                                              const numvec& values, size_t k, size_t j){
+    const auto& distribution = action.get_distribution();
+    const size_t outcomecount = distribution.size();
+
+    if(type == Uncertainty::Average){
+        prec_t average = 0;
+        for(size_t o = 0; o < outcomecount; o++)
+            average += distribution[o] * values[o*k + j];
+        return make_pair(numvec(), average);
+    }
+
+    // the optimistic solution is the worst case of the negated values
+    const prec_t sign = type == Uncertainty::Robust ? 1.0 : -1.0;
+    numvec outcomevalues(outcomecount);
+    for(size_t o = 0; o < outcomecount; o++)
+        outcomevalues[o] = sign * values[o*k + j];
+
+    auto result = nature(outcomevalues, distribution, action.get_threshold());
+    result.second *= sign;
+    return result;
+}
+
+template<class SType>
+auto GRMDP<SType>::vi_jac_batch(Uncertainty type, const numvec& discounts,
+                                const vector<numvec>& rewards, unsigned long iterations,
+                                prec_t maxresidual) const -> vector<SolType>{
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_jac_batch_t<Uncertainty::Robust>(discounts, rewards, iterations, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_jac_batch_t<Uncertainty::Optimistic>(discounts, rewards, iterations, maxresidual);
+    case Uncertainty::Average:
+        return vi_jac_batch_t<Uncertainty::Average>(discounts, rewards, iterations, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_jac_batch_t(const numvec& discounts, const vector<numvec>& rewards,
+                                  unsigned long iterations, prec_t maxresidual) const
+                                    -> vector<SolType>{
+
+    if(discounts.empty())
+        throw invalid_argument("At least one discount factor is required.");
+    if(discounts.size() > 1 && rewards.size() > 1 && discounts.size() != rewards.size())
+        throw invalid_argument("The numbers of discounts and rewards must match.");
+
+    const size_t k = max(discounts.size(), rewards.size());
+    const size_t n = state_count();
+
+    // just quit if there are not states
+    if(n == 0)
+        return vector<SolType>(k);
+
+    // the parameters of the problems in the interleaved layout
+    const numvec batchdiscounts = discounts.size() == 1 ? numvec(k, discounts[0]) : discounts;
+    numvec rewardshifts(0);
+    if(!rewards.empty()){
+        rewardshifts.resize(n * k);
+        for(size_t j = 0; j < k; j++){
+            const numvec& r = rewards.size() == 1 ? rewards[0] : rewards[j];
+            if(r.size() != n)
+                throw invalid_argument("Incorrect size of rewards.");
+            for(size_t s = 0; s < n; s++)
+                rewardshifts[s*k + j] = r[s];
+        }
+    }
+
+    numvec sourcevalue(n * k, 0.0);
+    numvec targetvalue(n * k, 0.0);
+    numvec residuals(n * k, 0.0);
+
+    // policies are interleaved in the same way as the value functions
+    ActionPolicy policies(n * k);
+    OutcomePolicy outcomes(n * k);
+
+    numvec residual(k, numeric_limits<prec_t>::infinity());
+    size_t i;
+
+    for(i = 0; i < iterations && *max_element(residual.begin(), residual.end()) > maxresidual; i++){
+
+        #pragma omp parallel
+        {
+            numvec values;
+            numvec best(k);
+
+            #pragma omp for
+            for(auto s = 0l; s < (long) n; s++){
+                const auto& state = states[s];
+                fill(best.begin(), best.end(), -numeric_limits<prec_t>::infinity());
+                fill(policies.begin() + s*k, policies.begin() + (s+1)*k, -1);
+
+                const auto& actions = state.get_actions();
+                for(size_t a = 0; a < actions.size(); a++){
+                    const auto& action = actions[a];
+
+                    // skip invalid actions
+                    if(!action.is_valid()) continue;
+
+                    outcome_values_batch(action, sourcevalue, batchdiscounts, rewardshifts, values);
+                    for(size_t j = 0; j < k; j++){
+                        auto value = action_value_batch<type>(action, values, k, j);
+                        if(value.second > best[j]){
+                            best[j] = value.second;
+                            policies[s*k + j] = a;
+                            outcomes[s*k + j] = move(value.first);
+                        }
+                    }
+                }
+
+                for(size_t j = 0; j < k; j++){
+                    // terminal state or no valid actions
+                    if(policies[s*k + j] < 0) outcomes[s*k + j] = OutcomeId();
+
+                    const prec_t newvalue = state.is_terminal() ? 0 : best[j];
+                    residuals[s*k + j] = abs(sourcevalue[s*k + j] - newvalue);
+                    targetvalue[s*k + j] = newvalue;
+                }
+            }
+        }
+        fill(residual.begin(), residual.end(), 0.0);
+        for(size_t s = 0; s < n; s++)
+            for(size_t j = 0; j < k; j++)
+                residual[j] = max(residual[j], residuals[s*k + j]);
+
+        swap(sourcevalue, targetvalue);
+    }
+
+    vector<SolType> solutions;
+    solutions.reserve(k);
+    for(size_t j = 0; j < k; j++){
+        numvec valuefunction(n);
+        ActionPolicy policy(n);
+        OutcomePolicy outcome(n);
+        for(size_t s = 0; s < n; s++){
+            valuefunction[s] = sourcevalue[s*k + j];
+            policy[s] = policies[s*k + j];
+            outcome[s] = move(outcomes[s*k + j]);
+        }
+        solutions.push_back(SolType(valuefunction, policy, outcome, residual[j], i, i));
+    }
+    return solutions;
+}
+
+template<class SType>
+auto GRMDP<SType>::vi_ps(Uncertainty type, prec_t discount, numvec valuefunction,
+                         unsigned long maxbackups, prec_t maxresidual) const
+                            -> SolType {
+    // choose the specialized version only once
+    switch(type){
+    case Uncertainty::Robust:
+        return vi_ps_t<Uncertainty::Robust>(discount, move(valuefunction), maxbackups, maxresidual);
+    case Uncertainty::Optimistic:
+        return vi_ps_t<Uncertainty::Optimistic>(discount, move(valuefunction), maxbackups, maxresidual);
+    case Uncertainty::Average:
+        return vi_ps_t<Uncertainty::Average>(discount, move(valuefunction), maxbackups, maxresidual);
+    }
+    throw invalid_argument("Unknown uncertainty type.");
+}
+
+template<class SType>
+template<Uncertainty type>
+auto GRMDP<SType>::vi_ps_t(prec_t discount, numvec valuefunction,
+                           unsigned long maxbackups, prec_t maxresidual) const
+                            -> SolType {
+
+    // just quit if there are not states
+    if( state_count() == 0)
+        return SolType();
+
+    // check if the value function is a correct size, and if it is length 0
+    // then creates an appropriate size
+    if(valuefunction.size() > 0){
+        if(valuefunction.size() != states.size())
+            throw invalid_argument("Incorrect dimensions of value function.");
+    }else
+        valuefunction.assign(state_count(), 0.0);
+
+    if(maxbackups == 0)
+        maxbackups = MAXITER * states.size();
+
+    GRMDP<SType>::ActionPolicy policy(states.size());
+    GRMDP<SType>::OutcomePolicy outcomes(states.size());
+
+    const StateGraph graph(*this);
+    const auto& pred_offsets = graph.get_predecessor_offsets();
+    const auto& predecessors = graph.get_predecessors();
+
+    // upper bounds on the Bellman residuals of states
+    numvec bounds(states.size());
+
+    // the initial residuals are computed exactly
+    #pragma omp parallel for
+    for(auto s = 0l; s < (long) states.size(); s++){
+        prec_t newvalue = state_value<type>(states[s], valuefunction, discount,
+                                            policy[s], outcomes[s]);
+        bounds[s] = abs(valuefunction[s] - newvalue);
+    }
+    unsigned long backups = states.size();
+
+    // entries with a bound that differs from the current one are outdated and skipped
+    priority_queue<pair<prec_t,long>> queue;
+    for(size_t s : indices(states)){
+        if(bounds[s] > maxresidual)
+            queue.push(make_pair(bounds[s], s));
+    }
+
+    while(!queue.empty() && backups < maxbackups){
+        const auto top = queue.top();
+        queue.pop();
+        const long s = top.second;
+        if(top.first != bounds[s]) continue;
+
+        prec_t newvalue = state_value<type>(states[s], valuefunction, discount,
+                                            policy[s], outcomes[s]);
+        backups++;
+
+        const prec_t change = discount * abs(newvalue - valuefunction[s]);
+        valuefunction[s] = newvalue;
+        bounds[s] = 0;
+
+        if(change == 0) continue;
+        // the change can increase the residuals of the predecessors (including s itself)
+        for(size_t e = pred_offsets[s]; e < pred_offsets[s+1]; e++){
+            const long p = predecessors[e];
+            bounds[p] += change;
+            if(bounds[p] > maxresidual)
+                queue.push(make_pair(bounds[p], p));
+        }
+    }
+    return SolType(move(valuefunction), move(policy), move(outcomes),
+                   *max_element(bounds.begin(), bounds.end()), backups);
 }
 
 template<class SType>
@@ -427,6 +1265,7 @@ auto GRMDP<SType>::vi_jac_fix(prec_t discount,
     }
 
     numvec residuals(states.size());
+    const StateBlocks blocks = state_blocks();
     prec_t residual = numeric_limits<prec_t>::infinity();
 
     size_t j; // defined here to be able to report the number of iterations
@@ -438,17 +1277,16 @@ auto GRMDP<SType>::vi_jac_fix(prec_t discount,
 
         swap(targetvalue, sourcevalue);
 
-        #pragma omp parallel for
-        for(auto s = 0l; s < (long) states.size(); s++){
+        parallel_for_states(blocks, [&](long s){
             auto newvalue = states[s].fixed_fixed(*sourcevalue,discount,policy[s],natpolicy[s]);
 
             residuals[s] = abs((*sourcevalue)[s] - newvalue);
             (*targetvalue)[s] = newvalue;
-        }
+        });
         residual = *max_element(residuals.begin(),residuals.end());
     }
 
-    return SolType(*targetvalue,policy,natpolicy,residual,j);
+    return SolType(move(*targetvalue),policy,natpolicy,residual,j,j);
 }
 
 
@@ -458,6 +1296,10 @@ numvec GRMDP<SType>::ofreq_mat(const Transition& init, prec_t discount,
                        const ActionPolicy& policy, const OutcomePolicy& nature) const{
     const auto n = state_count();
 
+    // the dense decomposition is too slow and large for big problems
+    if(n > OFREQ_DENSE_MAXSTATES)
+        return ofreq_iter(init, discount, policy, nature);
+
     // initial distribution
     auto&& initial_svec = init.probabilities_vector(n);
     ublas::vector<prec_t> initial_vec(n);
@@ -482,6 +1324,39 @@ numvec GRMDP<SType>::ofreq_mat(const Transition& init, prec_t discount,
     return initial_svec;
 }
 
+template<class SType>
+numvec GRMDP<SType>::ofreq_iter(const Transition& init, prec_t discount,
+                                const ActionPolicy& policy, const OutcomePolicy& nature,
+                                unsigned long iterations, prec_t maxresidual) const{
+    const size_t n = state_count();
+
+    // transposed transition matrix: the predecessors of each state
+    const SparseMatrix mat_t = transition_mat_sparse_t(policy, nature);
+    const auto& offsets = mat_t.get_row_offsets();
+    const auto& sources = mat_t.get_columns();
+    const auto& probabilities = mat_t.get_values();
+
+    const numvec initial = init.probabilities_vector(n);
+    numvec current(initial), next(n), residuals(n);
+
+    prec_t residual = numeric_limits<prec_t>::infinity();
+    for(size_t i = 0; i < iterations && residual > maxresidual; i++){
+        #pragma omp parallel for
+        for(size_t j = 0; j < n; j++){
+            prec_t value = 0;
+            for(size_t k = offsets[j]; k < offsets[j+1]; k++)
+                value += probabilities[k] * current[sources[k]];
+            value = initial[j] + discount * value;
+
+            residuals[j] = abs(value - current[j]);
+            next[j] = value;
+        }
+        residual = n > 0 ? *max_element(residuals.begin(), residuals.end()) : 0;
+        swap(current, next);
+    }
+    return current;
+}
+
 template<class SType>
 numvec GRMDP<SType>::rewards_state(const ActionPolicy& policy, const OutcomePolicy& nature) const{
     const auto n = state_count();
@@ -506,14 +1381,19 @@ GRMDP<SType>::transition_mat(const ActionPolicy& policy, const OutcomePolicy& na
     unique_ptr<ublas::matrix<prec_t>> result(new ublas::matrix<prec_t>(n,n));
     *result = ublas::zero_matrix<prec_t>(n,n);
 
-    #pragma omp parallel for
-    for(size_t s=0; s < n; s++){
-        const Transition&& t = states[s].mean_transition(policy[s],nature[s]);
-        const auto& indexes = t.get_indices();
-        const auto& probabilities = t.get_probabilities();
+    #pragma omp parallel
+    {
+        Transition scratch;
 
-        for(size_t j=0; j < t.size(); j++){
-            (*result)(s,indexes[j]) = probabilities[j];
+        #pragma omp for
+        for(size_t s=0; s < n; s++){
+            const Transition& t = states[s].mean_transition(policy[s],nature[s],scratch);
+            const auto& indexes = t.get_indices();
+            const auto& probabilities = t.get_probabilities();
+
+            for(size_t j=0; j < t.size(); j++){
+                (*result)(s,indexes[j]) = probabilities[j];
+            }
         }
     }
     return result;
@@ -527,21 +1407,95 @@ GRMDP<SType>::transition_mat_t(const ActionPolicy& policy, const OutcomePolicy&
     unique_ptr<ublas::matrix<prec_t>> result(new ublas::matrix<prec_t>(n,n));
     *result = ublas::zero_matrix<prec_t>(n,n);
 
-    #pragma omp parallel for
-    for(size_t s = 0; s < n; s++){
-        // if this is a terminal state, then just go with zero probabilities
-        if(states[s].is_terminal())  continue;
+    #pragma omp parallel
+    {
+        Transition scratch;
 
-        const Transition&& t = states[s].mean_transition(policy[s],nature[s]);
-        const auto& indexes = t.get_indices();
-        const auto& probabilities = t.get_probabilities();
+        #pragma omp for
+        for(size_t s = 0; s < n; s++){
+            // if this is a terminal state, then just go with zero probabilities
+            if(states[s].is_terminal())  continue;
 
-        for(size_t j=0; j < t.size(); j++)
-            (*result)(indexes[j],s) = probabilities[j];
+            const Transition& t = states[s].mean_transition(policy[s],nature[s],scratch);
+            const auto& indexes = t.get_indices();
+            const auto& probabilities = t.get_probabilities();
+
+            for(size_t j=0; j < t.size(); j++)
+                (*result)(indexes[j],s) = probabilities[j];
+        }
     }
     return result;
 }
 
+template<class SType>
+SparseMatrix GRMDP<SType>::transition_mat_sparse(const ActionPolicy& policy,
+                                                 const OutcomePolicy& nature) const{
+    numvec rewards;
+    return policy_transitions(policy, nature, false, rewards);
+}
+
+template<class SType>
+SparseMatrix GRMDP<SType>::policy_transitions(const ActionPolicy& policy, const OutcomePolicy& nature,
+                                              bool average, numvec& rewards) const{
+    const size_t n = state_count();
+
+    if(policy.size() != n)
+        throw invalid_argument("Dimension of the policy must match the state count.");
+    if(!average && nature.size() != n)
+        throw invalid_argument("Dimension of the nature's policy must match the state count.");
+
+    // transition for the state; the scratch transition is used when it must be computed
+    auto transition = [&](size_t s, Transition& scratch) -> const Transition& {
+        if(average)
+            return states[s].get_action(policy[s]).average_transition(scratch);
+        else
+            return states[s].mean_transition(policy[s],nature[s],scratch);
+    };
+
+    // the number of elements in each row is computed first to allocate the
+    // arrays only once; the rows are then filled in parallel
+    vector<size_t> offsets(n + 1, 0);
+    rewards.assign(n, 0.0);
+
+    #pragma omp parallel
+    {
+        Transition scratch;
+
+        #pragma omp for
+        for(size_t s = 0; s < n; s++){
+            // terminal states have no transitions
+            if(states[s].is_terminal() || policy[s] < 0) continue;
+            offsets[s+1] = transition(s, scratch).size();
+        }
+    }
+    partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    indvec columns(offsets[n]);
+    numvec values(offsets[n]);
+
+    #pragma omp parallel
+    {
+        Transition scratch;
+
+        #pragma omp for
+        for(size_t s = 0; s < n; s++){
+            if(states[s].is_terminal() || policy[s] < 0) continue;
+
+            const Transition& t = transition(s, scratch);
+            copy(t.get_indices().begin(), t.get_indices().end(), columns.begin() + offsets[s]);
+            copy(t.get_probabilities().begin(), t.get_probabilities().end(), values.begin() + offsets[s]);
+            rewards[s] = t.mean_reward();
+        }
+    }
+    return SparseMatrix(n, n, move(offsets), move(columns), move(values));
+}
+
+template<class SType>
+SparseMatrix GRMDP<SType>::transition_mat_sparse_t(const ActionPolicy& policy,
+                                                   const OutcomePolicy& nature) const{
+    return transition_mat_sparse(policy, nature).transpose();
+}
+
 // **********************************************************************
 // *********************    TEMPLATE DECLARATIONS    ********************
 // **********************************************************************
@@ -19,6 +19,13 @@ void SampledMDP::add_samples(const DiscreteSamples& samples){
     // copy the state and action counts to be
     auto old_state_action_weights = state_action_weights;
 
+    // transitions added to the model at once after the weights are computed
+    indvec idstatefrom, idaction, idstateto;
+    numvec probabilities, rewards;
+    idstatefrom.reserve(samples.size()); idaction.reserve(samples.size());
+    idstateto.reserve(samples.size()); probabilities.reserve(samples.size());
+    rewards.reserve(samples.size());
+
     // add transition samples
     for(size_t si : indices(samples)){
 
@@ -77,10 +84,14 @@ void SampledMDP::add_samples(const DiscreteSamples& samples){
         // ---------------------
 
         // adds a transition
-        add_transition( *mdp, s.state_from(), s.action(), s.state_to(),
-                        weight*s.weight(),
-                        s.reward());
+        idstatefrom.push_back(s.state_from());
+        idaction.push_back(s.action());
+        idstateto.push_back(s.state_to());
+        probabilities.push_back(weight*s.weight());
+        rewards.push_back(s.reward());
     }
+    mdp->add_transitions(idstatefrom, idaction, indvec(idstatefrom.size(), 0), idstateto,
+                         probabilities, rewards);
 
     // make sure to set action validity based on whether there have been
     // samples observed for the action
@@ -0,0 +1,268 @@
+#include "SparseMatrix.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cmath>
+
+namespace craam {
+
+SparseMatrix::SparseMatrix(size_t rows, size_t cols, vector<size_t> row_offsets,
+                           indvec columns, numvec values)
+        : rowcount(rows), colcount(cols), row_offsets(move(row_offsets)),
+          columns(move(columns)), values(move(values)) {
+
+    if(this->row_offsets.size() != rows + 1)
+        throw invalid_argument("Row offsets must have size rows + 1.");
+    if(this->columns.size() != this->values.size())
+        throw invalid_argument("Columns and values must have the same size.");
+    if(this->row_offsets.front() != 0 || this->row_offsets.back() != this->values.size())
+        throw invalid_argument("Row offsets must start at 0 and end at the number of elements.");
+    for(size_t i = 0; i < rows; i++){
+        if(this->row_offsets[i] > this->row_offsets[i+1])
+            throw invalid_argument("Row offsets must be non-decreasing.");
+    }
+    for(auto c : this->columns){
+        if(c < 0 || c >= (long) cols)
+            throw invalid_argument("Column index out of range: " + std::to_string(c));
+    }
+}
+
+SparseMatrix::SparseMatrix(const ublas::compressed_matrix<prec_t>& matrix)
+        : rowcount(matrix.size1()), colcount(matrix.size2()), row_offsets(matrix.size1() + 1, 0) {
+
+    columns.reserve(matrix.nnz());
+    values.reserve(matrix.nnz());
+
+    for(auto i1 = matrix.begin1(); i1 != matrix.end1(); ++i1){
+        for(auto i2 = i1.begin(); i2 != i1.end(); ++i2){
+            columns.push_back(i2.index2());
+            values.push_back(*i2);
+            row_offsets[i2.index1() + 1]++;
+        }
+    }
+    for(size_t i = 0; i < rowcount; i++)
+        row_offsets[i+1] += row_offsets[i];
+}
+
+prec_t SparseMatrix::get(size_t row, size_t col) const{
+    if(row >= rowcount || col >= colcount)
+        throw range_error("Index out of range.");
+
+    auto first = columns.begin() + row_offsets[row];
+    auto last = columns.begin() + row_offsets[row+1];
+    auto it = lower_bound(first, last, (long) col);
+    if(it == last || *it != (long) col)
+        return 0;
+    return values[it - columns.begin()];
+}
+
+SparseMatrix SparseMatrix::transpose() const{
+    // count sort by columns; elements in each row of the result remain sorted
+    // because the rows of this matrix are processed in order
+    vector<size_t> offsets(colcount + 1, 0);
+    for(auto c : columns)
+        offsets[c+1]++;
+    for(size_t i = 0; i < colcount; i++)
+        offsets[i+1] += offsets[i];
+
+    indvec tcolumns(values.size());
+    numvec tvalues(values.size());
+    vector<size_t> position(offsets.begin(), offsets.end() - 1);
+
+    for(size_t row = 0; row < rowcount; row++){
+        for(size_t k = row_offsets[row]; k < row_offsets[row+1]; k++){
+            auto& pos = position[columns[k]];
+            tcolumns[pos] = row;
+            tvalues[pos] = values[k];
+            pos++;
+        }
+    }
+    return SparseMatrix(colcount, rowcount, move(offsets), move(tcolumns), move(tvalues));
+}
+
+numvec SparseMatrix::multiply(const numvec& x) const{
+    numvec result(rowcount);
+    multiply(x, result);
+    return result;
+}
+
+void SparseMatrix::multiply(const numvec& x, numvec& result) const{
+    if(x.size() != colcount)
+        throw invalid_argument("Vector size does not match the number of columns.");
+    if(result.size() != rowcount)
+        throw invalid_argument("Result size does not match the number of rows.");
+
+    #pragma omp parallel for
+    for(size_t row = 0; row < rowcount; row++){
+        prec_t value = 0;
+        for(size_t k = row_offsets[row]; k < row_offsets[row+1]; k++)
+            value += values[k] * x[columns[k]];
+        result[row] = value;
+    }
+}
+
+numvec SparseMatrix::diagonal() const{
+    if(rowcount != colcount)
+        throw invalid_argument("Diagonal is defined only for square matrices.");
+
+    numvec result(rowcount);
+    #pragma omp parallel for
+    for(size_t row = 0; row < rowcount; row++)
+        result[row] = get(row, row);
+    return result;
+}
+
+SparseMatrix SparseMatrix::identity_minus(prec_t scale) const{
+    if(rowcount != colcount)
+        throw invalid_argument("Identity can be added only to square matrices.");
+
+    // each row has at most one additional element
+    vector<size_t> offsets(rowcount + 1, 0);
+    indvec rcolumns;
+    numvec rvalues;
+    rcolumns.reserve(values.size() + rowcount);
+    rvalues.reserve(values.size() + rowcount);
+
+    for(size_t row = 0; row < rowcount; row++){
+        bool diagonal = false;
+        for(size_t k = row_offsets[row]; k < row_offsets[row+1]; k++){
+            // insert the missing diagonal element while preserving the order
+            if(!diagonal && columns[k] > (long) row){
+                rcolumns.push_back(row);
+                rvalues.push_back(1.0);
+                diagonal = true;
+            }
+            rcolumns.push_back(columns[k]);
+            rvalues.push_back(- scale * values[k]);
+            if(columns[k] == (long) row){
+                rvalues.back() += 1.0;
+                diagonal = true;
+            }
+        }
+        if(!diagonal){
+            rcolumns.push_back(row);
+            rvalues.push_back(1.0);
+        }
+        offsets[row+1] = rvalues.size();
+    }
+    return SparseMatrix(rowcount, colcount, move(offsets), move(rcolumns), move(rvalues));
+}
+
+// **************************************************************************************
+//  Linear solvers
+// **************************************************************************************
+
+/// Dot product parallelized with OpenMP
+inline prec_t dot(const numvec& x, const numvec& y){
+    prec_t result = 0;
+    const long n = x.size();
+    #pragma omp parallel for reduction(+:result)
+    for(long i = 0; i < n; i++)
+        result += x[i] * y[i];
+    return result;
+}
+
+/// Maximal absolute value of the elements
+inline prec_t norm_inf(const numvec& x){
+    prec_t result = 0;
+    for(auto v : x)
+        result = max(result, abs(v));
+    return result;
+}
+
+pair<unsigned long, prec_t> bicgstab(const SparseMatrix& A, const numvec& b, numvec& x,
+                                     unsigned long iterations, prec_t maxresidual){
+    const size_t n = b.size();
+    if(A.rows() != n || A.cols() != n)
+        throw invalid_argument("Matrix must be square and match the size of the right-hand side.");
+    if(x.size() != n)
+        throw invalid_argument("Initial solution size does not match the size of the right-hand side.");
+
+    // inverse of the diagonal (Jacobi) preconditioner
+    numvec invdiag = A.diagonal();
+    for(auto& d : invdiag){
+        if(d == 0)
+            throw invalid_argument("Diagonal of the matrix must be non-zero.");
+        d = 1.0 / d;
+    }
+
+    // r = b - A x
+    numvec r(n);
+    A.multiply(x, r);
+    for(size_t i = 0; i < n; i++) r[i] = b[i] - r[i];
+
+    prec_t residual = norm_inf(r);
+    if(residual <= maxresidual)
+        return make_pair(0ul, residual);
+
+    const numvec r0(r);
+    numvec p(n, 0.0), v(n, 0.0), phat(n), s(n), shat(n), t(n);
+    prec_t rho = 1, alpha = 1, omega = 1;
+
+    unsigned long k;
+    for(k = 0; k < iterations; k++){
+        const prec_t rho_new = dot(r0, r);
+        // the method broke down; return the current solution
+        if(rho_new == 0 || omega == 0) break;
+
+        const prec_t beta = (rho_new / rho) * (alpha / omega);
+        #pragma omp parallel for
+        for(size_t i = 0; i < n; i++){
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+            phat[i] = invdiag[i] * p[i];
+        }
+        A.multiply(phat, v);
+
+        const prec_t r0v = dot(r0, v);
+        if(r0v == 0) break;
+        alpha = rho_new / r0v;
+
+        #pragma omp parallel for
+        for(size_t i = 0; i < n; i++)
+            s[i] = r[i] - alpha * v[i];
+
+        if(norm_inf(s) <= maxresidual){
+            for(size_t i = 0; i < n; i++) x[i] += alpha * phat[i];
+            r = s;
+            residual = norm_inf(r);
+            k++;
+            break;
+        }
+
+        #pragma omp parallel for
+        for(size_t i = 0; i < n; i++)
+            shat[i] = invdiag[i] * s[i];
+        A.multiply(shat, t);
+
+        const prec_t tt = dot(t, t);
+        omega = tt > 0 ? dot(t, s) / tt : 0;
+
+        #pragma omp parallel for
+        for(size_t i = 0; i < n; i++){
+            x[i] += alpha * phat[i] + omega * shat[i];
+            r[i] = s[i] - omega * t[i];
+        }
+        rho = rho_new;
+
+        residual = norm_inf(r);
+        if(residual <= maxresidual){
+            k++;
+            break;
+        }
+    }
+    return make_pair(k, residual);
+}
+
+ublas::compressed_matrix<prec_t> SparseMatrix::to_ublas() const{
+    ublas::compressed_matrix<prec_t> result(rowcount, colcount, values.size());
+
+    // elements are added in the row-major order, which is the efficient order for push_back
+    for(size_t row = 0; row < rowcount; row++){
+        for(size_t k = row_offsets[row]; k < row_offsets[row+1]; k++)
+            result.push_back(row, columns[k], values[k]);
+    }
+    return result;
+}
+
+}
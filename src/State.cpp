@@ -115,7 +115,7 @@ prec_t SAState<AType>::fixed_average(numvec const& valuefunction, prec_t discoun
 
 template<class AType>
 prec_t SAState<AType>::fixed_fixed(numvec const& valuefunction, prec_t discount,
-                            ActionId actionid, OutcomeId outcomeid) const{
+                            ActionId actionid, const OutcomeId& outcomeid) const{
 
     // this is the terminal state, return 0
     if(is_terminal())
@@ -148,7 +148,7 @@ void SAState<AType>::normalize(){
 }
 
 template<class AType>
-bool SAState<AType>::is_action_outcome_correct(ActionId aid, OutcomeId oid) const{
+bool SAState<AType>::is_action_outcome_correct(ActionId aid, const OutcomeId& oid) const{
     if( (aid < 0) || ((size_t)aid >= actions.size()))
         return false;
 
@@ -157,18 +157,20 @@ bool SAState<AType>::is_action_outcome_correct(ActionId aid, OutcomeId oid) cons
 
 template<class AType>
 string SAState<AType>::to_json(long stateid) const{
-    string result{"{"};
-    result += "\"stateid\" : ";
-    result += std::to_string(stateid);
-    result += ",\"actions\" : [";
+    OutputBuffer output;
+    to_json(output, stateid);
+    return output.str();
+}
+
+template<class AType>
+void SAState<AType>::to_json(OutputBuffer& output, long stateid) const{
+    output << "{\"stateid\" : " << stateid;
+    output << ",\"actions\" : [";
     for(auto ai : indices(actions)){
-        const auto& a = actions[ai];
-        result += a.to_json(ai);
-        result += ",";
+        if(ai > 0) output << ',';
+        actions[ai].to_json(output, ai);
     }
-    if(!actions.empty()) result.pop_back(); // remove last comma
-    result += ("]}");
-    return result;
+    output << "]}";
 }
 
 /// **********************************************************************
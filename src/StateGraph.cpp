@@ -0,0 +1,211 @@
+#include "StateGraph.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <numeric>
+
+#include "cpp11-range-master/range.hpp"
+
+namespace craam {
+
+using namespace util::lang;
+
+/** Appends target states of all outcomes of the action */
+static void append_targets(const RegularAction& action, indvec& targets){
+    const auto& indices = action.get_outcome().get_indices();
+    targets.insert(targets.end(), indices.begin(), indices.end());
+}
+
+/** Appends target states of all outcomes of the action */
+template<class AType>
+static void append_targets(const AType& action, indvec& targets){
+    for(const auto& outcome : action.get_outcomes()){
+        const auto& indices = outcome.get_indices();
+        targets.insert(targets.end(), indices.begin(), indices.end());
+    }
+}
+
+template<class SType>
+StateGraph::StateGraph(const GRMDP<SType>& mdp) {
+    const long statecount = mdp.state_count();
+
+    // collect the unique successors of each state
+    vector<indvec> targets(statecount);
+
+    #pragma omp parallel for
+    for(long s = 0; s < statecount; s++){
+        for(const auto& action : mdp[s].get_actions())
+            append_targets(action, targets[s]);
+        sort(targets[s].begin(), targets[s].end());
+        targets[s].erase(unique(targets[s].begin(), targets[s].end()), targets[s].end());
+    }
+
+    successor_offsets.assign(statecount + 1, 0);
+    for(long s = 0; s < statecount; s++)
+        successor_offsets[s+1] = successor_offsets[s] + targets[s].size();
+
+    successors.resize(successor_offsets.back());
+    vector<size_t> indegree(statecount, 0);
+    for(long s = 0; s < statecount; s++){
+        copy(targets[s].begin(), targets[s].end(), successors.begin() + successor_offsets[s]);
+        for(long t : targets[s]) indegree[t]++;
+        indvec().swap(targets[s]);
+    }
+
+    // predecessors are sorted since the states are processed in the increasing order
+    predecessor_offsets.assign(statecount + 1, 0);
+    for(long s = 0; s < statecount; s++)
+        predecessor_offsets[s+1] = predecessor_offsets[s] + indegree[s];
+
+    predecessors.resize(predecessor_offsets.back());
+    vector<size_t> position(predecessor_offsets.begin(), predecessor_offsets.end() - 1);
+    for(long s = 0; s < statecount; s++){
+        for(size_t e = successor_offsets[s]; e < successor_offsets[s+1]; e++)
+            predecessors[position[successors[e]]++] = s;
+    }
+}
+
+bool StateGraph::has_self_loop(long stateid) const{
+    return binary_search(successors.begin() + successor_offsets[stateid],
+                         successors.begin() + successor_offsets[stateid+1], stateid);
+}
+
+Components StateGraph::strongly_connected_components() const{
+    const long statecount = state_count();
+
+    Components result;
+    result.component.assign(statecount, -1);
+
+    // order of discovery and the lowest reachable discovery order in the stack
+    indvec index(statecount, -1);
+    indvec lowlink(statecount, -1);
+    vector<bool> onstack(statecount, false);
+    indvec stack;
+    // emulates the recursion: the state and the position of the next edge to explore
+    vector<pair<long,size_t>> calls;
+
+    long counter = 0;
+
+    for(long root = 0; root < statecount; root++){
+        if(index[root] >= 0) continue;
+
+        index[root] = lowlink[root] = counter++;
+        stack.push_back(root);
+        onstack[root] = true;
+        calls.push_back(make_pair(root, successor_offsets[root]));
+
+        while(!calls.empty()){
+            const long v = calls.back().first;
+            const size_t edge = calls.back().second;
+
+            if(edge < successor_offsets[v+1]){
+                calls.back().second++;
+                const long w = successors[edge];
+                if(index[w] < 0){
+                    // descend to the successor
+                    index[w] = lowlink[w] = counter++;
+                    stack.push_back(w);
+                    onstack[w] = true;
+                    calls.push_back(make_pair(w, successor_offsets[w]));
+                }else if(onstack[w]){
+                    lowlink[v] = min(lowlink[v], index[w]);
+                }
+            }else{
+                calls.pop_back();
+                // v is the root of a component: all the states above it in the stack
+                if(lowlink[v] == index[v]){
+                    const long componentid = result.states.size();
+                    indvec members;
+                    long w;
+                    do{
+                        w = stack.back();
+                        stack.pop_back();
+                        onstack[w] = false;
+                        result.component[w] = componentid;
+                        members.push_back(w);
+                    }while(w != v);
+                    sort(members.begin(), members.end());
+                    result.states.push_back(move(members));
+                }
+                if(!calls.empty()){
+                    const long u = calls.back().first;
+                    lowlink[u] = min(lowlink[u], lowlink[v]);
+                }
+            }
+        }
+    }
+
+    // components are discovered in the reverse topological order, so the successor
+    // components always have smaller indices and their levels are already known
+    result.level.assign(result.size(), 0);
+    for(size_t c : indices(result.states)){
+        for(long s : result.states[c]){
+            for(size_t e = successor_offsets[s]; e < successor_offsets[s+1]; e++){
+                const long d = result.component[successors[e]];
+                if(d != long(c))
+                    result.level[c] = max(result.level[c], result.level[d] + 1);
+            }
+        }
+    }
+    return result;
+}
+
+indvec StateGraph::reverse_cuthill_mckee() const{
+    const long statecount = state_count();
+
+    // degree in the undirected graph (edges in both directions may be counted twice)
+    indvec degree(statecount);
+    for(long s = 0; s < statecount; s++)
+        degree[s] = (successor_offsets[s+1] - successor_offsets[s]) +
+                    (predecessor_offsets[s+1] - predecessor_offsets[s]);
+
+    // start states are considered in the order of increasing degree
+    indvec starts(statecount);
+    iota(starts.begin(), starts.end(), 0);
+    stable_sort(starts.begin(), starts.end(),
+                [&degree](long a, long b){return degree[a] < degree[b];});
+
+    indvec order;
+    order.reserve(statecount);
+    vector<bool> visited(statecount, false);
+    indvec neighbors;
+
+    for(long start : starts){
+        if(visited[start]) continue;
+
+        // breadth-first search visiting the neighbors by increasing degree
+        size_t head = order.size();
+        order.push_back(start);
+        visited[start] = true;
+
+        while(head < order.size()){
+            const long s = order[head++];
+
+            neighbors.clear();
+            for(size_t e = successor_offsets[s]; e < successor_offsets[s+1]; e++)
+                if(!visited[successors[e]]) neighbors.push_back(successors[e]);
+            for(size_t e = predecessor_offsets[s]; e < predecessor_offsets[s+1]; e++)
+                if(!visited[predecessors[e]]) neighbors.push_back(predecessors[e]);
+
+            sort(neighbors.begin(), neighbors.end(),
+                 [&degree](long a, long b){return degree[a] < degree[b] || (degree[a] == degree[b] && a < b);});
+            for(long t : neighbors){
+                if(visited[t]) continue;    // duplicates of states in both directions
+                visited[t] = true;
+                order.push_back(t);
+            }
+        }
+    }
+    reverse(order.begin(), order.end());
+    return order;
+}
+
+// **************************************************************************************
+//  Specific template instantiations
+// **************************************************************************************
+
+template StateGraph::StateGraph(const GRMDP<RegularState>& mdp);
+template StateGraph::StateGraph(const GRMDP<DiscreteRobustState>& mdp);
+template StateGraph::StateGraph(const GRMDP<L1RobustState>& mdp);
+
+}
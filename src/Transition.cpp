@@ -1,5 +1,6 @@
 #include "definitions.hpp"
 #include "Transition.hpp"
+#include "vectorized.hpp"
 
 #include <algorithm>
 #include <stdexcept>
@@ -111,12 +112,20 @@ prec_t Transition::compute_value(numvec const& valuefunction, prec_t discount) c
     if(indices.empty())
         throw range_error("No transitions defined. Cannot compute value.");
 
-    prec_t value = 0.0;
+    return sparse_value(probabilities.data(), rewards.data(), indices.data(), indices.size(),
+                        valuefunction.data(), discount);
+}
 
-    for(size_t c : util::lang::indices(indices)){
-        value +=  probabilities[c] * (rewards[c] + discount * valuefunction[indices[c]]);
-    }
-    return value;
+void Transition::compute_value_batch(numvec const& valuefunctions, numvec const& discounts,
+                                     numvec const& rewardshifts, prec_t* result) const{
+
+    if(indices.empty())
+        throw range_error("No transitions defined. Cannot compute value.");
+
+    sparse_value_batch(probabilities.data(), rewards.data(), indices.data(), indices.size(),
+                       valuefunctions.data(), discounts.data(),
+                       rewardshifts.empty() ? nullptr : rewardshifts.data(),
+                       discounts.size(), result);
 }
 
 prec_t Transition::mean_reward() const{
@@ -141,7 +150,7 @@ void Transition::probabilities_addto(prec_t scale, numvec& transition) const{
 void Transition::probabilities_addto(prec_t scale, Transition& transition) const{
 
     for(size_t i : util::lang::indices(*this))
-        transition.add_sample(indices[i], scale*probabilities[i], scale*rewards[i]);
+        transition.add_sample(indices[i], scale*probabilities[i], rewards[i]);
 }
 
 numvec Transition::probabilities_vector(size_t size) const{
@@ -171,29 +180,20 @@ numvec Transition::rewards_vector(size_t size) const{
 }
 
 string Transition::to_json(long outcomeid) const{
-    string result{"{"};
-    result += "\"outcomeid\" : ";
-    result += std::to_string(outcomeid);
-    result += ",\"stateids\" : [";
-    for(auto i : indices){
-        result += std::to_string(i);
-        result += ",";
-    }
-    if(!indices.empty()) result.pop_back();// remove last comma
-    result += "],\"probabilities\" : [";
-    for(auto p : probabilities){
-        result += std::to_string(p);
-        result += ",";
-    }
-    if(!probabilities.empty()) result.pop_back();// remove last comma
-    result += "],\"rewards\" : [" ;
-    for(auto r : rewards){
-        result += std::to_string(r);
-        result += ",";
-    }
-    if(!rewards.empty()) result.pop_back();// remove last comma
-    result += "]}";
-    return result;
+    OutputBuffer output;
+    to_json(output, outcomeid);
+    return output.str();
+}
+
+void Transition::to_json(OutputBuffer& output, long outcomeid) const{
+    output << "{\"outcomeid\" : " << outcomeid;
+    output << ",\"stateids\" : [";
+    output.write_list(indices);
+    output << "],\"probabilities\" : [";
+    output.write_list(probabilities);
+    output << "],\"rewards\" : [";
+    output.write_list(rewards);
+    output << "]}";
 }
 
 }
@@ -0,0 +1,189 @@
+#include "compression.hpp"
+
+#include <fstream>
+#include <streambuf>
+#include <vector>
+#include <stdexcept>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace craam {
+
+/// Size of the buffers of the compressed streams
+static const size_t COMPRESSION_BUFFER_SIZE = 1 << 18;
+
+#ifdef HAS_ZLIB
+
+/** Stream buffer that decompresses a gzip file as it is read */
+class GzipInputBuffer : public streambuf{
+public:
+    explicit GzipInputBuffer(const string& filename) : buffer(COMPRESSION_BUFFER_SIZE){
+        file = gzopen(filename.c_str(), "rb");
+        if(file == nullptr)
+            throw invalid_argument("Cannot open file: " + filename);
+        gzbuffer(file, COMPRESSION_BUFFER_SIZE);
+    }
+    GzipInputBuffer(const GzipInputBuffer&) = delete;
+    GzipInputBuffer& operator=(const GzipInputBuffer&) = delete;
+    ~GzipInputBuffer(){gzclose(file);}
+
+protected:
+    int_type underflow() override{
+        if(gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        const int count = gzread(file, buffer.data(), buffer.size());
+        // the stream sets its badbit when an exception is thrown here
+        if(count < 0)
+            throw invalid_argument("Corrupted compressed file.");
+        if(count == 0){
+            // a stream that ends early is reported only as an error, not by gzread
+            int error = Z_OK;
+            gzerror(file, &error);
+            if(error != Z_OK)
+                throw invalid_argument("Truncated or corrupted compressed file.");
+            return traits_type::eof();
+        }
+        setg(buffer.data(), buffer.data(), buffer.data() + count);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    gzFile file;
+    vector<char> buffer;
+};
+
+/** Stream buffer that compresses the output to a gzip file */
+class GzipOutputBuffer : public streambuf{
+public:
+    explicit GzipOutputBuffer(const string& filename) : buffer(COMPRESSION_BUFFER_SIZE){
+        file = gzopen(filename.c_str(), "wb6");
+        if(file == nullptr)
+            throw invalid_argument("Cannot open file for writing: " + filename);
+        gzbuffer(file, COMPRESSION_BUFFER_SIZE);
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+    GzipOutputBuffer(const GzipOutputBuffer&) = delete;
+    GzipOutputBuffer& operator=(const GzipOutputBuffer&) = delete;
+    ~GzipOutputBuffer(){if(file != nullptr) close();}
+
+    /**
+    Writes the remaining output, completes the compressed stream, and closes the file.
+    \returns Whether all output was written
+    */
+    bool close(){
+        const bool written = write_buffer();
+        const int result = gzclose(file);
+        file = nullptr;
+        return written && result == Z_OK;
+    }
+
+protected:
+    int_type overflow(int_type c) override{
+        if(!write_buffer())
+            return traits_type::eof();
+        if(!traits_type::eq_int_type(c, traits_type::eof())){
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override{
+        return write_buffer() ? 0 : -1;
+    }
+
+    /** Compresses the buffered output */
+    bool write_buffer(){
+        const int count = pptr() - pbase();
+        if(count > 0 && gzwrite(file, pbase(), count) != count)
+            return false;
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return true;
+    }
+
+    gzFile file;
+    vector<char> buffer;
+};
+
+/** Stream that owns its buffer */
+template<class Stream, class Buffer>
+class OwningStream : public Stream{
+public:
+    explicit OwningStream(const string& filename) : Stream(nullptr), buffer(filename){
+        this->rdbuf(&buffer);
+    }
+    /** Closes the file; see GzipOutputBuffer::close */
+    bool close(){return buffer.close();}
+protected:
+    Buffer buffer;
+};
+
+#endif
+
+bool compression_supported(){
+#ifdef HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool is_compressed_name(const string& filename){
+    const string suffix = ".gz";
+    return filename.size() >= suffix.size() &&
+            filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool is_compressed_file(const string& filename){
+    ifstream input(filename, ifstream::in | ifstream::binary);
+    unsigned char signature[2] = {0, 0};
+    input.read(reinterpret_cast<char*>(signature), 2);
+    return input && signature[0] == 0x1f && signature[1] == 0x8b;
+}
+
+unique_ptr<istream> open_input_file(const string& filename){
+    if(is_compressed_file(filename)){
+#ifdef HAS_ZLIB
+        return unique_ptr<istream>(new OwningStream<istream,GzipInputBuffer>(filename));
+#else
+        throw invalid_argument("Compressed files are not supported; build with zlib: " + filename);
+#endif
+    }
+    unique_ptr<istream> input(new ifstream(filename, ifstream::in | ifstream::binary));
+    if(!*input)
+        throw invalid_argument("Cannot open file: " + filename);
+    return input;
+}
+
+unique_ptr<ostream> open_output_file(const string& filename){
+    if(is_compressed_name(filename)){
+#ifdef HAS_ZLIB
+        return unique_ptr<ostream>(new OwningStream<ostream,GzipOutputBuffer>(filename));
+#else
+        throw invalid_argument("Compressed files are not supported; build with zlib: " + filename);
+#endif
+    }
+    unique_ptr<ostream> output(new ofstream(filename, ofstream::out | ofstream::binary | ofstream::trunc));
+    if(!*output)
+        throw invalid_argument("Cannot open file for writing: " + filename);
+    return output;
+}
+
+void close_output_file(unique_ptr<ostream> output, const string& filename){
+    bool written = bool(output->flush());
+#ifdef HAS_ZLIB
+    auto compressed = dynamic_cast<OwningStream<ostream,GzipOutputBuffer>*>(output.get());
+    if(compressed != nullptr)
+        written = compressed->close() && written;
+#endif
+    auto file = dynamic_cast<ofstream*>(output.get());
+    if(file != nullptr){
+        file->close();
+        written = written && !file->fail();
+    }
+    if(!written)
+        throw invalid_argument("Failed writing file: " + filename);
+}
+
+}
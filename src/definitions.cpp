@@ -45,14 +45,30 @@ The main interface to the library is through the templated class GRMDP. The temp
 
 States, actions, and outcomes are identified using 0-based contiguous indexes. The actions are indexed independently for each states and the outcomes are indexed independently for each state and action pair.
 
-Transitions are added through function add_transition. New states, actions, or outcomes are automatically added based on the new transition. The actual algorithms are solved using:
+Transitions are added through function add_transition. New states, actions, or outcomes are automatically added based on the new transition. Large models should be constructed using craam::ModelBuilder, which collects the transitions in large blocks of memory and allocates each state, action, and transition of the model only once. The actual algorithms are solved using:
 
 | Method                  |  Algorithm     |
 | ----------------------- | ----------------
 | GRMDP::vi_gs            | Gauss-Seidel value iteration; runs in a single thread. Computes the worst-case outcome for each action.
+| GRMDP::vi_gs_async      | Asynchronous Gauss-Seidel value iteration; threads update a shared value function in place with OpenMP. Needs fewer sweeps than Jacobi value iteration.
 | GRMDP::vi_jac           | Jacobi value iteration; parallelized with OpenMP. Computes the worst-case outcome for each action.
 | GRMDP::mpi_jac          | Jacobi modified policy iteration; parallelized with OpenMP. Computes the worst-case outcome for each action. Generally, modified policy iteration is vastly more efficient than value iteration.
+| GRMDP::vi_jac_ae        | Jacobi value iteration with MacQueen bounds, elimination of suboptimal actions, and a span seminorm stopping rule; parallelized with OpenMP. Efficient for states with many actions.
+| GRMDP::vi_jac_batch     | Jacobi value iteration for several discount factors or reward vectors at once; each transition is read once per iteration for all problems. Parallelized with OpenMP.
 | GRMDP::vi_jac_fix       | Jacobi value iteration for policy evaluation; parallelized with OpenMP. Computes the worst-case outcome for each action.
+| GRMDP::pi_bicg          | Policy iteration that evaluates each policy by solving a sparse linear system with BiCGSTAB; parallelized with OpenMP. Much faster than modified policy iteration when the discount factor is close to 1.
+| GRMDP::vi_scc           | Gauss-Seidel value iteration within strongly connected components of the state graph solved in the reverse topological order; independent components are solved in parallel with OpenMP. Acyclic models are solved in a single pass.
+| GRMDP::vi_ps            | Asynchronous value iteration with prioritized sweeping; backs up only the states whose successors changed. Efficient when warm-started after localized changes to the model.
+
+Large models that do not change can be frozen using craam::freeze into a craam::CompressedMDP, which stores all transitions in contiguous arrays and provides the same solution methods with bit-identical results. Probabilities and rewards in a frozen model can be also stored in single precision with 32-bit state indices (craam::CompressedMDPf) to halve the memory footprint.
+
+The Jacobi methods GRMDP::vi_jac and GRMDP::mpi_jac can be accelerated by Anderson mixing (craam::AndersonAcceleration) by setting the length of the history. With discount factors close to 1, the acceleration reduces the number of sweeps over the model (reported in GSolution::sweeps) by orders of magnitude.
+
+On multi-socket machines, craam::PartitionedMDP reorders the states by the reverse Cuthill-McKee algorithm so that each thread of the parallel Jacobi methods reads mostly its own slice of the value function, and copies the model so that each slice is allocated in the memory local to the thread that processes it. Value functions and policies are translated to and from the original state indices automatically. The same reordering is available for any solver through GRMDP::reorder_states, with solutions translated back by GSolution::restore_order.
+
+The parallel Jacobi methods process contiguous blocks of states. By default, each thread gets the same number of states (craam::Schedule::Static). When the number of actions and outcomes varies a lot among states, craam::set_schedule selects blocks with the same number of transitions per thread (craam::Schedule::Balanced) or smaller blocks that idle threads take from a shared queue (craam::Schedule::Dynamic).
+
+Models that do not fit the memory of a single machine can be solved by craam::DistributedMDP, which shards the states among MPI processes and exchanges only the values of states at the boundaries of the blocks in each iteration. The distributed solvers are built when MPI is found (option BUILD_MPI) and tested by `make testmpi`.
 
 
 For uncertain MDPs, each method supports average, robust, and optimistic computation modes.
@@ -137,6 +153,16 @@ References
 */
 
 
+indvec inverse_permutation(const indvec& order){
+    indvec inverse(order.size(), -1);
+    for(size_t i = 0; i < order.size(); i++){
+        if(order[i] < 0 || size_t(order[i]) >= order.size() || inverse[order[i]] >= 0)
+            throw invalid_argument("The order is not a permutation.");
+        inverse[order[i]] = i;
+    }
+    return inverse;
+}
+
 template <typename T> vector<size_t> sort_indexes(vector<T> const& v) {
     /** \brief Sort indices by values in ascending order
      *
@@ -174,7 +200,35 @@ template <typename T> vector<size_t> sort_indexes_desc(vector<T> const& v)
     return idx;
 }
 
+/**
+Partitions indices idx[first,last) by the value of z in the decreasing order into three
+groups: [first,greater) with values greater than the pivot, [greater,less) with values
+equal to the pivot, and [less,last) with values smaller than the pivot. The pivot is
+the median of three elements.
+*/
+inline void partition3_desc(numvec const& z, vector<size_t>& idx, size_t first, size_t last,
+                            size_t& greater, size_t& less){
+    assert(last > first);
+    prec_t a = z[idx[first]], b = z[idx[first + (last-first)/2]], c = z[idx[last-1]];
+    const prec_t pivot = max(min(a,b), min(max(a,b),c));
+
+    size_t lt = first, i = first, gt = last;
+    while(i < gt){
+        const prec_t v = z[idx[i]];
+        if(v > pivot)       swap(idx[lt++], idx[i++]);
+        else if(v < pivot)  swap(idx[i], idx[--gt]);
+        else                i++;
+    }
+    greater = lt; less = gt;
+}
+
 pair<numvec,prec_t> worstcase_l1(numvec const& z, numvec const& q, prec_t t){
+    numvec o;
+    const prec_t r = worstcase_l1(z, q, t, o);
+    return make_pair(move(o),r);
+}
+
+prec_t worstcase_l1(numvec const& z, numvec const& q, prec_t t, numvec& o){
     /**
     Computes the solution of:
     min_p   p^T * z
@@ -184,8 +238,11 @@ pair<numvec,prec_t> worstcase_l1(numvec const& z, numvec const& q, prec_t t){
 
     Notes
     -----
-    This implementation works in O(n log n) time because of the sort. Using
-    quickselect to choose the right quantile would work in O(n) time.
+    The mass is moved from the outcomes with the largest values of z to the outcome
+    with the smallest value. The outcomes from which the mass is removed are found
+    by a quickselect-style weighted selection, which works in O(n) expected time
+    and does not sort all the outcomes. The index array is kept in thread-local
+    storage and reused between calls.
 
     This function does not check whether the probability distribution sums to 1.
     **/
@@ -195,29 +252,98 @@ pair<numvec,prec_t> worstcase_l1(numvec const& z, numvec const& q, prec_t t){
     assert(t >= 0.0 && t <= 2.0);
     assert(z.size() == q.size());
 
-    size_t sz = z.size();
+    const size_t sz = z.size();
+    o.assign(q.begin(), q.end());
+
+    auto k = size_t(min_element(z.begin(), z.end()) - z.begin());
+    auto epsilon = min(t/2, 1-q[k]);
+
+    o[k] += epsilon;
+
+    static thread_local vector<size_t> idx;
+    idx.resize(sz);
+    for(size_t i = 0; i < sz; i++) idx[i] = i;
+
+    // candidates for the mass removal are idx[first,last); all outcomes with
+    // a greater value have been already set to 0
+    size_t first = 0, last = sz;
+    while(epsilon > 0 && first < last){
+        size_t greater, less;
+        partition3_desc(z, idx, first, last, greater, less);
+
+        prec_t mass = 0;
+        for(size_t i = first; i < greater; i++) mass += o[idx[i]];
+
+        // all the mass is removed from the outcomes with greater values
+        if(mass >= epsilon){
+            last = greater;
+            continue;
+        }
+        for(size_t i = first; i < greater; i++) o[idx[i]] = 0;
+        epsilon -= mass;
+
+        for(size_t i = greater; i < less && epsilon > 0; i++){
+            k = idx[i];
+            auto diff = min( epsilon, o[k] );
+            o[k] -= diff;
+            epsilon -= diff;
+        }
+        first = less;
+    }
+
+    return inner_product(o.begin(),o.end(),z.begin(), (prec_t) 0.0);
+}
+
+pair<numvec,prec_t> worstcase_l1_sorted(numvec const& z, numvec const& q, prec_t t,
+                                        vector<size_t>& order){
+    numvec o;
+    const prec_t r = worstcase_l1_sorted(z, q, t, order, o);
+    return make_pair(move(o),r);
+}
+
+prec_t worstcase_l1_sorted(numvec const& z, numvec const& q, prec_t t,
+                           vector<size_t>& order, numvec& o){
+    /**
+    Computes the same solution as worstcase_l1, but uses and updates the order
+    of the outcomes from a previous call. The order is repaired by insertion sort,
+    which is O(n) when the values z change little between the calls.
+    **/
+
+    assert(*min_element(q.begin(), q.end()) >= 0 && *max_element(q.begin(), q.end()) <= 1);
+    assert(z.size() > 0);
+    assert(t >= 0.0 && t <= 2.0);
+    assert(z.size() == q.size());
+
+    const size_t sz = z.size();
 
-    vector<size_t> smallest = sort_indexes<prec_t>(z);
-    numvec o(q);
+    if(order.size() != sz){
+        order.resize(sz);
+        for(size_t i = 0; i < sz; i++) order[i] = i;
+    }
+    // repair the order (insertion sort)
+    for(size_t i = 1; i < sz; i++){
+        const size_t current = order[i];
+        size_t j = i;
+        for(; j > 0 && z[order[j-1]] > z[current]; j--)
+            order[j] = order[j-1];
+        order[j] = current;
+    }
+
+    o.assign(q.begin(), q.end());
 
-    auto k = smallest[0];
+    auto k = order[0];
     auto epsilon = min(t/2, 1-q[k]);
 
     o[k] += epsilon;
 
-    auto i = sz - 1;
-    while(epsilon > 0){
-        k = smallest[i];
+    for(size_t i = sz; epsilon > 0 && i > 0; i--){
+        k = order[i-1];
         auto diff = min( epsilon, o[k] );
         o[k] -= diff;
         epsilon -= diff;
-        i -= 1;
     }
 
-    auto r = inner_product(o.begin(),o.end(),z.begin(), (prec_t) 0.0);
-
-    return make_pair(move(o),r);
+    return inner_product(o.begin(),o.end(),z.begin(), (prec_t) 0.0);
 }
 
-
 }
@@ -1,6 +1,14 @@
 #include "modeltools.hpp"
 
 #include "RMDP.hpp"
+#include "compression.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
 
 namespace craam {
     
@@ -49,10 +57,10 @@ Model& from_csv(Model& mdp, istream& input, bool header){
         idstateto = stoi(cellstring);
         // read probability
         getline(linestream, cellstring, ',');
-        probability = stof(cellstring);
+        probability = stod(cellstring);
         // read reward
         getline(linestream, cellstring, ',');
-        reward = stof(cellstring);
+        reward = stod(cellstring);
         // add transition
         add_transition<Model>(mdp,idstatefrom,idaction,idoutcome,idstateto,probability,reward);
         input >> line;
@@ -64,6 +72,199 @@ template MDP& from_csv(MDP& mdp, istream& input, bool header);
 template RMDP_D& from_csv(RMDP_D& mdp, istream& input, bool header);
 template RMDP_L1& from_csv(RMDP_L1& mdp, istream& input, bool header);
 
+// **************************************************************************************
+//  Parallel csv loader
+// **************************************************************************************
+
+/// Transitions parsed from a part of a csv file
+struct CSVColumns{
+    indvec idstatefrom, idaction, idoutcome, idstateto;
+    numvec probability, reward;
+};
+
+/// Whether the character separates lines; the same as the separators of input >> line
+inline bool is_csv_space(char c){
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+/// Parses an integer like stoi and moves the position past it
+inline long parse_csv_long(const char*& position){
+    const char* p = position;
+    bool negative = false;
+    if(*p == '-' || *p == '+') negative = (*p++ == '-');
+    if(*p < '0' || *p > '9')
+        throw invalid_argument("Invalid integer in csv file.");
+    // the range of int, which stoi accepts
+    const long limit = negative ? -long(numeric_limits<int>::min()) : numeric_limits<int>::max();
+    long value = 0;
+    while(*p >= '0' && *p <= '9'){
+        const long digit = *p++ - '0';
+        if(value > (limit - digit) / 10)
+            throw invalid_argument("Integer out of range in csv file.");
+        value = 10 * value + digit;
+    }
+    position = p;
+    return negative ? -value : value;
+}
+
+/**
+Parses a number like stod, which from_csv uses, so that the values are identical,
+and moves the position past it. strtod does not allocate memory.
+*/
+inline prec_t parse_csv_float(const char*& position){
+    if(is_csv_space(*position))
+        throw invalid_argument("Invalid number in csv file.");
+    char* end;
+    errno = 0;
+    const prec_t value = strtod(position, &end);
+    if(end == position)
+        throw invalid_argument("Invalid number in csv file.");
+    if(errno == ERANGE)
+        throw invalid_argument("Number out of range in csv file.");
+    position = end;
+    return value;
+}
+
+/// Skips the comma separating the fields of a line
+inline void skip_csv_comma(const char*& position){
+    if(*position != ',')
+        throw invalid_argument("Missing column in csv file.");
+    position++;
+}
+
+/// Parses all lines between first and last, which must be line boundaries
+static void parse_csv_chunk(const char* first, const char* last, CSVColumns& columns){
+    const char* p = first;
+    while(true){
+        while(p < last && is_csv_space(*p)) p++;
+        if(p >= last) break;
+
+        columns.idstatefrom.push_back(parse_csv_long(p)); skip_csv_comma(p);
+        columns.idaction.push_back(parse_csv_long(p)); skip_csv_comma(p);
+        columns.idoutcome.push_back(parse_csv_long(p)); skip_csv_comma(p);
+        columns.idstateto.push_back(parse_csv_long(p)); skip_csv_comma(p);
+        columns.probability.push_back(parse_csv_float(p)); skip_csv_comma(p);
+        columns.reward.push_back(parse_csv_float(p));
+        // ignore any additional columns, like from_csv
+        while(p < last && !is_csv_space(*p)) p++;
+    }
+}
+
+/**
+Parses all lines between first and last in parallel and appends them to the columns.
+The range must start and end at line boundaries.
+*/
+static void parse_csv_parallel(const char* first, const char* last, CSVColumns& columns){
+    // split the text into chunks that end at line boundaries
+    const long chunkcount = max(1l, min(thread_count(), long((last - first) / 4096) + 1));
+    vector<const char*> boundaries(chunkcount + 1, last);
+    boundaries[0] = first;
+    for(long c = 1; c < chunkcount; c++){
+        const char* b = max(boundaries[c-1], first + (last - first) * c / chunkcount);
+        while(b < last && !is_csv_space(*b)) b++;
+        boundaries[c] = b;
+    }
+
+    // parse the chunks in parallel; an exception cannot leave the parallel region
+    vector<CSVColumns> chunks(chunkcount);
+    vector<string> errors(chunkcount);
+    #pragma omp parallel for schedule(static,1)
+    for(long c = 0; c < chunkcount; c++){
+        try{
+            parse_csv_chunk(boundaries[c], boundaries[c+1], chunks[c]);
+        }catch(const exception& e){
+            errors[c] = e.what();
+        }
+    }
+    for(const auto& error : errors)
+        if(!error.empty()) throw invalid_argument(error);
+
+    for(const auto& chunk : chunks){
+        columns.idstatefrom.insert(columns.idstatefrom.end(), chunk.idstatefrom.begin(), chunk.idstatefrom.end());
+        columns.idaction.insert(columns.idaction.end(), chunk.idaction.begin(), chunk.idaction.end());
+        columns.idoutcome.insert(columns.idoutcome.end(), chunk.idoutcome.begin(), chunk.idoutcome.end());
+        columns.idstateto.insert(columns.idstateto.end(), chunk.idstateto.begin(), chunk.idstateto.end());
+        columns.probability.insert(columns.probability.end(), chunk.probability.begin(), chunk.probability.end());
+        columns.reward.insert(columns.reward.end(), chunk.reward.begin(), chunk.reward.end());
+    }
+}
+
+template<class Model>
+Model& from_csv_file_parallel(Model& mdp, const string& filename, bool header, LoadStatistics* statistics,
+                              size_t blocksize){
+    const auto start = chrono::steady_clock::now();
+    auto input = open_input_file(filename);
+
+    // the text is read in blocks, each terminated by 0 for strtod; the incomplete
+    // line at the end of a block is moved to the beginning of the next one
+    vector<char> buffer(max(blocksize, size_t(2)) + 1);
+    size_t kept = 0;
+    size_t bytes = 0;
+    bool skipheader = header;
+    CSVColumns columns;
+
+    while(true){
+        const size_t capacity = buffer.size() - 1 - kept;
+        input->read(buffer.data() + kept, capacity);
+        if(input->bad())
+            throw invalid_argument("Cannot read file: " + filename);
+        const size_t count = input->gcount();
+        const bool finished = count < capacity;
+        bytes += count;
+
+        const char* first = buffer.data();
+        const char* last = buffer.data() + kept + count;
+        buffer[kept + count] = '\0';
+
+        // the end of the last complete line
+        const char* end = last;
+        if(!finished){
+            while(end > first && !is_csv_space(end[-1])) end--;
+            // a line longer than the buffer
+            if(end == first){
+                kept += count;
+                buffer.resize(2 * buffer.size());
+                continue;
+            }
+        }
+
+        // skip the first row if so instructed
+        if(skipheader){
+            while(first < end && is_csv_space(*first)) first++;
+            if(first < end){
+                while(first < end && !is_csv_space(*first)) first++;
+                skipheader = false;
+            }
+        }
+
+        parse_csv_parallel(first, end, columns);
+        if(finished) break;
+
+        kept = last - end;
+        copy(end, last, buffer.begin());
+    }
+
+    // add all transitions at once
+    const size_t transitions = columns.idstatefrom.size();
+    mdp.add_transitions(columns.idstatefrom, columns.idaction, columns.idoutcome,
+                        columns.idstateto, columns.probability, columns.reward);
+
+    if(statistics != nullptr){
+        statistics->bytes = bytes;
+        statistics->transitions = transitions;
+        statistics->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return mdp;
+}
+
+template MDP& from_csv_file_parallel(MDP& mdp, const string& filename, bool header,
+                                      LoadStatistics* statistics, size_t blocksize);
+template RMDP_D& from_csv_file_parallel(RMDP_D& mdp, const string& filename, bool header,
+                                      LoadStatistics* statistics, size_t blocksize);
+template RMDP_L1& from_csv_file_parallel(RMDP_L1& mdp, const string& filename, bool header,
+                                      LoadStatistics* statistics, size_t blocksize);
+
+
 
 template<class Model>
 void set_outcome_thresholds(Model& mdp, prec_t threshold){
@@ -76,6 +277,17 @@ void set_outcome_thresholds(Model& mdp, prec_t threshold){
 
 template void set_outcome_thresholds(RMDP_L1& mdp, prec_t threshold);
 
+template<class Model>
+void set_outcome_order_caching(Model& mdp, bool cache){
+    for(const auto si : indices(mdp)){
+        auto& state = mdp.get_state(si);
+        for(auto ai : indices(state))
+            state.get_action(ai).set_order_caching(cache);
+    }
+}
+
+template void set_outcome_order_caching(RMDP_L1& mdp, bool cache);
+
 template<class Model> void set_uniform_outcome_dst(Model& mdp){
 
     for(const auto si : indices(mdp)){
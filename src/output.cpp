@@ -0,0 +1,77 @@
+#include "output.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+namespace craam {
+
+/// Writes the digits of the integer and returns the number of characters
+static size_t format_integer(unsigned long value, bool negative, char* output){
+    char digits[24];
+    size_t count = 0;
+    do{
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    }while(value > 0);
+
+    size_t length = 0;
+    if(negative) output[length++] = '-';
+    while(count > 0) output[length++] = digits[--count];
+    return length;
+}
+
+size_t format_number(prec_t value, char* output){
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    return to_chars(output, output + 32, value).ptr - output;
+#else
+    // integers, such as many rewards and probabilities of 1, are common and exact
+    if(value == trunc(value) && abs(value) < 1e15)
+        return format_integer((unsigned long) abs(value), signbit(value), output);
+
+    // the fewest significant digits that restore the value
+    for(int precision = 15; precision < 17; precision++){
+        const int length = snprintf(output, 32, "%.*g", precision, value);
+        if(strtod(output, nullptr) == value)
+            return length;
+    }
+    return snprintf(output, 32, "%.17g", value);
+#endif
+}
+
+OutputBuffer& OutputBuffer::operator<<(long value){
+    char text[32];
+    const bool negative = value < 0;
+    // negating the smallest long would overflow
+    const unsigned long magnitude = negative ? 0ul - (unsigned long) value : (unsigned long) value;
+    buffer.append(text, format_integer(magnitude, negative, text));
+    check();
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(unsigned long value){
+    char text[32];
+    buffer.append(text, format_integer(value, false, text));
+    check();
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(prec_t value){
+    char text[32];
+    buffer.append(text, format_number(value, text));
+    check();
+    return *this;
+}
+
+void OutputBuffer::flush(){
+    if(output == nullptr || buffer.empty()) return;
+    output->write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+}
@@ -0,0 +1,80 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace craam {
+
+/// Number of blocks per thread in the dynamic schedule
+static const long DYNAMIC_BLOCKS_PER_THREAD = 8;
+
+/// Schedule used by the solvers; atomic because solvers may run in other threads
+static atomic<Schedule> selected_schedule(Schedule::Static);
+
+void set_schedule(Schedule schedule){
+    selected_schedule.store(schedule, memory_order_relaxed);
+}
+
+Schedule get_schedule(){
+    return selected_schedule.load(memory_order_relaxed);
+}
+
+long thread_count(){
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+long thread_index(){
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+StateBlocks::StateBlocks(size_t statecount) : boundaries(), dynamic(false) {
+    // the same chunks as schedule(static): the first blocks have one more state
+    const long blockcount = max(1l, min(thread_count(), long(statecount)));
+    const long chunk = statecount / blockcount;
+    const long remainder = statecount % blockcount;
+
+    boundaries.resize(blockcount + 1);
+    boundaries[0] = 0;
+    for(long b = 0; b < blockcount; b++)
+        boundaries[b+1] = boundaries[b] + chunk + (b < remainder ? 1 : 0);
+}
+
+StateBlocks::StateBlocks(const indvec& costs, Schedule schedule) : StateBlocks(costs.size()) {
+    if(schedule == Schedule::Static || costs.empty())
+        return;
+
+    dynamic = (schedule == Schedule::Dynamic);
+    const long statecount = costs.size();
+    const long blockcount = min(statecount,
+                                thread_count() * (dynamic ? DYNAMIC_BLOCKS_PER_THREAD : 1));
+
+    // cumulative cost; every state costs at least one to split states without transitions
+    indvec cumulative(statecount + 1, 0);
+    for(long s = 0; s < statecount; s++)
+        cumulative[s+1] = cumulative[s] + max(1l, costs[s]);
+
+    // the block b ends at the first state whose cumulative cost reaches (b+1)/blockcount
+    boundaries.assign(1, 0);
+    for(long b = 1; b < blockcount; b++){
+        const long target = (cumulative.back() * b) / blockcount;
+        const long boundary = lower_bound(cumulative.begin(), cumulative.end(), target)
+                                - cumulative.begin();
+        if(boundary > boundaries.back() && boundary < statecount)
+            boundaries.push_back(boundary);
+    }
+    boundaries.push_back(statecount);
+}
+
+}
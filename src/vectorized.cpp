@@ -0,0 +1,210 @@
+#include "vectorized.hpp"
+
+#include <atomic>
+
+#if defined(__GNUC__) && defined(__x86_64__) && __SIZEOF_LONG__ == 8
+    #define CRAAM_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+namespace craam {
+
+/// Transitions shorter than this are always computed by the scalar loop
+constexpr size_t VECTORIZED_MIN_COUNT = 4;
+
+typedef prec_t (*KernelD)(const prec_t*, const prec_t*, const long*, size_t, const prec_t*, prec_t);
+typedef prec_t (*KernelF)(const float*, const float*, const int32_t*, size_t, const prec_t*, prec_t);
+
+#ifdef CRAAM_X86_KERNELS
+
+// **************************************************************************************
+//  AVX2 kernels
+// **************************************************************************************
+
+// The gathers and conversions use the masked forms with a zero source and a full mask;
+// the unmasked forms start from an undefined register, which GCC reports as uninitialized.
+
+__attribute__((target("avx2,fma")))
+inline __m256d full_mask_pd(){
+    return _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+}
+
+__attribute__((target("avx2,fma")))
+inline prec_t horizontal_sum(__m256d x){
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(x), _mm256_extractf128_pd(x, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+__attribute__((target("avx2,fma")))
+prec_t sparse_value_avx2(const prec_t* probabilities, const prec_t* rewards, const long* indices,
+                         size_t count, const prec_t* valuefunction, prec_t discount){
+    const __m256d d = _mm256_set1_pd(discount);
+    __m256d acc = _mm256_setzero_pd();
+    size_t c = 0;
+    for(; c + 4 <= count; c += 4){
+        __m256i idx = _mm256_loadu_si256((const __m256i*) (indices + c));
+        __m256d v = _mm256_mask_i64gather_pd(_mm256_setzero_pd(), valuefunction, idx, full_mask_pd(), 8);
+        __m256d r = _mm256_loadu_pd(rewards + c);
+        __m256d p = _mm256_loadu_pd(probabilities + c);
+        acc = _mm256_fmadd_pd(p, _mm256_fmadd_pd(d, v, r), acc);
+    }
+    prec_t value = horizontal_sum(acc);
+    for(; c < count; c++)
+        value += probabilities[c] * (rewards[c] + discount * valuefunction[indices[c]]);
+    return value;
+}
+
+__attribute__((target("avx2,fma")))
+prec_t sparse_value_avx2(const float* probabilities, const float* rewards, const int32_t* indices,
+                         size_t count, const prec_t* valuefunction, prec_t discount){
+    const __m256d d = _mm256_set1_pd(discount);
+    __m256d acc = _mm256_setzero_pd();
+    size_t c = 0;
+    for(; c + 4 <= count; c += 4){
+        __m128i idx = _mm_loadu_si128((const __m128i*) (indices + c));
+        __m256d v = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), valuefunction, idx, full_mask_pd(), 8);
+        __m256d r = _mm256_cvtps_pd(_mm_loadu_ps(rewards + c));
+        __m256d p = _mm256_cvtps_pd(_mm_loadu_ps(probabilities + c));
+        acc = _mm256_fmadd_pd(p, _mm256_fmadd_pd(d, v, r), acc);
+    }
+    prec_t value = horizontal_sum(acc);
+    for(; c < count; c++)
+        value += prec_t(probabilities[c]) * (prec_t(rewards[c]) + discount * valuefunction[indices[c]]);
+    return value;
+}
+
+// **************************************************************************************
+//  AVX-512 kernels
+// **************************************************************************************
+
+// The remainder is handled by masked loads and gathers; masked-out lanes are zero.
+
+/// Mask of all eight lanes
+constexpr __mmask8 FULL_MASK = 0xFF;
+
+__attribute__((target("avx512f")))
+inline prec_t horizontal_sum(__m512d x){
+    return horizontal_sum(_mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, x, 0),
+                                        _mm512_maskz_extractf64x4_pd(0xF, x, 1)));
+}
+
+/// Converts the eight floats to doubles
+__attribute__((target("avx512f")))
+inline __m512d convert_pd(__m256 x){
+    return _mm512_maskz_cvtps_pd(FULL_MASK, x);
+}
+
+__attribute__((target("avx512f")))
+prec_t sparse_value_avx512(const prec_t* probabilities, const prec_t* rewards, const long* indices,
+                           size_t count, const prec_t* valuefunction, prec_t discount){
+    const __m512d d = _mm512_set1_pd(discount);
+    __m512d acc = _mm512_setzero_pd();
+    size_t c = 0;
+    for(; c + 8 <= count; c += 8){
+        __m512i idx = _mm512_loadu_si512((const void*) (indices + c));
+        __m512d v = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), FULL_MASK, idx, valuefunction, 8);
+        __m512d r = _mm512_loadu_pd(rewards + c);
+        __m512d p = _mm512_loadu_pd(probabilities + c);
+        acc = _mm512_fmadd_pd(p, _mm512_fmadd_pd(d, v, r), acc);
+    }
+    if(c < count){
+        const __mmask8 m = (__mmask8) ((1u << (count - c)) - 1);
+        __m512i idx = _mm512_maskz_loadu_epi64(m, indices + c);
+        __m512d v = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), m, idx, valuefunction, 8);
+        __m512d r = _mm512_maskz_loadu_pd(m, rewards + c);
+        __m512d p = _mm512_maskz_loadu_pd(m, probabilities + c);
+        acc = _mm512_fmadd_pd(p, _mm512_fmadd_pd(d, v, r), acc);
+    }
+    return horizontal_sum(acc);
+}
+
+__attribute__((target("avx512f")))
+prec_t sparse_value_avx512(const float* probabilities, const float* rewards, const int32_t* indices,
+                           size_t count, const prec_t* valuefunction, prec_t discount){
+    const __m512d d = _mm512_set1_pd(discount);
+    __m512d acc = _mm512_setzero_pd();
+    size_t c = 0;
+    for(; c + 8 <= count; c += 8){
+        __m256i idx = _mm256_loadu_si256((const __m256i*) (indices + c));
+        __m512d v = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), FULL_MASK, idx, valuefunction, 8);
+        __m512d r = convert_pd(_mm256_loadu_ps(rewards + c));
+        __m512d p = convert_pd(_mm256_loadu_ps(probabilities + c));
+        acc = _mm512_fmadd_pd(p, _mm512_fmadd_pd(d, v, r), acc);
+    }
+    if(c < count){
+        const __mmask8 m = (__mmask8) ((1u << (count - c)) - 1);
+        // 256-bit masked loads (AVX2) of the remaining lanes
+        const __m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(count - c)),
+                                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256i idx = _mm256_maskload_epi32((const int*) (indices + c), lanes);
+        __m512d v = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, idx, valuefunction, 8);
+        __m512d r = convert_pd(_mm256_maskload_ps(rewards + c, lanes));
+        __m512d p = convert_pd(_mm256_maskload_ps(probabilities + c, lanes));
+        acc = _mm512_fmadd_pd(p, _mm512_fmadd_pd(d, v, r), acc);
+    }
+    return horizontal_sum(acc);
+}
+
+#endif
+
+// **************************************************************************************
+//  Runtime kernel selection
+// **************************************************************************************
+
+/// Kernels used by sparse_value; nullptr means that the scalar loop is used
+struct Kernels{
+    const char* name = "scalar";
+    KernelD kernel_d = nullptr;
+    KernelF kernel_f = nullptr;
+
+    /// Selects the best kernel supported by the CPU
+    Kernels(bool vectorized){
+        if(!vectorized) return;
+#ifdef CRAAM_X86_KERNELS
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f")){
+            name = "avx512";
+            kernel_d = static_cast<KernelD>(&sparse_value_avx512);
+            kernel_f = static_cast<KernelF>(&sparse_value_avx512);
+        }else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+            name = "avx2";
+            kernel_d = static_cast<KernelD>(&sparse_value_avx2);
+            kernel_f = static_cast<KernelF>(&sparse_value_avx2);
+        }
+#endif
+    }
+};
+
+/// Scalar and best supported kernels; set_vectorized switches between them
+static const Kernels scalar_kernels(false);
+static const Kernels best_kernels(true);
+
+/// Kernels currently used; the pointer is swapped atomically so that it can be
+/// changed while other threads call sparse_value
+static std::atomic<const Kernels*> selected(&best_kernels);
+
+prec_t sparse_value(const prec_t* probabilities, const prec_t* rewards, const long* indices,
+                    size_t count, const prec_t* valuefunction, prec_t discount){
+    KernelD kernel = selected.load(std::memory_order_relaxed)->kernel_d;
+    if(kernel == nullptr || count < VECTORIZED_MIN_COUNT)
+        return sparse_value_scalar(probabilities, rewards, indices, count, valuefunction, discount);
+    return kernel(probabilities, rewards, indices, count, valuefunction, discount);
+}
+
+prec_t sparse_value(const float* probabilities, const float* rewards, const int32_t* indices,
+                    size_t count, const prec_t* valuefunction, prec_t discount){
+    KernelF kernel = selected.load(std::memory_order_relaxed)->kernel_f;
+    if(kernel == nullptr || count < VECTORIZED_MIN_COUNT)
+        return sparse_value_scalar(probabilities, rewards, indices, count, valuefunction, discount);
+    return kernel(probabilities, rewards, indices, count, valuefunction, discount);
+}
+
+void set_vectorized(bool enabled){
+    selected.store(enabled ? &best_kernels : &scalar_kernels, std::memory_order_relaxed);
+}
+
+const char* vectorized_kernel(){
+    return selected.load(std::memory_order_relaxed)->name;
+}
+
+}
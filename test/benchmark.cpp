@@ -4,6 +4,7 @@
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 
 
 using namespace std;
@@ -21,15 +22,16 @@ int main(int argc, char * argv []){
 
     cout << "loading" << endl;
 
-    ifstream ifs;
-    ifs.open(filename);
-    if(!ifs.is_open()){
-        cout << "file could not be open";
+    RMDP_D rmdp;
+    LoadStatistics statistics;
+    try{
+        from_csv_file_parallel(rmdp,filename,true,&statistics);
+    }catch(const invalid_argument& e){
+        cout << "file could not be loaded: " << e.what() << endl;
         return -1;
     }
-    RMDP_D rmdp;
-    from_csv(rmdp,ifs,true);
-    ifs.close();
+    cout << "Loaded " << statistics.transitions << " transitions at "
+         << statistics.megabytes_per_second() << " MB/s" << endl;
 
     cout << "running test" << endl;
 
@@ -0,0 +1,96 @@
+#include "RMDP.hpp"
+#include "modeltools.hpp"
+#include "ModelBuilder.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <sys/resource.h>
+
+using namespace std;
+using namespace craam;
+
+/**
+Benchmark of constructing a large random model by add_transition and by ModelBuilder.
+Reports the construction time and the peak resident memory of the process, so each
+method must be run in a separate process.
+
+Execute as: benchmark_builder add_transition|builder [sorted|shuffled] [statecount] [actioncount] [nonzeros]
+
+The transitions are either grouped by the source state or added in a random order.
+*/
+
+/** Generates the transitions of a random model with random targets */
+template<class Function>
+void generate(bool sorted, size_t statecount, size_t actioncount, size_t nonzeros, Function&& add){
+    default_random_engine gen(1);
+    uniform_int_distribution<long> state(0, statecount - 1);
+    uniform_int_distribution<long> action(0, actioncount - 1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+
+    if(sorted){
+        for(size_t s = 0; s < statecount; s++){
+            for(size_t a = 0; a < actioncount; a++){
+                for(size_t k = 0; k < nonzeros; k++)
+                    add(s, a, state(gen), value(gen), value(gen));
+            }
+        }
+    }else{
+        for(size_t i = 0; i < statecount * actioncount * nonzeros; i++){
+            const long s = state(gen), a = action(gen);
+            add(s, a, state(gen), value(gen), value(gen));
+        }
+    }
+}
+
+/** Peak resident memory of the process in MB */
+double peak_memory(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return double(usage.ru_maxrss) / 1024.0;
+}
+
+int main(int argc, char * argv []){
+    if(argc < 2){
+        cout << "Invalid execution parameters. Execute as: " << endl;
+        cout << argv[0] << " add_transition|builder [sorted|shuffled] [statecount] [actioncount] [nonzeros]" << endl;
+        return -1;
+    }
+    const string method = argv[1];
+    const bool sorted = argc > 2 ? string(argv[2]) != "shuffled" : true;
+    const size_t statecount = argc > 3 ? stoul(argv[3]) : 1000000;
+    const size_t actioncount = argc > 4 ? stoul(argv[4]) : 3;
+    const size_t nonzeros = argc > 5 ? stoul(argv[5]) : 10;
+
+    cout << "Method: " << method << (sorted ? ", sorted" : ", shuffled") << ", states: " << statecount << ", transitions: "
+         << statecount * actioncount * nonzeros << endl;
+
+    auto start = chrono::high_resolution_clock::now();
+    MDP mdp;
+    if(method == "add_transition"){
+        generate(sorted, statecount, actioncount, nonzeros, [&](long s, long a, long t, prec_t p, prec_t r){
+            add_transition(mdp, s, a, t, p, r);
+        });
+    }else if(method == "builder"){
+        ModelBuilder<RegularState> builder(mdp);
+        generate(sorted, statecount, actioncount, nonzeros, [&](long s, long a, long t, prec_t p, prec_t r){
+            builder.add_transition(s, a, t, p, r);
+        });
+        builder.build();
+    }else{
+        cout << "Unknown method " << method << endl;
+        return -1;
+    }
+    auto finish = chrono::high_resolution_clock::now();
+
+    size_t nonzerocount = 0;
+    for(const auto& state : mdp.get_states())
+        for(const auto& action : state.get_actions())
+            nonzerocount += action.get_outcome().size();
+
+    cout << "Nonzeros: " << nonzerocount << endl;
+    cout << "Duration: " << chrono::duration_cast<chrono::milliseconds>(finish-start).count() << "ms" << endl;
+    cout << "Peak memory: " << peak_memory() << "MB" << endl;
+}
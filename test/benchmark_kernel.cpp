@@ -0,0 +1,92 @@
+#include "definitions.hpp"
+#include "vectorized.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+using namespace craam;
+
+/**
+Micro-benchmark of the sparse dot-product kernel (sparse_value), which is the innermost
+operation of all solvers. Reports the number of nonzero transitions processed per second
+for the scalar and the vectorized kernels and for double and single precision storage.
+
+Execute as: benchmark_kernel [statecount]
+*/
+
+/// Randomly generated transitions stored contiguously (as in CompressedMDP)
+template<class PType, class IType>
+struct Transitions{
+    vector<size_t> offsets;
+    vector<IType> indices;
+    vector<PType> probabilities;
+    vector<PType> rewards;
+};
+
+template<class PType, class IType>
+Transitions<PType,IType> generate(size_t statecount, size_t transitioncount, size_t nonzeros, default_random_engine& gen){
+    uniform_int_distribution<IType> state(0, statecount - 1);
+    uniform_real_distribution<PType> value(0.0, 1.0);
+
+    Transitions<PType,IType> result;
+    result.offsets.push_back(0);
+    for(size_t t = 0; t < transitioncount; t++){
+        for(size_t i = 0; i < nonzeros; i++){
+            result.indices.push_back(state(gen));
+            result.probabilities.push_back(value(gen) / PType(nonzeros));
+            result.rewards.push_back(value(gen));
+        }
+        result.offsets.push_back(result.indices.size());
+    }
+    return result;
+}
+
+template<class PType, class IType>
+void run(const string& precision, size_t statecount, size_t nonzeros){
+    default_random_engine gen(1);
+    // keep the total number of nonzeros constant
+    const size_t transitioncount = max<size_t>(1, (size_t(1) << 24) / nonzeros);
+    const int repetitions = 5;
+
+    auto&& trans = generate<PType,IType>(statecount, transitioncount, nonzeros, gen);
+    numvec valuefunction(statecount, 1.0);
+
+    for(bool vectorized : {false, true}){
+        set_vectorized(vectorized);
+
+        prec_t total = 0;
+        auto start = chrono::high_resolution_clock::now();
+        for(int r = 0; r < repetitions; r++){
+            for(size_t t = 0; t < transitioncount; t++){
+                const size_t first = trans.offsets[t];
+                total += sparse_value(trans.probabilities.data() + first, trans.rewards.data() + first,
+                                      trans.indices.data() + first, trans.offsets[t+1] - first,
+                                      valuefunction.data(), 0.9);
+            }
+        }
+        auto finish = chrono::high_resolution_clock::now();
+        double seconds = chrono::duration<double>(finish - start).count();
+
+        cout << precision << ", nonzeros per transition: " << nonzeros
+             << ", kernel: " << vectorized_kernel()
+             << ", nonzeros/s: " << double(trans.indices.size()) * repetitions / seconds
+             << " (checksum " << total << ")" << endl;
+    }
+    set_vectorized(true);
+}
+
+int main(int argc, char * argv []){
+    size_t statecount = argc > 1 ? stoul(argv[1]) : 1000000;
+
+    cout << "States: " << statecount << endl;
+
+    // very sparse and dense-ish transitions
+    for(size_t nonzeros : {2, 8, 64, 512}){
+        run<prec_t,long>("double/long", statecount, nonzeros);
+        run<float,int32_t>("float/int32", statecount, nonzeros);
+    }
+}
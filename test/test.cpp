@@ -4,11 +4,30 @@
 #include "RMDP.hpp"
 #include "definitions.hpp"
 #include "modeltools.hpp"
+#include "CompressedMDP.hpp"
+#include "StateGraph.hpp"
+#include "PartitionedMDP.hpp"
+#include "vectorized.hpp"
+#include "parallel.hpp"
+#include "ModelBuilder.hpp"
+#include "output.hpp"
+#include "compression.hpp"
 
 #include <iostream>
 #include <sstream>
 #include <cmath>
 #include <numeric>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 using namespace craam;
@@ -94,6 +113,90 @@ BOOST_AUTO_TEST_CASE(test_l1_worst_case){
     BOOST_CHECK_CLOSE(w, 2.0,1e-3);
 }
 
+/// Reference implementation of the worst case that sorts all outcomes
+prec_t worstcase_l1_reference(numvec const& z, numvec const& q, prec_t t){
+    vector<size_t> smallest(z.size());
+    iota(smallest.begin(), smallest.end(), 0);
+    sort(smallest.begin(), smallest.end(), [&z](size_t i1, size_t i2){return z[i1] < z[i2];});
+
+    numvec o(q);
+    auto k = smallest[0];
+    auto epsilon = min(t/2, 1-q[k]);
+    o[k] += epsilon;
+    for(size_t i = z.size(); epsilon > 0 && i > 0; i--){
+        k = smallest[i-1];
+        auto diff = min(epsilon, o[k]);
+        o[k] -= diff;
+        epsilon -= diff;
+    }
+    return inner_product(o.begin(), o.end(), z.begin(), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(test_l1_worst_case_selection){
+    default_random_engine gen(1);
+    uniform_real_distribution<prec_t> uniform(0.0, 1.0);
+    // few distinct values to test ties
+    uniform_int_distribution<int> discrete(0, 3);
+
+    vector<size_t> order;
+    for(size_t n : {1, 2, 3, 5, 10, 50, 200}){
+        for(int trial = 0; trial < 20; trial++){
+            numvec z(n), q(n);
+            for(size_t i = 0; i < n; i++){
+                z[i] = trial % 2 == 0 ? uniform(gen) : prec_t(discrete(gen));
+                q[i] = uniform(gen);
+            }
+            prec_t sum = accumulate(q.begin(), q.end(), 0.0);
+            for(auto& qi : q) qi /= sum;
+
+            for(prec_t t : {0.0, 0.1, 0.5, 1.0, 2.0}){
+                auto expected = worstcase_l1_reference(z, q, t);
+
+                auto result = worstcase_l1(z, q, t);
+                BOOST_CHECK_SMALL(result.second - expected, 1e-10);
+                BOOST_CHECK_CLOSE(accumulate(result.first.begin(), result.first.end(), 0.0), 1.0, 1e-8);
+                BOOST_CHECK_GE(*min_element(result.first.begin(), result.first.end()), 0.0);
+
+                // the order is reused between the calls
+                auto result_sorted = worstcase_l1_sorted(z, q, t, order);
+                BOOST_CHECK_SMALL(result_sorted.second - expected, 1e-10);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_l1_order_caching){
+    RMDP_L1 rmdp = create_test_mdp<RMDP_L1>();
+    add_transition(rmdp,0,0,1,2,1.0,0.5);
+    add_transition(rmdp,0,0,2,1,1.0,1.5);
+    add_transition(rmdp,1,1,1,0,1.0,0.2);
+    set_outcome_thresholds(rmdp, 0.5);
+
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic}){
+        set_outcome_order_caching(rmdp, false);
+        auto&& sol = rmdp.vi_jac(uncert, 0.9, numvec(0), 200, 0);
+        set_outcome_order_caching(rmdp, true);
+        BOOST_CHECK(rmdp.get_state(0).get_action(0).get_order_caching());
+        auto&& sol_cached = rmdp.vi_jac(uncert, 0.9, numvec(0), 200, 0);
+
+        CHECK_CLOSE_COLLECTION(sol.valuefunction, sol_cached.valuefunction, 1e-8);
+        BOOST_CHECK_EQUAL_COLLECTIONS(sol.policy.begin(), sol.policy.end(),
+                                      sol_cached.policy.begin(), sol_cached.policy.end());
+    }
+
+    // robust and optimistic solutions alternate on the same model with separate orders
+    set_outcome_order_caching(rmdp, false);
+    auto&& robust = rmdp.vi_jac(Uncertainty::Robust, 0.9, numvec(0), 200, 0);
+    auto&& optimistic = rmdp.vi_jac(Uncertainty::Optimistic, 0.9, numvec(0), 200, 0);
+    set_outcome_order_caching(rmdp, true);
+    for(int i = 0; i < 3; i++){
+        auto&& robust_cached = rmdp.vi_jac(Uncertainty::Robust, 0.9, numvec(0), 200, 0);
+        auto&& optimistic_cached = rmdp.vi_jac(Uncertainty::Optimistic, 0.9, numvec(0), 200, 0);
+        CHECK_CLOSE_COLLECTION(robust_cached.valuefunction, robust.valuefunction, 1e-8);
+        CHECK_CLOSE_COLLECTION(optimistic_cached.valuefunction, optimistic.valuefunction, 1e-8);
+    }
+}
+
 
 // ********************************************************************************
 // ***** Basic solution tests **********************************************************
@@ -207,11 +310,29 @@ void test_simple_vi(typename Model::OutcomePolicy natpol_rob){
     auto&& occupancy_freq = rmdp.ofreq_mat(init_d,0.9,re.policy,re.outcomes);
     CHECK_CLOSE_COLLECTION(occupancy_freq, occ_freq3, 1e-3);
 
+    auto&& occupancy_freq_iter = rmdp.ofreq_iter(init_d,0.9,re.policy,re.outcomes);
+    CHECK_CLOSE_COLLECTION(occupancy_freq_iter, occ_freq3, 1e-3);
+
     auto&& rewards = rmdp.rewards_state(re3.policy,re3.outcomes);
     auto cmp_tr = inner_product(rewards.begin(), rewards.end(), occupancy_freq.begin(), 0.0);
     BOOST_CHECK_CLOSE (cmp_tr, ret_true, 1e-3);
 }
 
+BOOST_AUTO_TEST_CASE(test_mixed_transition_rewards){
+    // the rewards of the mixture are the probability-weighted rewards of the transitions
+    Transition first(indvec{0}, numvec{1.0}, numvec{2.0});
+    Transition second(indvec{0, 1}, numvec{0.5, 0.5}, numvec{4.0, 8.0});
+    Transition mixed;
+    first.probabilities_addto(0.5, mixed);
+    second.probabilities_addto(0.5, mixed);
+
+    const numvec probabilities{0.75, 0.25};
+    CHECK_CLOSE_COLLECTION(mixed.get_probabilities(), probabilities, 1e-10);
+    BOOST_CHECK_CLOSE(mixed.mean_reward(), 0.5 * first.mean_reward() + 0.5 * second.mean_reward(), 1e-10);
+    BOOST_CHECK_CLOSE(mixed.get_rewards()[0], (0.5 * 2.0 + 0.25 * 4.0) / 0.75, 1e-10);
+    BOOST_CHECK_CLOSE(mixed.get_rewards()[1], 8.0, 1e-10);
+}
+
 BOOST_AUTO_TEST_CASE(simple_mdp_vi_of_nonrobust) {
     test_simple_vi<MDP>(indvec{0,0,0});
 }
@@ -224,6 +345,600 @@ BOOST_AUTO_TEST_CASE(simple_rmdpl1_vi_of_nonrobust) {
     test_simple_vi<RMDP_L1>(vector<numvec>{numvec{1},numvec{1},numvec{1}});
 }
 
+/// Random MDP with a fixed number of (normalized) transitions from each state and action
+MDP create_random_mdp(size_t statecount, size_t actioncount, size_t nonzeros, unsigned seed){
+    default_random_engine gen(seed);
+    uniform_int_distribution<long> state(0, statecount-1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+
+    MDP mdp(statecount);
+    for(size_t s = 0; s < statecount; s++){
+        for(size_t a = 0; a < actioncount; a++){
+            for(size_t k = 0; k < nonzeros; k++)
+                add_transition(mdp, s, a, state(gen), value(gen), value(gen));
+        }
+    }
+    mdp.normalize();
+    return mdp;
+}
+
+template<class Model>
+void test_sparse_transition_mat(const Model& mdp, const typename Model::ActionPolicy& policy,
+                                const typename Model::OutcomePolicy& nature){
+    const size_t n = mdp.state_count();
+
+    auto&& dense = mdp.transition_mat(policy, nature);
+    auto&& dense_t = mdp.transition_mat_t(policy, nature);
+    auto&& sparse = mdp.transition_mat_sparse(policy, nature);
+    auto&& sparse_t = mdp.transition_mat_sparse_t(policy, nature);
+
+    BOOST_CHECK_EQUAL(sparse.rows(), n);
+    BOOST_CHECK_EQUAL(sparse_t.cols(), n);
+    BOOST_CHECK_EQUAL(sparse.nonzero_count(), sparse_t.nonzero_count());
+
+    for(size_t i = 0; i < n; i++){
+        // terminal states have zero rows only in the transposed dense matrix
+        if(mdp.get_state(i).is_terminal()) continue;
+        for(size_t j = 0; j < n; j++){
+            BOOST_CHECK_EQUAL(sparse.get(i,j), (*dense)(i,j));
+            BOOST_CHECK_EQUAL(sparse_t.get(j,i), (*dense_t)(j,i));
+        }
+    }
+
+    // conversion to and from ublas
+    auto&& compressed = sparse.to_ublas();
+    BOOST_CHECK_EQUAL(compressed.nnz(), sparse.nonzero_count());
+    SparseMatrix converted(compressed);
+    BOOST_CHECK(converted.get_row_offsets() == sparse.get_row_offsets());
+    BOOST_CHECK(converted.get_columns() == sparse.get_columns());
+    BOOST_CHECK(converted.get_values() == sparse.get_values());
+
+    // multiplication
+    numvec x(n);
+    iota(x.begin(), x.end(), 1.0);
+    auto&& y = sparse.multiply(x);
+    for(size_t i = 0; i < n; i++){
+        if(mdp.get_state(i).is_terminal()) continue;
+        prec_t expected = 0;
+        for(size_t j = 0; j < n; j++) expected += (*dense)(i,j) * x[j];
+        BOOST_CHECK_CLOSE(y[i], expected, 1e-10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_transition_mat_sparse){
+    MDP mdp = create_random_mdp(50, 3, 4, 3);
+    auto&& sol = mdp.mpi_jac(Uncertainty::Average, 0.9);
+    test_sparse_transition_mat(mdp, sol.policy, sol.outcomes);
+
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.5);
+    auto&& rsol = rmdp.mpi_jac(Uncertainty::Robust, 0.9);
+    test_sparse_transition_mat(rmdp, rsol.policy, rsol.outcomes);
+}
+
+template<class Model>
+void test_policy_iteration(const Model& mdp, prec_t discount){
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        auto&& sol_mpi = mdp.mpi_jac(uncert, discount, numvec(0), MAXITER, 1e-9, MAXITER, 1e-10);
+        auto&& sol_pi = mdp.pi_bicg(uncert, discount, numvec(0), 1000, 1e-9, MAXITER, 1e-11);
+
+        BOOST_CHECK_LE(sol_pi.residual, 1e-9);
+        BOOST_CHECK_LT(sol_pi.iterations, sol_mpi.iterations + 1);
+        CHECK_CLOSE_COLLECTION(sol_pi.valuefunction, sol_mpi.valuefunction, 1e-5);
+        BOOST_CHECK_EQUAL_COLLECTIONS(sol_pi.policy.begin(), sol_pi.policy.end(),
+                                      sol_mpi.policy.begin(), sol_mpi.policy.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_policy_iteration_bicg){
+    MDP mdp = create_random_mdp(200, 3, 5, 11);
+    test_policy_iteration(mdp, 0.99);
+
+    // discrete outcomes
+    default_random_engine gen(5);
+    uniform_int_distribution<long> state(0, 99);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    RMDP_D rmdp_d(100);
+    for(long s = 0; s < 100; s++)
+        for(long a = 0; a < 2; a++)
+            for(long o = 0; o < 3; o++)
+                for(int k = 0; k < 3; k++)
+                    add_transition(rmdp_d, s, a, o, state(gen), value(gen), value(gen));
+    rmdp_d.normalize();
+    test_policy_iteration(rmdp_d, 0.99);
+
+    RMDP_L1 rmdp_l1 = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp_l1, 0.2);
+    test_policy_iteration(rmdp_l1, 0.99);
+
+    // terminal states
+    test_policy_iteration(create_test_mdp<MDP>(), 0.9);
+}
+
+BOOST_AUTO_TEST_CASE(test_ofreq_sparse){
+    const prec_t discount = 0.95;
+
+    for(size_t statecount : {size_t(300), OFREQ_DENSE_MAXSTATES + 500}){
+        MDP mdp = create_random_mdp(statecount, 2, 5, 7);
+        auto&& sol = mdp.mpi_jac(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+
+        Transition init;
+        for(size_t s = 0; s < statecount; s += 7)
+            init.add_sample(s, 1.0, 0.0);
+        init.normalize();
+
+        auto&& freq = mdp.ofreq_iter(init, discount, sol.policy, sol.outcomes);
+
+        // the frequencies of a normalized model sum to 1/(1-discount)
+        BOOST_CHECK_CLOSE(accumulate(freq.begin(), freq.end(), 0.0), 1.0/(1.0-discount), 1e-4);
+
+        // the return computed from the frequencies matches the value function
+        auto&& rewards = mdp.rewards_state(sol.policy, sol.outcomes);
+        BOOST_CHECK_CLOSE(inner_product(rewards.begin(), rewards.end(), freq.begin(), 0.0),
+                          sol.total_return(init), 1e-4);
+
+        // ofreq_mat uses the dense solver for small models and the iterative one for large ones
+        auto&& freq_mat = mdp.ofreq_mat(init, discount, sol.policy, sol.outcomes);
+        CHECK_CLOSE_COLLECTION(freq, freq_mat, 1e-4);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_state_graph_components){
+    MDP mdp;
+    // cycle between 0 and 1
+    add_transition(mdp, 0, 0, 1, 1.0, 1.0);
+    add_transition(mdp, 1, 0, 0, 0.5, 1.0);
+    add_transition(mdp, 1, 0, 2, 0.5, 1.0);
+    // self-loop
+    add_transition(mdp, 2, 0, 2, 1.0, 1.0);
+    add_transition(mdp, 3, 1, 0, 1.0, 1.0);
+    // 4 is terminal
+    add_transition(mdp, 5, 0, 3, 1.0, 1.0);
+    add_transition(mdp, 5, 1, 4, 1.0, 1.0);
+
+    StateGraph graph(mdp);
+    BOOST_CHECK_EQUAL(graph.state_count(), 6);
+    BOOST_CHECK_EQUAL(graph.edge_count(), 7);
+    indvec successors = graph.get_successors(5), successors_expected{3,4};
+    BOOST_CHECK_EQUAL_COLLECTIONS(successors.begin(), successors.end(),
+                                  successors_expected.begin(), successors_expected.end());
+    indvec predecessors = graph.get_predecessors(0), predecessors_expected{1,3};
+    BOOST_CHECK_EQUAL_COLLECTIONS(predecessors.begin(), predecessors.end(),
+                                  predecessors_expected.begin(), predecessors_expected.end());
+    BOOST_CHECK(graph.has_self_loop(2));
+    BOOST_CHECK(!graph.has_self_loop(1));
+
+    auto&& comps = graph.strongly_connected_components();
+    const auto& c = comps.component;
+    BOOST_CHECK_EQUAL(comps.size(), 5);
+    BOOST_CHECK_EQUAL(c[0], c[1]);
+    indvec cycle_expected{0,1};
+    BOOST_CHECK_EQUAL_COLLECTIONS(comps.states[c[0]].begin(), comps.states[c[0]].end(),
+                                  cycle_expected.begin(), cycle_expected.end());
+    // successors are in components with smaller indices
+    BOOST_CHECK_LT(c[2], c[0]);
+    BOOST_CHECK_LT(c[0], c[3]);
+    BOOST_CHECK_LT(c[3], c[5]);
+    BOOST_CHECK_LT(c[4], c[5]);
+
+    BOOST_CHECK_EQUAL(comps.level[c[2]], 0);
+    BOOST_CHECK_EQUAL(comps.level[c[4]], 0);
+    BOOST_CHECK_EQUAL(comps.level[c[0]], 1);
+    BOOST_CHECK_EQUAL(comps.level[c[3]], 2);
+    BOOST_CHECK_EQUAL(comps.level[c[5]], 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_vi_scc){
+    const prec_t discount = 0.95;
+
+    // cyclic model
+    MDP mdp = create_random_mdp(200, 3, 4, 9);
+    auto&& sol_gs = mdp.vi_gs(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-10);
+    auto&& sol_scc = mdp.vi_scc(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-10);
+    CHECK_CLOSE_COLLECTION(sol_scc.valuefunction, sol_gs.valuefunction, 1e-6);
+    BOOST_CHECK_LE(sol_scc.residual, 1e-10);
+
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic}){
+        auto&& rsol_gs = rmdp.vi_gs(uncert, discount, numvec(0), MAXITER, 1e-10);
+        auto&& rsol_scc = rmdp.vi_scc(uncert, discount, numvec(0), MAXITER, 1e-10);
+        CHECK_CLOSE_COLLECTION(rsol_scc.valuefunction, rsol_gs.valuefunction, 1e-6);
+    }
+
+    // acyclic model with transitions to states with greater indices and a terminal last state
+    const long statecount = 500;
+    default_random_engine gen(3);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    MDP acyclic(statecount);
+    for(long s = 0; s < statecount - 1; s++){
+        uniform_int_distribution<long> next(s + 1, min(s + 10, statecount - 1));
+        for(long a = 0; a < 2; a++)
+            for(int k = 0; k < 3; k++)
+                add_transition(acyclic, s, a, next(gen), value(gen), value(gen));
+    }
+    acyclic.normalize();
+
+    auto&& asol_scc = acyclic.vi_scc(Uncertainty::Robust, discount);
+    auto&& asol_gs = acyclic.vi_gs(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-12);
+    BOOST_CHECK_EQUAL(asol_scc.iterations, 1);
+    CHECK_CLOSE_COLLECTION(asol_scc.valuefunction, asol_gs.valuefunction, 1e-8);
+    BOOST_CHECK_EQUAL_COLLECTIONS(asol_scc.policy.begin(), asol_scc.policy.end(),
+                                  asol_gs.policy.begin(), asol_gs.policy.end());
+}
+
+BOOST_AUTO_TEST_CASE(test_vi_prioritized_sweeping){
+    const prec_t discount = 0.95;
+
+    MDP mdp = create_random_mdp(300, 3, 4, 13);
+    auto&& sol_gs = mdp.vi_gs(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-10);
+    auto&& sol_ps = mdp.vi_ps(Uncertainty::Average, discount, numvec(0), 0, 1e-10);
+    CHECK_CLOSE_COLLECTION(sol_ps.valuefunction, sol_gs.valuefunction, 1e-6);
+    BOOST_CHECK_LE(sol_ps.residual, 1e-10);
+
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        auto&& rsol_gs = rmdp.vi_gs(uncert, discount, numvec(0), MAXITER, 1e-10);
+        auto&& rsol_ps = rmdp.vi_ps(uncert, discount, numvec(0), 0, 1e-10);
+        CHECK_CLOSE_COLLECTION(rsol_ps.valuefunction, rsol_gs.valuefunction, 1e-6);
+    }
+
+    // a localized change in a model with limited reachability: only states
+    // that lead to the changed state need to be updated
+    const long statecount = 1000;
+    default_random_engine gen(17);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    MDP local(statecount);
+    for(long s = 0; s < statecount; s++){
+        uniform_int_distribution<long> next(max(s - 5, 0l), min(s + 5, statecount - 1));
+        for(long a = 0; a < 2; a++)
+            for(int k = 0; k < 3; k++)
+                add_transition(local, s, a, next(gen), value(gen), value(gen));
+    }
+    local.normalize();
+
+    auto&& base = local.vi_gs(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-10);
+    add_transition(local, statecount - 1, 0, statecount - 1, 0.5, 100.0);
+    local.get_state(statecount - 1).get_action(0).get_outcome().normalize();
+
+    auto&& updated_gs = local.vi_gs(Uncertainty::Robust, discount, base.valuefunction, MAXITER, 1e-8);
+    auto&& updated_ps = local.vi_ps(Uncertainty::Robust, discount, base.valuefunction, 0, 1e-8);
+    CHECK_CLOSE_COLLECTION(updated_ps.valuefunction, updated_gs.valuefunction, 1e-4);
+    // the number of backups is much smaller than for sweeps over all states
+    BOOST_CHECK_LT(updated_ps.iterations, updated_gs.iterations * statecount / 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_vi_action_elimination){
+    const prec_t discount = 0.95;
+
+    // many actions in each state
+    MDP mdp = create_random_mdp(200, 30, 4, 23);
+    auto&& exact = mdp.mpi_jac(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-12, MAXITER, 1e-13);
+    auto&& plain = mdp.vi_jac(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-6);
+    auto&& ae = mdp.vi_jac_ae(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-6);
+
+    // the midpoint of the bounds is within discount/(1-discount) * span / 2 of the optimum
+    const prec_t bound = discount / (1 - discount) * ae.residual / 2;
+    for(size_t s = 0; s < mdp.state_count(); s++)
+        BOOST_CHECK_SMALL(ae.valuefunction[s] - exact.valuefunction[s], bound + 1e-10);
+    BOOST_CHECK_EQUAL_COLLECTIONS(ae.policy.begin(), ae.policy.end(),
+                                  exact.policy.begin(), exact.policy.end());
+    // the span stopping rule needs fewer iterations
+    BOOST_CHECK_LT(ae.iterations, plain.iterations);
+
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.2);
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic}){
+        auto&& rexact = rmdp.mpi_jac(uncert, discount, numvec(0), MAXITER, 1e-12, MAXITER, 1e-13);
+        auto&& rae = rmdp.vi_jac_ae(uncert, discount, numvec(0), MAXITER, 1e-8);
+        CHECK_CLOSE_COLLECTION(rae.valuefunction, rexact.valuefunction, 1e-4);
+    }
+
+    // terminal states
+    auto&& test_mdp = create_test_mdp<MDP>();
+    auto&& texact = test_mdp.mpi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-12, MAXITER, 1e-13);
+    auto&& tae = test_mdp.vi_jac_ae(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-10);
+    CHECK_CLOSE_COLLECTION(tae.valuefunction, texact.valuefunction, 1e-5);
+
+    BOOST_CHECK_THROW(mdp.vi_jac_ae(Uncertainty::Average, 1.0), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_vi_batch){
+    const numvec discounts{0.5, 0.8, 0.9, 0.95, 0.99};
+
+    MDP mdp = create_random_mdp(100, 3, 4, 29);
+    auto&& batch = mdp.vi_jac_batch(Uncertainty::Average, discounts, vector<numvec>(0), MAXITER, 1e-8);
+    BOOST_REQUIRE_EQUAL(batch.size(), discounts.size());
+    for(size_t j = 0; j < discounts.size(); j++){
+        auto&& single = mdp.vi_jac(Uncertainty::Average, discounts[j], numvec(0), MAXITER, 1e-8);
+        CHECK_CLOSE_COLLECTION(batch[j].valuefunction, single.valuefunction, 1e-5);
+        BOOST_CHECK_EQUAL_COLLECTIONS(batch[j].policy.begin(), batch[j].policy.end(),
+                                      single.policy.begin(), single.policy.end());
+        BOOST_CHECK_LE(batch[j].residual, 1e-8);
+    }
+
+    // reward shifts with a single discount factor
+    default_random_engine gen(31);
+    uniform_real_distribution<prec_t> value(-1.0, 1.0);
+    vector<numvec> shifts(3, numvec(mdp.state_count()));
+    for(auto& shift : shifts)
+        for(auto& r : shift) r = value(gen);
+
+    auto&& shifted = mdp.vi_jac_batch(Uncertainty::Robust, numvec{0.9}, shifts, MAXITER, 1e-8);
+    BOOST_REQUIRE_EQUAL(shifted.size(), shifts.size());
+    for(size_t j = 0; j < shifts.size(); j++){
+        // construct the model with the rewards added explicitly
+        MDP changed = mdp;
+        for(size_t s = 0; s < changed.state_count(); s++){
+            for(size_t a = 0; a < changed[s].action_count(); a++){
+                Transition& t = changed.get_state(s).get_action(a).get_outcome();
+                for(size_t i = 0; i < t.size(); i++)
+                    t.set_reward(i, t.get_rewards()[i] + shifts[j][t.get_indices()[i]]);
+            }
+        }
+        auto&& single = changed.vi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-8);
+        CHECK_CLOSE_COLLECTION(shifted[j].valuefunction, single.valuefunction, 1e-5);
+    }
+
+    // uncertain models
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        auto&& rbatch = rmdp.vi_jac_batch(uncert, discounts, vector<numvec>(0), MAXITER, 1e-8);
+        for(size_t j = 0; j < discounts.size(); j++){
+            auto&& single = rmdp.vi_jac(uncert, discounts[j], numvec(0), MAXITER, 1e-8);
+            CHECK_CLOSE_COLLECTION(rbatch[j].valuefunction, single.valuefunction, 1e-5);
+        }
+    }
+
+    // terminal states
+    auto&& tbatch = create_test_mdp<RMDP_D>().vi_jac_batch(Uncertainty::Robust, discounts,
+                                                           vector<numvec>(0), MAXITER, 1e-10);
+    for(size_t j = 0; j < discounts.size(); j++){
+        auto&& single = create_test_mdp<RMDP_D>().vi_jac(Uncertainty::Robust, discounts[j], numvec(0),
+                                                         MAXITER, 1e-10);
+        CHECK_CLOSE_COLLECTION(tbatch[j].valuefunction, single.valuefunction, 1e-5);
+    }
+
+    BOOST_CHECK_THROW(mdp.vi_jac_batch(Uncertainty::Average, numvec{0.9, 0.8}, shifts), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_partitioned_mdp){
+    // a chain with neighboring transitions and randomly shuffled states
+    const long statecount = 200;
+    default_random_engine gen(37);
+    uniform_real_distribution<prec_t> value(0.1, 1.0);
+
+    MDP chain(statecount);
+    for(long s = 0; s < statecount; s++){
+        for(long a = 0; a < 2; a++){
+            for(long t = max(0l, s-1); t <= min(statecount-1, s+1); t++)
+                add_transition(chain, s, a, t, value(gen), value(gen) * (a+1) * (t == s ? 1.0 : 0.5));
+        }
+    }
+    chain.normalize();
+
+    indvec shuffle(statecount);
+    iota(shuffle.begin(), shuffle.end(), 0);
+    std::shuffle(shuffle.begin(), shuffle.end(), gen);
+    MDP mdp = chain.permute_states(shuffle);
+
+    // the maximal distance between connected states
+    auto bandwidth = [](const MDP& m){
+        long width = 0;
+        for(size_t s = 0; s < m.state_count(); s++)
+            for(const auto& action : m[s].get_actions())
+                for(long t : action.get_outcome().get_indices())
+                    width = max(width, abs(t - long(s)));
+        return width;
+    };
+
+    PartitionedMDP<RegularState> partitioned(mdp);
+    BOOST_CHECK_EQUAL(partitioned.state_count(), mdp.state_count());
+    BOOST_CHECK_GT(bandwidth(mdp), 10);
+    BOOST_CHECK_LE(bandwidth(partitioned.get_model()), 2);
+    for(long s = 0; s < statecount; s++)
+        BOOST_CHECK_EQUAL(partitioned.get_inverse()[partitioned.get_order()[s]], s);
+
+    // solutions are reported for the original states
+    auto&& vi = mdp.vi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-10);
+    auto&& pvi = partitioned.vi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-10);
+    CHECK_CLOSE_COLLECTION(vi.valuefunction, pvi.valuefunction, 1e-6);
+    BOOST_CHECK_EQUAL_COLLECTIONS(vi.policy.begin(), vi.policy.end(), pvi.policy.begin(), pvi.policy.end());
+
+    auto&& mpi = partitioned.mpi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+    CHECK_CLOSE_COLLECTION(vi.valuefunction, mpi.valuefunction, 1e-6);
+
+    auto&& fix = mdp.vi_jac_fix(0.9, vi.policy, vi.outcomes, numvec(0), MAXITER, 1e-10);
+    auto&& pfix = partitioned.vi_jac_fix(0.9, vi.policy, vi.outcomes, numvec(0), MAXITER, 1e-10);
+    CHECK_CLOSE_COLLECTION(fix.valuefunction, pfix.valuefunction, 1e-6);
+
+    // uncertain models
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+    PartitionedMDP<L1RobustState> rpartitioned(rmdp);
+    auto&& rvi = rmdp.vi_jac(Uncertainty::Optimistic, 0.9, numvec(0), MAXITER, 1e-10);
+    auto&& rpvi = rpartitioned.vi_jac(Uncertainty::Optimistic, 0.9, numvec(0), MAXITER, 1e-10);
+    CHECK_CLOSE_COLLECTION(rvi.valuefunction, rpvi.valuefunction, 1e-6);
+
+    BOOST_CHECK_THROW(mdp.permute_states(indvec(statecount, 0)), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_reorder_states){
+    MDP mdp = create_random_mdp(150, 3, 4, 41);
+
+    auto&& reordered = mdp.reorder_states();
+    const MDP& model = reordered.first;
+    const indvec& order = reordered.second;
+    BOOST_REQUIRE_EQUAL(order.size(), mdp.state_count());
+
+    indvec sorted(order);
+    sort(sorted.begin(), sorted.end());
+    for(size_t i = 0; i < sorted.size(); i++)
+        BOOST_CHECK_EQUAL(sorted[i], long(i));
+
+    // states are moved with their actions and rewards
+    for(size_t s = 0; s < model.state_count(); s++)
+        BOOST_CHECK_EQUAL(model[s].action_count(), mdp[order[s]].action_count());
+
+    // solutions of the reordered model match after the order is restored
+    auto&& original = mdp.mpi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+    auto&& restored = model.mpi_jac(Uncertainty::Robust, 0.9, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11)
+                        .restore_order(order);
+    CHECK_CLOSE_COLLECTION(original.valuefunction, restored.valuefunction, 1e-6);
+    BOOST_CHECK_EQUAL_COLLECTIONS(original.policy.begin(), original.policy.end(),
+                                  restored.policy.begin(), restored.policy.end());
+
+    // permuted solutions evaluate the same in the reordered model
+    auto&& permuted = original.permute(order);
+    auto&& evaluated = model.vi_jac_fix(0.9, permuted.policy, permuted.outcomes, numvec(0), MAXITER, 1e-10);
+    auto&& evaluated_original = evaluated.restore_order(order);
+    CHECK_CLOSE_COLLECTION(evaluated_original.valuefunction, original.valuefunction, 1e-6);
+
+    BOOST_CHECK_THROW(restore_vector(numvec(3), order), invalid_argument);
+    BOOST_CHECK_THROW(inverse_permutation(indvec{0, 2, 2}), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_schedules){
+    // a few states are much more expensive than the others
+    const long statecount = 400;
+    indvec costs(statecount, 2);
+    for(long s = 0; s < 20; s++) costs[s] = 1000;
+
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    for(auto schedule : {Schedule::Static, Schedule::Balanced, Schedule::Dynamic}){
+        StateBlocks blocks(costs, schedule);
+        BOOST_CHECK_EQUAL(blocks.is_dynamic(), schedule == Schedule::Dynamic);
+        BOOST_REQUIRE_GE(blocks.size(), 1u);
+        BOOST_CHECK_EQUAL(blocks.begin(0), 0);
+        BOOST_CHECK_EQUAL(blocks.end(blocks.size() - 1), statecount);
+        for(size_t b = 0; b < blocks.size(); b++){
+            BOOST_CHECK_LT(blocks.begin(b), blocks.end(b));
+            if(b > 0) BOOST_CHECK_EQUAL(blocks.begin(b), blocks.end(b-1));
+        }
+    }
+#ifdef _OPENMP
+    // the balanced blocks have similar costs, unlike the static ones
+    StateBlocks balanced(costs, Schedule::Balanced);
+    BOOST_CHECK_EQUAL(balanced.size(), 4u);
+    BOOST_CHECK_LE(balanced.end(0), 10);
+    BOOST_CHECK_EQUAL(StateBlocks(statecount).end(0), 100);
+    omp_set_num_threads(threads);
+#endif
+
+    // the schedule does not change the solutions
+    MDP mdp = create_random_mdp(200, 3, 4, 43);
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+    auto&& cmdp = freeze(rmdp);
+
+    auto&& vi = rmdp.vi_jac(Uncertainty::Robust, 0.9);
+    auto&& mpi = rmdp.mpi_jac(Uncertainty::Robust, 0.9);
+    for(auto schedule : {Schedule::Balanced, Schedule::Dynamic}){
+        set_schedule(schedule);
+        BOOST_CHECK(get_schedule() == schedule);
+
+        auto&& svi = rmdp.vi_jac(Uncertainty::Robust, 0.9);
+        BOOST_CHECK_EQUAL_COLLECTIONS(vi.valuefunction.begin(), vi.valuefunction.end(),
+                                      svi.valuefunction.begin(), svi.valuefunction.end());
+        auto&& smpi = rmdp.mpi_jac(Uncertainty::Robust, 0.9);
+        BOOST_CHECK_EQUAL_COLLECTIONS(mpi.valuefunction.begin(), mpi.valuefunction.end(),
+                                      smpi.valuefunction.begin(), smpi.valuefunction.end());
+        auto&& cvi = cmdp.vi_jac(Uncertainty::Robust, 0.9);
+        CHECK_CLOSE_COLLECTION(vi.valuefunction, cvi.valuefunction, 1e-6);
+        auto&& fix = rmdp.vi_jac_fix(0.9, vi.policy, vi.outcomes);
+        CHECK_CLOSE_COLLECTION(vi.valuefunction, fix.valuefunction, 1e-3);
+    }
+    set_schedule(Schedule::Static);
+}
+
+BOOST_AUTO_TEST_CASE(test_vi_gs_async){
+    MDP mdp = create_random_mdp(300, 3, 4, 61);
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+
+#ifdef _OPENMP
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    // a single thread computes the same iterates as the sequential method
+    auto&& gs = rmdp.vi_gs(Uncertainty::Robust, 0.95, numvec(0), MAXITER, 1e-10);
+    auto&& single = rmdp.vi_gs_async(Uncertainty::Robust, 0.95, numvec(0), MAXITER, 1e-10);
+    BOOST_CHECK_EQUAL_COLLECTIONS(gs.valuefunction.begin(), gs.valuefunction.end(),
+                                  single.valuefunction.begin(), single.valuefunction.end());
+    BOOST_CHECK_EQUAL(gs.iterations, single.iterations);
+
+    // several threads converge to the same value function with fewer sweeps than Jacobi
+    auto&& jac = rmdp.vi_jac(Uncertainty::Robust, 0.95, numvec(0), MAXITER, 1e-10);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    for(auto schedule : {Schedule::Static, Schedule::Dynamic}){
+        set_schedule(schedule);
+        for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+            auto&& reference = rmdp.vi_jac(uncert, 0.95, numvec(0), MAXITER, 1e-10);
+            auto&& async = rmdp.vi_gs_async(uncert, 0.95, numvec(0), MAXITER, 1e-10);
+            CHECK_CLOSE_COLLECTION(reference.valuefunction, async.valuefunction, 1e-6);
+            BOOST_CHECK_LE(async.residual, 1e-10);
+        }
+        auto&& async = rmdp.vi_gs_async(Uncertainty::Robust, 0.95, numvec(0), MAXITER, 1e-10);
+        BOOST_CHECK_LT(async.iterations, jac.iterations);
+    }
+    set_schedule(Schedule::Static);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+
+    BOOST_CHECK_THROW(rmdp.vi_gs_async(Uncertainty::Robust, 0.9, numvec(3)), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_anderson_acceleration){
+    const prec_t discount = 0.999;
+
+    MDP mdp = create_random_mdp(300, 3, 5, 21);
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+
+    auto&& plain = mdp.vi_jac(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-8);
+    auto&& accel = mdp.vi_jac(Uncertainty::Average, discount, numvec(0), MAXITER, 1e-8, 5);
+    BOOST_CHECK_LE(accel.residual, 1e-8);
+    BOOST_CHECK_EQUAL(accel.sweeps, accel.iterations);
+    CHECK_CLOSE_COLLECTION(accel.valuefunction, plain.valuefunction, 1e-3);
+    BOOST_CHECK_LT(accel.sweeps * 10, plain.sweeps);
+
+    auto&& rplain = rmdp.vi_jac(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-8);
+    auto&& raccel = rmdp.vi_jac(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-8, 5);
+    CHECK_CLOSE_COLLECTION(raccel.valuefunction, rplain.valuefunction, 1e-3);
+    BOOST_CHECK_LT(raccel.sweeps * 10, rplain.sweeps);
+
+    // inner loop of modified policy iteration
+    auto&& mplain = rmdp.mpi_jac(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-8, MAXITER, 1e-9);
+    auto&& maccel = rmdp.mpi_jac(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-8, MAXITER, 1e-9,
+                                 false, 5);
+    CHECK_CLOSE_COLLECTION(maccel.valuefunction, mplain.valuefunction, 1e-3);
+    BOOST_CHECK_LT(maccel.sweeps, mplain.sweeps);
+
+    // the compressed model uses the same acceleration
+    auto&& compressed = freeze(rmdp).vi_jac(Uncertainty::Robust, discount, numvec(0), MAXITER, 1e-8, 5);
+    CHECK_CLOSE_COLLECTION(compressed.valuefunction, raccel.valuefunction, 1e-8);
+    BOOST_CHECK_EQUAL(compressed.sweeps, raccel.sweeps);
+
+    // the last iterate is not extrapolated when the iterations run out, so it is
+    // consistent with the policy and the residual (the first step is never extrapolated)
+    for(bool frozen : {false, true}){
+        auto&& limited = frozen ? freeze(rmdp).vi_jac(Uncertainty::Robust, discount, numvec(0), 2, 0, 5)
+                                : rmdp.vi_jac(Uncertainty::Robust, discount, numvec(0), 2, 0, 5);
+        auto&& unlimited = rmdp.vi_jac(Uncertainty::Robust, discount, numvec(0), 2, 0);
+        CHECK_CLOSE_COLLECTION(limited.valuefunction, unlimited.valuefunction, 1e-12);
+        BOOST_CHECK_CLOSE(limited.residual, unlimited.residual, 1e-8);
+        BOOST_CHECK(limited.policy == unlimited.policy);
+    }
+}
+
 
 // ********************************************************************************
 // ***** MDP modified policy iteration ********************************************
@@ -472,6 +1187,134 @@ void test_value_function() {
 }
 
 
+template<class Model>
+void test_parallel_csv(const Model& rmdp1){
+    const string filename = "test_model.csv";
+    rmdp1.to_csv_file(filename);
+
+    Model rmdp2, rmdp3;
+    LoadStatistics statistics;
+    from_csv_file(rmdp2, filename);
+    from_csv_file_parallel(rmdp3, filename, true, &statistics);
+
+    BOOST_CHECK_EQUAL(rmdp2.to_json(), rmdp3.to_json());
+    BOOST_CHECK_EQUAL(statistics.transitions, freeze(rmdp1).nonzero_count());
+    BOOST_CHECK_GT(statistics.bytes, 0);
+    BOOST_CHECK_GE(statistics.megabytes_per_second(), 0);
+
+    Model rmdp4;
+    BOOST_CHECK_THROW(from_csv_file_parallel(rmdp4, filename, false), invalid_argument);
+    remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_csv_loader){
+    test_parallel_csv(create_test_mdp<MDP>());
+    test_parallel_csv(create_test_mdp<RMDP_D>());
+    test_parallel_csv(create_test_mdp<RMDP_L1>());
+
+    // lines separated by spaces and no new line at the end
+    const string filename = "test_model.csv";
+    ofstream ofs(filename);
+    ofs << "1,0,0,5,1.0,20.0 2,0,0,5,0.5,30.0\n2,0,0,4,0.5,-1e-3";
+    ofs.close();
+
+    MDP mdp;
+    from_csv_file_parallel(mdp, filename, false);
+    BOOST_CHECK_EQUAL(mdp.state_count(), 6);
+    BOOST_CHECK_EQUAL(mdp[2][0].get_outcome().size(), 2);
+    BOOST_CHECK_EQUAL(mdp[2][0].get_outcome().get_rewards()[0], -1e-3);
+
+    // integers out of range are rejected, like by from_csv
+    ofs.open(filename);
+    ofs << "1,0,0,99999999999999999999999,1.0,20.0\n";
+    ofs.close();
+    MDP mdp1;
+    BOOST_CHECK_THROW(from_csv_file_parallel(mdp1, filename, false), invalid_argument);
+    remove(filename.c_str());
+}
+
+template<class Model>
+void test_bulk_construction(long outcomecount){
+    const size_t n = 50000;
+    default_random_engine gen(31);
+    uniform_int_distribution<long> state(0, 200), action(0, 3), outcome(0, outcomecount - 1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+
+    indvec idstatefrom(n), idaction(n), idoutcome(n), idstateto(n);
+    numvec probabilities(n), rewards(n);
+    for(size_t i = 0; i < n; i++){
+        idstatefrom[i] = state(gen); idaction[i] = action(gen); idoutcome[i] = outcome(gen);
+        idstateto[i] = state(gen); probabilities[i] = value(gen); rewards[i] = value(gen);
+    }
+
+    Model sequential;
+    for(size_t i = 0; i < n; i++)
+        add_transition(sequential, idstatefrom[i], idaction[i], idoutcome[i], idstateto[i],
+                       probabilities[i], rewards[i]);
+    Model bulk(idstatefrom, idaction, idoutcome, idstateto, probabilities, rewards);
+    BOOST_CHECK_EQUAL(sequential.to_json(), bulk.to_json());
+
+    // adding to an existing model
+    add_transition(sequential, 3, 1, 0, 7, 0.25, 1.0);
+    add_transition(sequential, 300, 0, 0, 3, 0.5, 2.0);
+    bulk.add_transitions(indvec{3, 300}, indvec{1, 0}, indvec{0, 0}, indvec{7, 3},
+                         numvec{0.25, 0.5}, numvec{1.0, 2.0});
+    BOOST_CHECK_EQUAL(sequential.to_json(), bulk.to_json());
+
+    // invalid input does not modify the model
+    BOOST_CHECK_THROW(bulk.add_transitions(indvec{1, 1}, indvec{0, 0}, indvec{0, 0}, indvec{2, 2},
+                                           numvec{0.5, -1.0}, numvec{0.0, 0.0}), invalid_argument);
+    BOOST_CHECK_THROW(bulk.add_transitions(indvec{1}, indvec{0}, indvec{0}, indvec{2},
+                                           numvec{0.5, 0.5}, numvec{0.0}), invalid_argument);
+    BOOST_CHECK_EQUAL(sequential.to_json(), bulk.to_json());
+}
+
+BOOST_AUTO_TEST_CASE(test_bulk_model_construction){
+    test_bulk_construction<MDP>(1);
+    test_bulk_construction<RMDP_D>(3);
+    test_bulk_construction<RMDP_L1>(3);
+}
+
+BOOST_AUTO_TEST_CASE(test_streaming_writers){
+    char text[32];
+    for(prec_t value : {0.0, 1.0, -3.0, 0.1, 1.0/3.0, -2.5e-300, 1e300, 123456789.125}){
+        const size_t length = format_number(value, text);
+        BOOST_CHECK_EQUAL(strtod(string(text, length).c_str(), nullptr), value);
+    }
+    BOOST_CHECK_EQUAL(string(text, format_number(0.5, text)), "0.5");
+    BOOST_CHECK_EQUAL(string(text, format_number(-7.0, text)), "-7");
+
+    const long n = 1000;
+    default_random_engine gen(5);
+    uniform_int_distribution<long> state(0, n-1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    RMDP_L1 rmdp(n);
+    for(long s = 0; s < n; s++)
+        for(long o = 0; o < 2; o++)
+            add_transition(rmdp, s, 0, o, state(gen), value(gen), value(gen));
+    set_outcome_thresholds(rmdp, 0.5);
+
+    // the parallel output is the same as the sequential one
+    stringstream csv1, csv2, json1, json2;
+    rmdp.to_csv(csv1, true, false);
+    rmdp.to_csv(csv2, true, true);
+    BOOST_CHECK(csv1.str() == csv2.str());
+    rmdp.to_json(json1, false);
+    rmdp.to_json(json2, true);
+    BOOST_CHECK(json1.str() == json2.str());
+    BOOST_CHECK(json1.str() == rmdp.to_json());
+
+    // the numbers are restored exactly
+    RMDP_L1 rmdp2;
+    from_csv(rmdp2, csv1);
+    for(long s = 0; s < n; s++)
+        for(long o = 0; o < 2; o++){
+            const Transition& t1 = rmdp[s][0][o], & t2 = rmdp2[s][0][o];
+            BOOST_CHECK(t1.get_probabilities() == t2.get_probabilities());
+            BOOST_CHECK(t1.get_rewards() == t2.get_rewards());
+        }
+}
+
 BOOST_AUTO_TEST_CASE(test_value_function_rmdpd){
     test_value_function<RMDP_D>();
 }
@@ -1063,3 +1906,505 @@ BOOST_AUTO_TEST_CASE(test_robustification){
 
 
 
+
+// ********************************************************************************
+//  Compressed (frozen) MDP
+// ********************************************************************************
+
+template<class Model>
+void check_same_solution(const typename Model::SolType& s1, const typename Model::SolType& s2){
+    BOOST_CHECK_EQUAL_COLLECTIONS(s1.valuefunction.begin(), s1.valuefunction.end(),
+                                  s2.valuefunction.begin(), s2.valuefunction.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(s1.policy.begin(), s1.policy.end(),
+                                  s2.policy.begin(), s2.policy.end());
+    BOOST_CHECK(s1.outcomes == s2.outcomes);
+    BOOST_CHECK_EQUAL(s1.residual, s2.residual);
+    BOOST_CHECK_EQUAL(s1.iterations, s2.iterations);
+}
+
+template<class Model>
+void test_compressed_identical(const Model& rmdp){
+    auto cmdp = freeze(rmdp);
+
+    BOOST_CHECK_EQUAL(cmdp.state_count(), rmdp.state_count());
+
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        check_same_solution<Model>(rmdp.vi_gs(uncert,0.9,numvec(0),100,0),
+                                   cmdp.vi_gs(uncert,0.9,numvec(0),100,0));
+        check_same_solution<Model>(rmdp.vi_jac(uncert,0.9,numvec(0),100,0),
+                                   cmdp.vi_jac(uncert,0.9,numvec(0),100,0));
+        check_same_solution<Model>(rmdp.mpi_jac(uncert,0.9,numvec(0),100,1e-8,100,1e-9),
+                                   cmdp.mpi_jac(uncert,0.9,numvec(0),100,1e-8,100,1e-9));
+
+        auto&& sol = rmdp.vi_jac(uncert,0.9);
+        // the average solution does not define a nature's policy
+        if(uncert != Uncertainty::Average)
+            check_same_solution<Model>(rmdp.vi_jac_fix(0.9,sol.policy,sol.outcomes,numvec(0),100,0),
+                                       cmdp.vi_jac_fix(0.9,sol.policy,sol.outcomes,numvec(0),100,0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_compressed_mdp){
+    test_compressed_identical(create_test_mdp<MDP>());
+    test_compressed_identical(create_test_mdp<RMDP_D>());
+    test_compressed_identical(create_test_mdp<RMDP_L1>());
+}
+
+BOOST_AUTO_TEST_CASE(test_compressed_rmdp){
+    string string_representation{
+        "1,0,0,5,1.0,20.0 \
+         2,0,0,5,1.0,30.0 \
+         3,0,0,5,1.0,10.0 \
+         4,0,0,5,1.0,40.0 \
+         4,1,0,5,1.0,41.0 \
+         0,0,0,1,1.0,0.0 \
+         0,0,1,2,1.0,0.0 \
+         0,1,0,3,1.0,0.0 \
+         0,1,0,4,1.0,2.0 \
+         0,1,1,4,1.0,0.0\n"};
+
+    RMDP_D rmdp_d;
+    stringstream store(string_representation);
+    from_csv(rmdp_d,store,false);
+    test_compressed_identical(rmdp_d);
+
+    RMDP_L1 rmdp_l1;
+    stringstream store2(string_representation);
+    from_csv(rmdp_l1,store2,false);
+    rmdp_l1.normalize();
+    set_outcome_thresholds(rmdp_l1,0.5);
+    test_compressed_identical(rmdp_l1);
+}
+
+template<class Model>
+void test_compressed_single_precision(const Model& rmdp){
+    auto cmdp = freeze<float,int32_t>(rmdp);
+
+    BOOST_CHECK_EQUAL(cmdp.state_count(), rmdp.state_count());
+    BOOST_CHECK_EQUAL(cmdp.nonzero_bytes(), cmdp.nonzero_count() * 12);
+
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        auto&& sol = rmdp.mpi_jac(uncert,0.9);
+        auto&& csol = cmdp.mpi_jac(uncert,0.9);
+
+        BOOST_CHECK_EQUAL_COLLECTIONS(sol.policy.begin(), sol.policy.end(),
+                                      csol.policy.begin(), csol.policy.end());
+        for(size_t i = 0; i < sol.valuefunction.size(); i++)
+            BOOST_CHECK_CLOSE(sol.valuefunction[i], csol.valuefunction[i], 1e-3);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_compressed_single_precision_storage){
+    test_compressed_single_precision(create_test_mdp<MDP>());
+    test_compressed_single_precision(create_test_mdp<RMDP_D>());
+    test_compressed_single_precision(create_test_mdp<RMDP_L1>());
+}
+
+template<class SType>
+void test_binary_file(const GRMDP<SType>& rmdp){
+    typedef GRMDP<SType> Model;
+    const string filename = "test_model.bin";
+
+    freeze(rmdp).to_binary_file(filename);
+    auto&& cmdp = CompressedMDP<SType>::from_binary_file(filename);
+    BOOST_CHECK_EQUAL(cmdp.state_count(), rmdp.state_count());
+    BOOST_CHECK_EQUAL(cmdp.nonzero_count(), freeze(rmdp).nonzero_count());
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average})
+        check_same_solution<Model>(rmdp.vi_jac(uncert,0.9,numvec(0),100,0),
+                                   cmdp.vi_jac(uncert,0.9,numvec(0),100,0));
+
+    rmdp.to_binary_file(filename);
+    auto&& loaded = Model::from_binary_file(filename);
+    BOOST_CHECK_EQUAL(loaded.to_json(), rmdp.to_json());
+
+    // the storage types must match
+    BOOST_CHECK_THROW(CompressedMDPf<SType>::from_binary_file(filename), invalid_argument);
+    BOOST_CHECK_THROW(Model::from_binary_file("missing_model.bin"), invalid_argument);
+    remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_model_file){
+    test_binary_file(create_test_mdp<MDP>());
+    test_binary_file(create_test_mdp<RMDP_D>());
+
+    auto rmdp = create_test_mdp<RMDP_L1>();
+    set_outcome_thresholds(rmdp, 0.3);
+    test_binary_file(rmdp);
+}
+
+/// Copies the binary file and overwrites the value in the copy at the position
+template<class T = int64_t>
+void write_corrupted_file(const string& source, const string& target, size_t position, T value){
+    ifstream input(source, ifstream::binary);
+    string contents((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    BOOST_REQUIRE_LE(position + sizeof(value), contents.size());
+    copy_n(reinterpret_cast<const char*>(&value), sizeof(value), contents.begin() + position);
+    ofstream(target, ofstream::binary).write(contents.data(), contents.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_corrupted_binary_model_file){
+    const MDP mdp = create_test_mdp<MDP>();
+    const auto cmdp = freeze(mdp);
+    const string filename = "test_model.bin", corrupted = "test_corrupted.bin";
+    cmdp.to_binary_file(filename);
+
+    // positions of the state offsets and target states in the file
+    const auto align = [](size_t position){return (position + 63) / 64 * 64;};
+    const size_t states = cmdp.state_count(), actions = cmdp.action_count(),
+                 outcomes = cmdp.outcome_count();
+    const size_t stateoffsets = 128;
+    const size_t targets = align(align(align(stateoffsets + (states + 1) * 8) + (actions + 1) * 8)
+                                 + (outcomes + 1) * 8);
+
+    // the unmodified target state loads
+    write_corrupted_file(filename, corrupted, targets, mdp[0][0][0].get_indices()[0]);
+    BOOST_CHECK_NO_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted));
+
+    // the number of states does not fit the offsets
+    write_corrupted_file(filename, corrupted, 32, -1);
+    BOOST_CHECK_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted), invalid_argument);
+    // offsets do not start at 0
+    write_corrupted_file(filename, corrupted, stateoffsets, 1);
+    BOOST_CHECK_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted), invalid_argument);
+    // decreasing offsets
+    write_corrupted_file(filename, corrupted, stateoffsets + 8, actions + 5);
+    BOOST_CHECK_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted), invalid_argument);
+    // target states out of range
+    write_corrupted_file(filename, corrupted, targets, states);
+    BOOST_CHECK_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted), invalid_argument);
+    write_corrupted_file(filename, corrupted, targets, -1);
+    BOOST_CHECK_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted), invalid_argument);
+
+    // truncated file
+    ifstream input(filename, ifstream::binary);
+    string contents((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    ofstream(corrupted, ofstream::binary).write(contents.data(), contents.size() / 2);
+    BOOST_CHECK_THROW(CompressedMDP<RegularState>::from_binary_file(corrupted), invalid_argument);
+
+    remove(filename.c_str());
+    remove(corrupted.c_str());
+}
+
+// ********************************************************************************
+//  Vectorized kernels
+// ********************************************************************************
+
+BOOST_AUTO_TEST_CASE(test_vectorized_kernel){
+    const size_t statecount = 100;
+
+    numvec valuefunction(statecount);
+    for(size_t i = 0; i < statecount; i++)
+        valuefunction[i] = sin(prec_t(i));
+
+    // test all lengths around the vector widths, including the remainders
+    for(size_t count = 1; count <= 37; count++){
+        numvec probabilities(count), rewards(count);
+        indvec indices(count);
+        vector<float> probabilities_f(count), rewards_f(count);
+        vector<int32_t> indices_f(count);
+
+        for(size_t i = 0; i < count; i++){
+            probabilities[i] = 1.0 / prec_t(i+1);
+            rewards[i] = cos(prec_t(i));
+            indices[i] = (i * 37) % statecount;
+            probabilities_f[i] = probabilities[i];
+            rewards_f[i] = rewards[i];
+            indices_f[i] = indices[i];
+        }
+
+        auto scalar = sparse_value_scalar(probabilities.data(), rewards.data(), indices.data(),
+                                          count, valuefunction.data(), 0.9);
+        auto vectorized = sparse_value(probabilities.data(), rewards.data(), indices.data(),
+                                       count, valuefunction.data(), 0.9);
+        BOOST_CHECK_CLOSE(scalar, vectorized, 1e-10);
+
+        auto scalar_f = sparse_value_scalar(probabilities_f.data(), rewards_f.data(), indices_f.data(),
+                                          count, valuefunction.data(), 0.9);
+        auto vectorized_f = sparse_value(probabilities_f.data(), rewards_f.data(), indices_f.data(),
+                                       count, valuefunction.data(), 0.9);
+        BOOST_CHECK_CLOSE(scalar_f, vectorized_f, 1e-10);
+        BOOST_CHECK_CLOSE(scalar, scalar_f, 1e-4);
+    }
+
+    // the scalar kernel can be forced
+    set_vectorized(false);
+    BOOST_CHECK_EQUAL(string(vectorized_kernel()), "scalar");
+    set_vectorized(true);
+}
+
+// ********************************************************************************
+// ***** Model builder ************************************************************
+// ********************************************************************************
+
+/** Checks that two models have the same transitions */
+template<class Model>
+void check_same_model(const Model& a, const Model& b){
+    BOOST_REQUIRE_EQUAL(a.state_count(), b.state_count());
+    for(size_t s = 0; s < a.state_count(); s++){
+        BOOST_REQUIRE_EQUAL(a[s].action_count(), b[s].action_count());
+        for(size_t ai = 0; ai < a[s].action_count(); ai++){
+            const auto& aa = a[s][ai], & ba = b[s][ai];
+            BOOST_REQUIRE_EQUAL(aa.outcome_count(), ba.outcome_count());
+            for(size_t oi = 0; oi < aa.outcome_count(); oi++){
+                const Transition& at = aa[oi], & bt = ba[oi];
+                BOOST_CHECK_EQUAL_COLLECTIONS(at.get_indices().begin(), at.get_indices().end(),
+                                              bt.get_indices().begin(), bt.get_indices().end());
+                BOOST_CHECK_EQUAL_COLLECTIONS(at.get_probabilities().begin(), at.get_probabilities().end(),
+                                              bt.get_probabilities().begin(), bt.get_probabilities().end());
+                BOOST_CHECK_EQUAL_COLLECTIONS(at.get_rewards().begin(), at.get_rewards().end(),
+                                              bt.get_rewards().begin(), bt.get_rewards().end());
+            }
+        }
+    }
+}
+
+template<class SType>
+void check_model_builder(){
+    default_random_engine gen(71);
+    uniform_int_distribution<long> state(0, 99), action(0, 3), outcome(0, 2);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    const bool outcomes = !is_same<SType, RegularState>::value;
+
+    // random order with duplicate targets
+    GRMDP<SType> expected, built;
+    ModelBuilder<SType> builder(built);
+    for(int i = 0; i < 5000; i++){
+        const long s = state(gen), a = action(gen), o = outcomes ? outcome(gen) : 0,
+                   t = state(gen) / 10;
+        const prec_t p = value(gen), r = value(gen);
+        add_transition(expected, s, a, o, t, p, r);
+        builder.add_transition(s, a, o, t, p, r);
+    }
+    BOOST_CHECK_EQUAL(builder.size(), 5000u);
+    // a state that is only a target
+    add_transition(expected, 0, 0, 0, 120, 0.5, 1.0);
+    builder.add_transition(0, 0, 0, 120, 0.5, 1.0);
+
+    builder.build();
+    BOOST_CHECK_EQUAL(builder.size(), 0u);
+    BOOST_CHECK_EQUAL(builder.memory(), 0u);
+    check_same_model(expected, built);
+
+    // the builder adds to existing states
+    add_transition(expected, 3, 5, 0, 7, 0.25, 2.0);
+    builder.add_transition(3, 5, 0, 7, 0.25, 2.0);
+    builder.build();
+    check_same_model(expected, built);
+}
+
+BOOST_AUTO_TEST_CASE(test_model_builder){
+    check_model_builder<RegularState>();
+    check_model_builder<DiscreteRobustState>();
+    check_model_builder<L1RobustState>();
+
+    MDP mdp;
+    ModelBuilder<RegularState> builder(mdp);
+    BOOST_CHECK_THROW(builder.add_transition(-1, 0, 0, 1.0, 0.0), invalid_argument);
+    BOOST_CHECK_THROW(builder.add_transition(0, 0, -1, 1.0, 0.0), invalid_argument);
+    BOOST_CHECK_THROW(builder.add_transition(0, 0, 1, -1.0, 0.0), invalid_argument);
+
+    // sorted states are built in several steps with bounded memory
+    default_random_engine gen(73);
+    uniform_int_distribution<long> state(0, 19999);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    const size_t samples = ModelBuilder<RegularState>::flush_size * 2 + 100;
+    MDP expected;
+    for(size_t i = 0; i < samples; i++){
+        const long s = i / 100, a = (i / 10) % 3, t = state(gen);
+        const prec_t p = value(gen), r = value(gen);
+        add_transition(expected, s, a, t, p, r);
+        builder.add_transition(s, a, t, p, r);
+    }
+    BOOST_CHECK_LE(builder.memory(), (ModelBuilder<RegularState>::flush_size +
+                                      ModelBuilder<RegularState>::block_size) * sizeof(ModelBuilder<RegularState>::Sample));
+    builder.build();
+    check_same_model(expected, mdp);
+}
+
+// ********************************************************************************
+// ***** Allocations **************************************************************
+// ********************************************************************************
+
+/// Number of allocations while counting is enabled; incremented by the worker threads too
+static atomic<long> allocation_count(0);
+/// Whether to count allocations
+static atomic<bool> count_allocations(false);
+
+// not inlined, so that the compiler does not pair malloc and free with new and delete
+__attribute__((noinline)) void* operator new(size_t size){
+    if(count_allocations) allocation_count++;
+    void* p = malloc(size > 0 ? size : 1);
+    if(!p) throw bad_alloc();
+    return p;
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept {free(p);}
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {free(p);}
+
+/** Counts the allocations performed by the function */
+template<class F>
+long allocations(F function){
+    allocation_count = 0;
+    count_allocations = true;
+    function();
+    count_allocations = false;
+    return allocation_count;
+}
+
+BOOST_AUTO_TEST_CASE(test_allocation_free){
+    const long n = 200;
+    default_random_engine gen(67);
+    uniform_int_distribution<long> state(0, n-1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+
+    RMDP_L1 rmdp(n);
+    for(long s = 0; s < n; s++)
+        for(long a = 0; a < 2; a++)
+            for(long o = 0; o < 3; o++)
+                for(long k = 0; k < 3; k++)
+                    add_transition(rmdp, s, a, o, state(gen), value(gen), value(gen));
+    rmdp.normalize();
+    set_outcome_thresholds(rmdp, 0.5);
+
+    // warm up the thread pool and the thread-local buffers
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average})
+        rmdp.vi_jac(uncert, 0.9, numvec(0), 5);
+    auto&& sol = rmdp.vi_jac(Uncertainty::Robust, 0.9, numvec(0), 5);
+
+    // additional sweeps do not allocate memory
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        BOOST_CHECK_EQUAL(allocations([&]{rmdp.vi_jac(uncert, 0.9, sol.valuefunction, 2, 0);}),
+                          allocations([&]{rmdp.vi_jac(uncert, 0.9, sol.valuefunction, 6, 0);}));
+        BOOST_CHECK_EQUAL(allocations([&]{rmdp.vi_gs(uncert, 0.9, sol.valuefunction, 2, 0);}),
+                          allocations([&]{rmdp.vi_gs(uncert, 0.9, sol.valuefunction, 6, 0);}));
+        BOOST_CHECK_EQUAL(allocations([&]{rmdp.mpi_jac(uncert, 0.9, sol.valuefunction, 2, 0, 3, 0);}),
+                          allocations([&]{rmdp.mpi_jac(uncert, 0.9, sol.valuefunction, 4, 0, 3, 0);}));
+    }
+    BOOST_CHECK_EQUAL(allocations([&]{rmdp.vi_jac_fix(0.9, sol.policy, sol.outcomes, sol.valuefunction, 2, 0);}),
+                      allocations([&]{rmdp.vi_jac_fix(0.9, sol.policy, sol.outcomes, sol.valuefunction, 6, 0);}));
+
+    // only the solution itself is allocated: a distribution of nature for each state
+    // with robust solutions and a constant number of vectors otherwise
+    BOOST_CHECK_LE(allocations([&]{rmdp.vi_jac(Uncertainty::Robust, 0.9, sol.valuefunction, 3, 0);}), n + 20);
+    BOOST_CHECK_LE(allocations([&]{rmdp.vi_jac(Uncertainty::Average, 0.9, sol.valuefunction, 3, 0);}), 20);
+    BOOST_CHECK_LE(allocations([&]{rmdp.rewards_state(sol.policy, sol.outcomes);}), 5);
+
+    // the transition matrices reuse a scratch transition in each thread (in each parallel
+    // loop), so the number of allocations depends on the number of threads but not states
+    const long threads = thread_count();
+    BOOST_CHECK_LE(allocations([&]{rmdp.transition_mat(sol.policy, sol.outcomes);}), 20 * threads + 10);
+    BOOST_CHECK_LE(allocations([&]{rmdp.transition_mat_t(sol.policy, sol.outcomes);}), 20 * threads + 10);
+    BOOST_CHECK_LE(allocations([&]{rmdp.transition_mat_sparse(sol.policy, sol.outcomes);}), 40 * threads + 10);
+    BOOST_CHECK_LE(allocations([&]{rmdp.transition_mat_sparse_t(sol.policy, sol.outcomes);}), 40 * threads + 10);
+}
+
+/** Name of a file in the temporary directory; the file is removed at the end of the scope */
+struct TemporaryFile{
+    explicit TemporaryFile(const string& suffix){
+        static int counter = 0;
+        const char* directory = getenv("TMPDIR");
+        name = string(directory != nullptr ? directory : "/tmp") + "/craam_test_" +
+                std::to_string(getpid()) + "_" + std::to_string(counter++) + suffix;
+    }
+    TemporaryFile(const TemporaryFile&) = delete;
+    TemporaryFile& operator=(const TemporaryFile&) = delete;
+    ~TemporaryFile(){remove(name.c_str());}
+
+    string name;
+};
+
+/// Contents of the file
+string read_file(const string& filename){
+    ifstream input(filename, ifstream::binary);
+    return string((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+}
+
+template<class Model>
+void test_compressed_csv(const Model& rmdp){
+    const TemporaryFile file(".csv.gz");
+    rmdp.to_csv_file(file.name);
+    BOOST_CHECK(is_compressed_file(file.name));
+
+    // small blocks split the lines
+    Model rmdp1, rmdp2, rmdp3;
+    from_csv_file(rmdp1, file.name);
+    from_csv_file_parallel(rmdp2, file.name);
+    from_csv_file_parallel(rmdp3, file.name, true, nullptr, 7);
+    stringstream expected;
+    rmdp.to_csv(expected);
+    stringstream csv1, csv2, csv3;
+    rmdp1.to_csv(csv1); rmdp2.to_csv(csv2); rmdp3.to_csv(csv3);
+    BOOST_CHECK(csv1.str() == expected.str());
+    BOOST_CHECK(csv2.str() == expected.str());
+    BOOST_CHECK(csv3.str() == expected.str());
+}
+
+BOOST_AUTO_TEST_CASE(test_compressed_model_files){
+    if(!compression_supported()) return;
+
+    test_compressed_csv(create_test_mdp<MDP>());
+    test_compressed_csv(create_test_mdp<RMDP_D>());
+    test_compressed_csv(create_test_mdp<RMDP_L1>());
+
+    const long n = 300;
+    default_random_engine gen(11);
+    uniform_int_distribution<long> state(0, n-1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+    RMDP_L1 rmdp(n);
+    for(long s = 0; s < n; s++)
+        for(long o = 0; o < 3; o++)
+            for(long k = 0; k < 4; k++)
+                add_transition(rmdp, s, 0, o, state(gen), value(gen), value(gen));
+    set_outcome_thresholds(rmdp, 0.4);
+
+    // binary files with delta-encoded indices
+    const TemporaryFile binary(".bin.gz");
+    const auto cmdp = freeze(rmdp);
+    cmdp.to_binary_file(binary.name);
+    BOOST_CHECK(is_compressed_file(binary.name));
+    auto&& loaded = CompressedMDP<L1RobustState>::from_binary_file(binary.name);
+    check_same_solution<RMDP_L1>(cmdp.vi_jac(Uncertainty::Robust,0.9,numvec(0),100,0),
+                                 loaded.vi_jac(Uncertainty::Robust,0.9,numvec(0),100,0));
+    BOOST_CHECK_EQUAL(RMDP_L1::from_binary_file(binary.name).to_json(), rmdp.to_json());
+
+    // compressed csv files are smaller
+    const TemporaryFile plain(".csv"), compressed(".csv.gz");
+    rmdp.to_csv_file(plain.name);
+    rmdp.to_csv_file(compressed.name);
+    const string contents = read_file(compressed.name);
+    BOOST_CHECK_LT(contents.size(), read_file(plain.name).size());
+
+    // truncated compressed files are errors, wherever they are cut
+    const TemporaryFile truncated(".csv.gz");
+    for(size_t length = 2; length < contents.size(); length += 1 + length / 3){
+        ofstream(truncated.name, ofstream::binary).write(contents.data(), length);
+        RMDP_L1 truncated1, truncated2;
+        BOOST_CHECK_THROW(from_csv_file(truncated1, truncated.name), invalid_argument);
+        BOOST_CHECK_THROW(from_csv_file_parallel(truncated2, truncated.name), invalid_argument);
+    }
+
+    // corrupted checksum in the gzip trailer (the data decompress without errors)
+    const TemporaryFile corrupted(".csv.gz");
+    string damaged = contents;
+    damaged[damaged.size() - 8] ^= 0xff;
+    ofstream(corrupted.name, ofstream::binary).write(damaged.data(), damaged.size());
+    RMDP_L1 corrupted1, corrupted2;
+    BOOST_CHECK_THROW(from_csv_file(corrupted1, corrupted.name), invalid_argument);
+    BOOST_CHECK_THROW(from_csv_file_parallel(corrupted2, corrupted.name), invalid_argument);
+
+    // truncated compressed binary file
+    const string binarycontents = read_file(binary.name);
+    const TemporaryFile truncatedbinary(".bin.gz");
+    ofstream(truncatedbinary.name, ofstream::binary).write(binarycontents.data(), binarycontents.size() / 2);
+    BOOST_CHECK_THROW(CompressedMDP<L1RobustState>::from_binary_file(truncatedbinary.name), invalid_argument);
+    // without the trailer only
+    ofstream(truncatedbinary.name, ofstream::binary).write(binarycontents.data(), binarycontents.size() - 4);
+    BOOST_CHECK_THROW(CompressedMDP<L1RobustState>::from_binary_file(truncatedbinary.name), invalid_argument);
+
+    // unknown flags in the header (after the identifier and five 32-bit fields)
+    const TemporaryFile uncompressed(".bin"), flagged(".bin");
+    cmdp.to_binary_file(uncompressed.name);
+    write_corrupted_file(uncompressed.name, flagged.name, 28, uint32_t(2));
+    BOOST_CHECK_THROW(CompressedMDP<L1RobustState>::from_binary_file(flagged.name), invalid_argument);
+    write_corrupted_file(uncompressed.name, flagged.name, 28, uint32_t(0));
+    BOOST_CHECK_NO_THROW(CompressedMDP<L1RobustState>::from_binary_file(flagged.name));
+}
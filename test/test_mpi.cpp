@@ -0,0 +1,142 @@
+#include "RMDP.hpp"
+#include "modeltools.hpp"
+#include "DistributedMDP.hpp"
+
+#include <random>
+#include <algorithm>
+
+#include <mpi.h>
+
+using namespace std;
+using namespace craam;
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MAIN
+
+#define CHECK_CLOSE_COLLECTION(aa, bb, tolerance) { \
+    using std::distance; \
+    using std::begin; \
+    using std::end; \
+    auto a = begin(aa), ae = end(aa); \
+    auto b = begin(bb); \
+    BOOST_REQUIRE_EQUAL(distance(a, ae), distance(b, end(bb))); \
+    for(; a != ae; ++a, ++b) { \
+        BOOST_CHECK_CLOSE(*a, *b, tolerance); \
+    } \
+}
+
+#define BOOST_TEST_MODULE DistributedModule
+#include <boost/test/unit_test.hpp>
+
+/** Initializes and finalizes MPI for all tests */
+struct MPIFixture{
+    MPIFixture(){
+        MPI_Init(&boost::unit_test::framework::master_test_suite().argc,
+                 &boost::unit_test::framework::master_test_suite().argv);
+    }
+    ~MPIFixture(){
+        MPI_Finalize();
+    }
+};
+
+BOOST_GLOBAL_FIXTURE(MPIFixture);
+
+// ********************************************************************************
+MDP create_random_mdp(size_t statecount, size_t actioncount, size_t nonzeros, unsigned seed){
+    default_random_engine gen(seed);
+    uniform_int_distribution<long> state(0, statecount-1);
+    uniform_real_distribution<prec_t> value(0.0, 1.0);
+
+    MDP mdp(statecount);
+    for(size_t s = 0; s < statecount; s++){
+        for(size_t a = 0; a < actioncount; a++){
+            for(size_t k = 0; k < nonzeros; k++)
+                add_transition(mdp, s, a, state(gen), value(gen), value(gen));
+        }
+    }
+    mdp.normalize();
+    return mdp;
+}
+
+/** A chain in which each state transitions to itself and to its neighbors */
+MDP create_chain_mdp(long statecount, unsigned seed){
+    default_random_engine gen(seed);
+    uniform_real_distribution<prec_t> value(0.1, 1.0);
+
+    MDP mdp(statecount);
+    for(long s = 0; s < statecount; s++){
+        for(long a = 0; a < 2; a++){
+            for(long t = max(0l, s-1); t <= min(statecount-1, s+1); t++)
+                add_transition(mdp, s, a, t, value(gen), value(gen) * (a+1));
+        }
+    }
+    mdp.normalize();
+    return mdp;
+}
+
+BOOST_AUTO_TEST_CASE(test_distributed_vi){
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    MDP mdp = create_random_mdp(120, 3, 4, 47);
+    DistributedMDP<RegularState> dmdp(mdp);
+    BOOST_CHECK_EQUAL(dmdp.state_count(), mdp.state_count());
+
+    long localcount = dmdp.local_state_count();
+    MPI_Allreduce(MPI_IN_PLACE, &localcount, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    BOOST_CHECK_EQUAL(localcount, long(mdp.state_count()));
+
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic, Uncertainty::Average}){
+        auto&& single = mdp.vi_jac(uncert, 0.9, numvec(0), MAXITER, 1e-10);
+        auto&& distributed = dmdp.vi_jac(uncert, 0.9, numvec(0), MAXITER, 1e-10);
+        CHECK_CLOSE_COLLECTION(single.valuefunction, distributed.valuefunction, 1e-8);
+        BOOST_CHECK_EQUAL_COLLECTIONS(single.policy.begin(), single.policy.end(),
+                                      distributed.policy.begin(), distributed.policy.end());
+        BOOST_CHECK_EQUAL(single.iterations, distributed.iterations);
+    }
+
+    // warm start
+    auto&& start = mdp.vi_jac(Uncertainty::Robust, 0.9, numvec(0), 10);
+    auto&& single = mdp.vi_jac(Uncertainty::Robust, 0.9, start.valuefunction, 20);
+    auto&& distributed = dmdp.vi_jac(Uncertainty::Robust, 0.9, start.valuefunction, 20);
+    CHECK_CLOSE_COLLECTION(single.valuefunction, distributed.valuefunction, 1e-8);
+
+    // only the neighbors of the block are received in a chain
+    MDP chain = create_chain_mdp(200, 53);
+    DistributedMDP<RegularState> dchain(chain);
+    BOOST_CHECK_LE(dchain.ghost_count(), 2u);
+    auto&& chainsingle = chain.mpi_jac(Uncertainty::Robust, 0.95, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+    auto&& chaindist = dchain.mpi_jac(Uncertainty::Robust, 0.95, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+    CHECK_CLOSE_COLLECTION(chainsingle.valuefunction, chaindist.valuefunction, 1e-8);
+    BOOST_CHECK_EQUAL(chainsingle.sweeps, chaindist.sweeps);
+}
+
+BOOST_AUTO_TEST_CASE(test_distributed_robust){
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    MDP mdp = create_random_mdp(90, 3, 4, 59);
+    RMDP_L1 rmdp = robustify<L1RobustState>(mdp, false);
+    set_outcome_thresholds(rmdp, 0.3);
+
+    // each rank constructs only its own block of states
+    const long first = (rmdp.state_count() * rank) / ranks;
+    const long last = (rmdp.state_count() * (rank + 1)) / ranks;
+    RMDP_L1 block(last - first);
+    for(long s = first; s < last; s++)
+        block.get_state(s - first) = rmdp[s];
+    DistributedMDP<L1RobustState> dmdp(block, first);
+    BOOST_CHECK_EQUAL(dmdp.get_first(), first);
+
+    for(auto uncert : {Uncertainty::Robust, Uncertainty::Optimistic}){
+        auto&& single = rmdp.mpi_jac(uncert, 0.9, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+        auto&& distributed = dmdp.mpi_jac(uncert, 0.9, numvec(0), MAXITER, 1e-10, MAXITER, 1e-11);
+        CHECK_CLOSE_COLLECTION(single.valuefunction, distributed.valuefunction, 1e-8);
+        BOOST_REQUIRE_EQUAL(single.outcomes.size(), distributed.outcomes.size());
+        for(size_t s = 0; s < single.outcomes.size(); s++)
+            CHECK_CLOSE_COLLECTION(single.outcomes[s], distributed.outcomes[s], 1e-6);
+    }
+
+    BOOST_CHECK_THROW(dmdp.vi_jac(Uncertainty::Robust, 0.9, numvec(3)), invalid_argument);
+}